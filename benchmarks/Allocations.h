@@ -0,0 +1,24 @@
+#ifndef BENCHMARKS_ALLOCATIONS_H
+#define BENCHMARKS_ALLOCATIONS_H
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+
+#include "AllocationTracker.h"
+
+// Benchmarks are always built with the allocation tracker
+namespace Allocations
+{
+	inline uint64_t Get()
+	{
+		return AllocationTracker::GetCount();
+	}
+	
+	// Report allocations per iteration since the mark
+	inline void Report(benchmark::State& state, uint64_t mark)
+	{
+		state.counters["allocs/op"] = benchmark::Counter(Get()-mark, benchmark::Counter::kAvgIterations);
+	}
+};
+
+#endif /* BENCHMARKS_ALLOCATIONS_H */
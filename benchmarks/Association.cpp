@@ -0,0 +1,146 @@
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "Buffer.h"
+#include "FakeTimeService.h"
+#include "sctp/Association.h"
+
+// Pair of established associations connected back to back
+class Peers
+{
+public:
+	Peers()
+	{
+		client = sctp::Association::Create(timeService);
+		server = sctp::Association::Create(timeService);
+		client->SetLocalPort(5000);
+		client->SetRemotePort(5000);
+		server->SetLocalPort(5000);
+		server->SetRemotePort(5000);
+		client->Associate();
+		while (Pump());
+	}
+	
+	//Move all pending packets in both directions once, return number of packets
+	size_t Pump()
+	{
+		size_t packets = 0;
+		while (size_t len = client->ReadPacket(data,sizeof(data)))
+		{
+			server->WritePacket(data,len);
+			packets++;
+			bytes += len;
+		}
+		while (size_t len = server->ReadPacket(data,sizeof(data)))
+		{
+			client->WritePacket(data,len);
+			packets++;
+			bytes += len;
+		}
+		return packets;
+	}
+	
+	bool IsEstablished() const
+	{
+		return client->GetState()==sctp::Association::Established && server->GetState()==sctp::Association::Established;
+	}
+	
+	FakeTimeService timeService;
+	std::shared_ptr<sctp::Association> client;
+	std::shared_ptr<sctp::Association> server;
+	uint8_t data[1500];
+	size_t bytes = 0;
+};
+
+// Send a message and move DATA and SACK packets until both sides are idle
+static void RoundTrip(benchmark::State& state)
+{
+	Peers peers;
+	if (!peers.IsEstablished())
+	{
+		state.SkipWithError("association not established");
+		return;
+	}
+	
+	Buffer message(state.range(0));
+	message.SetSize(message.GetCapacity());
+	memset(message.GetData(),0xAA,message.GetSize());
+	
+	auto& stream = peers.client->OpenStream(1);
+	size_t received = 0;
+	peers.server->OpenStream(1).OnMessage([&](...){ received++; });
+	
+	size_t packets = 0;
+	peers.bytes = 0;
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		stream.Send(53,message.GetData(),message.GetSize());
+		while (size_t num = peers.Pump())
+			packets += num;
+	}
+	Allocations::Report(state,mark);
+	state.counters["packets/op"] = benchmark::Counter(packets, benchmark::Counter::kAvgIterations);
+	state.counters["ns/packet"] = benchmark::Counter(packets, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.SetBytesProcessed(state.iterations()*message.GetSize());
+	state.SetItemsProcessed(state.iterations());
+	
+	if (received!=state.iterations())
+		state.SkipWithError("messages lost");
+}
+BENCHMARK(RoundTrip)->Arg(64)->Arg(1024)->Arg(16384);
+
+// Generate a SACK reporting N gap blocks after receiving a duplicate DATA chunk
+static void SackGeneration(benchmark::State& state)
+{
+	Peers peers;
+	if (!peers.IsEstablished())
+	{
+		state.SkipWithError("association not established");
+		return;
+	}
+	
+	const size_t gaps = state.range(0);
+	
+	//Build DATA packet from client to server
+	auto packet = [&](uint32_t tsn, uint8_t* data, size_t size) {
+		BufferWritter writter(data,size);
+		sctp::PacketHeader header(peers.client->GetLocalPort(),peers.client->GetRemotePort(),peers.server->GetLocalVerificationTag());
+		header.Serialize(writter);
+		uint8_t payload[64] = {};
+		return sctp::PayloadDataChunk::Serialize(writter,sctp::PayloadDataChunk::BeginingFragment | sctp::PayloadDataChunk::EndingFragment,tsn,1,tsn,53,payload,sizeof(payload));
+	};
+	
+	//Initial TSN is the low part of the first extended TSN
+	uint32_t initial = 0;
+	
+	//Receive every other TSN to create the gaps
+	uint8_t data[1500];
+	for (size_t i=0;i<=gaps;++i)
+	{
+		size_t len = packet(initial + i*2,data,sizeof(data));
+		peers.server->WritePacket(data,len);
+		while (peers.server->ReadPacket(data,sizeof(data)));
+	}
+	
+	//Duplicated TSN, acknowledged immediately
+	uint8_t duplicate[1500];
+	size_t len = packet(initial + 2,duplicate,sizeof(duplicate));
+	uint8_t copy[1500];
+	
+	size_t sacked = 0;
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		memcpy(copy,duplicate,len);
+		peers.server->WritePacket(copy,len);
+		sacked += peers.server->ReadPacket(data,sizeof(data));
+	}
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(sacked);
+	state.SetItemsProcessed(state.iterations());
+	
+	if (!sacked)
+		state.SkipWithError("no SACK generated");
+}
+BENCHMARK(SackGeneration)->RangeMultiplier(4)->Range(1,256);
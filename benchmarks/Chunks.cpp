@@ -0,0 +1,251 @@
+#include <benchmark/benchmark.h>
+
+#include "Allocations.h"
+#include "Buffer.h"
+#include "BufferReader.h"
+#include "BufferWritter.h"
+#include "sctp/PacketHeader.h"
+#include "sctp/Chunk.h"
+
+static Buffer Serialize(const sctp::Chunk& chunk)
+{
+	Buffer buffer(chunk.GetSize()+64);
+	BufferWritter writter(buffer);
+	buffer.SetSize(chunk.Serialize(writter));
+	return buffer;
+}
+
+static void ChunkParse(benchmark::State& state, std::shared_ptr<sctp::Chunk> chunk)
+{
+	//Serialize chunk once
+	Buffer buffer = Serialize(*chunk);
+	
+	//Check it can be parsed back
+	BufferReader check(buffer);
+	if (!buffer.GetSize() || !sctp::Chunk::Parse(check))
+	{
+		state.SkipWithError("chunk can't be serialized and parsed back");
+		return;
+	}
+	
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		BufferReader reader(buffer);
+		auto parsed = sctp::Chunk::Parse(reader);
+		benchmark::DoNotOptimize(parsed);
+	}
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(state.iterations()*buffer.GetSize());
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void ChunkSerialize(benchmark::State& state, std::shared_ptr<sctp::Chunk> chunk)
+{
+	Buffer buffer(chunk->GetSize()+64);
+	size_t len = 0;
+	
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		BufferWritter writter(buffer);
+		len = chunk->Serialize(writter);
+		benchmark::DoNotOptimize(buffer.GetData());
+	}
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(state.iterations()*len);
+	state.SetItemsProcessed(state.iterations());
+}
+
+static std::shared_ptr<sctp::Chunk> Data(size_t size)
+{
+	auto data = std::make_shared<sctp::PayloadDataChunk>();
+	data->transmissionSequenceNumber = 1234;
+	data->streamIdentifier = 1;
+	data->streamSequenceNumber = 2;
+	data->payloadProtocolIdentifier = 53;
+	data->beginingFragment = data->endingFragment = true;
+	Buffer payload(size);
+	payload.SetSize(size);
+	memset(payload.GetData(),0xAA,size);
+	data->userData = std::move(payload);
+	return data;
+}
+
+static std::shared_ptr<sctp::Chunk> Init()
+{
+	auto init = std::make_shared<sctp::InitiationChunk>();
+	init->initiateTag = 0x12345678;
+	init->advertisedReceiverWindowCredit = 0xFFFFFFFF;
+	init->numberOfOutboundStreams = 0xFFFF;
+	init->numberOfInboundStreams = 0xFFFF;
+	init->supportedExtensions = {sctp::Chunk::RE_CONFIG};
+	return init;
+}
+
+static std::shared_ptr<sctp::Chunk> InitAck()
+{
+	auto ack = std::make_shared<sctp::InitiationAcknowledgementChunk>();
+	ack->initiateTag = 0x12345678;
+	ack->advertisedReceiverWindowCredit = 0xFFFFFFFF;
+	ack->numberOfOutboundStreams = 0xFFFF;
+	ack->numberOfInboundStreams = 0xFFFF;
+	ack->supportedExtensions = {sctp::Chunk::RE_CONFIG};
+	ack->stateCookie.SetData((const uint8_t*)"dtls",4);
+	return ack;
+}
+
+static std::shared_ptr<sctp::Chunk> Sack(size_t gaps)
+{
+	auto sack = std::make_shared<sctp::SelectiveAcknowledgementChunk>();
+	sack->cumulativeTrasnmissionSequenceNumberAck = 1000;
+	sack->adveritsedReceiverWindowCredit = 0xFFFF;
+	for (size_t i=0;i<gaps;++i)
+		sack->gapAckBlocks.emplace_back(2+i*2,2+i*2);
+	return sack;
+}
+
+static std::shared_ptr<sctp::Chunk> Heartbeat()
+{
+	auto heartbeat = std::make_shared<sctp::HeartbeatRequestChunk>();
+	heartbeat->senderSpecificHearbeatInfo.SetData((const uint8_t*)"01234567",8);
+	return heartbeat;
+}
+
+static std::shared_ptr<sctp::Chunk> HeartbeatAck()
+{
+	auto ack = std::make_shared<sctp::HeartbeatAckChunk>();
+	ack->senderSpecificHearbeatInfo.SetData((const uint8_t*)"01234567",8);
+	return ack;
+}
+
+static std::shared_ptr<sctp::Chunk> CookieEcho()
+{
+	auto echo = std::make_shared<sctp::CookieEchoChunk>();
+	echo->cookie.SetData((const uint8_t*)"dtls",4);
+	return echo;
+}
+
+static std::shared_ptr<sctp::Chunk> Padding()
+{
+	auto padding = std::make_shared<sctp::PaddingChunk>();
+	padding->buffer.SetData((const uint8_t*)"01234567",8);
+	return padding;
+}
+
+static std::shared_ptr<sctp::Chunk> Unknown()
+{
+	auto unknown = std::make_shared<sctp::UnknownChunk>(0x3F);
+	unknown->buffer.SetData((const uint8_t*)"01234567",8);
+	return unknown;
+}
+
+BENCHMARK_CAPTURE(ChunkParse, DATA/64,		Data(64));
+BENCHMARK_CAPTURE(ChunkParse, DATA/1024,	Data(1024));
+BENCHMARK_CAPTURE(ChunkParse, INIT,		Init());
+BENCHMARK_CAPTURE(ChunkParse, INIT_ACK,		InitAck());
+BENCHMARK_CAPTURE(ChunkParse, SACK,		Sack(0));
+BENCHMARK_CAPTURE(ChunkParse, SACK/16,		Sack(16));
+BENCHMARK_CAPTURE(ChunkParse, HEARTBEAT,	Heartbeat());
+BENCHMARK_CAPTURE(ChunkParse, HEARTBEAT_ACK,	HeartbeatAck());
+BENCHMARK_CAPTURE(ChunkParse, ABORT,		std::make_shared<sctp::AbortAssociationChunk>());
+BENCHMARK_CAPTURE(ChunkParse, SHUTDOWN,		std::make_shared<sctp::ShutdownAssociationChunk>());
+BENCHMARK_CAPTURE(ChunkParse, SHUTDOWN_ACK,	std::make_shared<sctp::ShutdownAcknowledgementChunk>());
+BENCHMARK_CAPTURE(ChunkParse, ERROR,		std::make_shared<sctp::OperationErrorChunk>());
+BENCHMARK_CAPTURE(ChunkParse, COOKIE_ECHO,	CookieEcho());
+BENCHMARK_CAPTURE(ChunkParse, COOKIE_ACK,	std::make_shared<sctp::CookieAckChunk>());
+BENCHMARK_CAPTURE(ChunkParse, SHUTDOWN_COMPLETE,std::make_shared<sctp::ShutdownCompleteChunk>());
+BENCHMARK_CAPTURE(ChunkParse, RE_CONFIG,	std::make_shared<sctp::ReConfigChunk>());
+BENCHMARK_CAPTURE(ChunkParse, FORWARD_TSN,	std::make_shared<sctp::ForwardCumulativeTSNChunk>());
+BENCHMARK_CAPTURE(ChunkParse, PAD,		Padding());
+BENCHMARK_CAPTURE(ChunkParse, UNKNOWN,		Unknown());
+
+BENCHMARK_CAPTURE(ChunkSerialize, DATA/1024,	Data(1024));
+BENCHMARK_CAPTURE(ChunkSerialize, SACK/16,	Sack(16));
+
+static void SackSerialize(benchmark::State& state)
+{
+	ChunkSerialize(state,Sack(state.range(0)));
+}
+BENCHMARK(SackSerialize)->RangeMultiplier(4)->Range(1,256);
+
+static void SackParseInto(benchmark::State& state)
+{
+	//Serialize chunk once
+	Buffer buffer = Serialize(*Sack(state.range(0)));
+	
+	//Reuse same chunk, so only decoding is measured
+	sctp::SelectiveAcknowledgementChunk sack;
+	
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		BufferReader reader(buffer);
+		bool parsed = sctp::SelectiveAcknowledgementChunk::Parse(reader,sack);
+		benchmark::DoNotOptimize(parsed);
+		benchmark::DoNotOptimize(sack);
+	}
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(state.iterations()*buffer.GetSize());
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(SackParseInto)->RangeMultiplier(4)->Range(1,256);
+
+static void PacketHeaderParse(benchmark::State& state)
+{
+	uint8_t data[12];
+	BufferWritter writter(data,sizeof(data));
+	sctp::PacketHeader(5000,5000,0x12345678,0xCAFEBABE).Serialize(writter);
+	
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		BufferReader reader(data,sizeof(data));
+		auto header = sctp::PacketHeader::Parse(reader);
+		benchmark::DoNotOptimize(header);
+	}
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(state.iterations()*sizeof(data));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(PacketHeaderParse);
+
+static void PacketHeaderParseInto(benchmark::State& state)
+{
+	uint8_t data[12];
+	BufferWritter writter(data,sizeof(data));
+	sctp::PacketHeader(5000,5000,0x12345678,0xCAFEBABE).Serialize(writter);
+	
+	sctp::PacketHeader header;
+	
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		BufferReader reader(data,sizeof(data));
+		bool parsed = sctp::PacketHeader::Parse(reader,header);
+		benchmark::DoNotOptimize(parsed);
+		benchmark::DoNotOptimize(header);
+	}
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(state.iterations()*sizeof(data));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(PacketHeaderParseInto);
+
+static void PacketHeaderSerialize(benchmark::State& state)
+{
+	uint8_t data[12];
+	sctp::PacketHeader header(5000,5000,0x12345678,0xCAFEBABE);
+	
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+	{
+		BufferWritter writter(data,sizeof(data));
+		header.Serialize(writter);
+		benchmark::DoNotOptimize(data);
+	}
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(state.iterations()*sizeof(data));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(PacketHeaderSerialize);
@@ -0,0 +1,19 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <crc32c/crc32c.h>
+
+#include "Allocations.h"
+
+static void Crc32c(benchmark::State& state)
+{
+	std::vector<uint8_t> data(state.range(0),0xAA);
+	
+	auto mark = Allocations::Get();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(crc32c::Crc32c(data.data(),data.size()));
+	Allocations::Report(state,mark);
+	state.SetBytesProcessed(state.iterations()*data.size());
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Crc32c)->Arg(64)->Arg(1200)->Arg(65536);
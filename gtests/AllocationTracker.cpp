@@ -0,0 +1,99 @@
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> count{0};
+
+bool AllocationTracker::IsEnabled()
+{
+#ifdef TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t AllocationTracker::GetCount()
+{
+	return count.load(std::memory_order_relaxed);
+}
+
+#ifndef TRACK_ALLOCATIONS
+//Use the default allocator
+#elif defined(__GLIBC__)
+
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t num, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void  __libc_free(void* ptr);
+
+	void* malloc(size_t size)
+	{
+		count.fetch_add(1,std::memory_order_relaxed);
+		return __libc_malloc(size);
+	}
+	
+	void* calloc(size_t num, size_t size)
+	{
+		count.fetch_add(1,std::memory_order_relaxed);
+		return __libc_calloc(num,size);
+	}
+	
+	void* realloc(void* ptr, size_t size)
+	{
+		count.fetch_add(1,std::memory_order_relaxed);
+		return __libc_realloc(ptr,size);
+	}
+	
+	void* aligned_alloc(size_t alignment, size_t size)
+	{
+		count.fetch_add(1,std::memory_order_relaxed);
+		return __libc_memalign(alignment,size);
+	}
+	
+	void* memalign(size_t alignment, size_t size)
+	{
+		count.fetch_add(1,std::memory_order_relaxed);
+		return __libc_memalign(alignment,size);
+	}
+	
+	int posix_memalign(void** ptr, size_t alignment, size_t size)
+	{
+		count.fetch_add(1,std::memory_order_relaxed);
+		*ptr = __libc_memalign(alignment,size);
+		return *ptr ? 0 : ENOMEM;
+	}
+	
+	void free(void* ptr)
+	{
+		__libc_free(ptr);
+	}
+}
+
+#else
+
+void* operator new(size_t size)
+{
+	count.fetch_add(1,std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+#include <stdint.h>
+
+// Heap allocation counter
+//	Only built in when TRACK_ALLOCATIONS is defined, as it replaces the
+//	allocator of the whole binary. On glibc all the malloc family is
+//	interposed so Buffer allocations are counted too, elsewhere only the
+//	global operator new is.
+namespace AllocationTracker
+{
+	bool IsEnabled();
+	uint64_t GetCount();
+};
+
+#endif /* ALLOCATIONTRACKER_H */
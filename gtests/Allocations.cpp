@@ -0,0 +1,116 @@
+/*
+ * File:   Allocations
+ *
+ * Created on 19-oct-2026, 19:02:37
+ */
+
+#include <gtest/gtest.h>
+
+#include "AllocationTracker.h"
+#include "Buffer.h"
+#include "TimerWheel.h"
+#include "sctp/Association.h"
+
+// Checks the established DATA/SACK path doesn't touch the heap
+//	Messages are queued before taking the mark, as Stream::Send copies them,
+//	then everything done per packet is measured: reading and writing packets,
+//	delivering messages, generating and processing sacks and the timers.
+class Allocations : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!AllocationTracker::IsEnabled())
+			GTEST_SKIP() << "configure with -DTRACK_ALLOCATIONS=ON";
+
+		client = sctp::Association::Create(timeService);
+		server = sctp::Association::Create(timeService);
+		client->SetLocalPort(5000);
+		client->SetRemotePort(5000);
+		server->SetLocalPort(5000);
+		server->SetRemotePort(5000);
+		server->OnMessage([this](auto&&...){ received++; });
+		ASSERT_TRUE(client->Associate());
+		while (Pump());
+		ASSERT_EQ(client->GetState(),sctp::Association::Established);
+		ASSERT_EQ(server->GetState(),sctp::Association::Established);
+	}
+
+	//Move all pending packets in both directions once, return number of packets
+	size_t Pump()
+	{
+		size_t packets = 0;
+		while (size_t len = client->ReadPacket(data,sizeof(data)))
+		{
+			server->WritePacket(data,len);
+			packets++;
+		}
+		while (size_t len = server->ReadPacket(data,sizeof(data)))
+		{
+			client->WritePacket(data,len);
+			packets++;
+		}
+		return packets;
+	}
+
+	//Exchange packets until all messages are delivered and acknowledged, return allocations done
+	uint64_t Exchange(size_t messages)
+	{
+		auto mark = AllocationTracker::GetCount();
+
+		//Until all are delivered
+		while (received<messages)
+		{
+			while (Pump());
+			//Let delayed sacks fire
+			if (received<messages)
+				timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+		}
+		//Send last delayed sack
+		timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+		while (Pump());
+
+		return AllocationTracker::GetCount() - mark;
+	}
+
+	datachannels::TimerWheel timeService;
+	std::shared_ptr<sctp::Association> client;
+	std::shared_ptr<sctp::Association> server;
+	uint8_t data[1500];
+	size_t received = 0;
+};
+
+TEST_F(Allocations, SteadyState)
+{
+	//Small messages on one stream and fragmented ones on other
+	Buffer small(100);
+	Buffer large(3000);
+	small.SetSize(small.GetCapacity());
+	large.SetSize(large.GetCapacity());
+	memset(small.GetData(),0xAA,small.GetSize());
+	memset(large.GetData(),0xBB,large.GetSize());
+
+	auto& first = client->OpenStream(1);
+	auto& second = client->OpenStream(3);
+
+	size_t sent = 0;
+
+	//First rounds grow queues, vectors and reassembly buffers to their working size while cwnd opens
+	for (size_t round = 0; round<10; ++round)
+	{
+		for (size_t i=0; i<32; ++i, sent+=2)
+		{
+			ASSERT_TRUE(first.Send(51,small.GetData(),small.GetSize()));
+			ASSERT_TRUE(second.Send(53,large.GetData(),large.GetSize()));
+		}
+
+		//Measure once warmed up
+		auto allocations = Exchange(sent);
+
+		ASSERT_EQ(received,sent);
+		if (round>=4)
+		{
+			ASSERT_EQ(allocations,0) << "round " << round;
+		}
+	}
+}
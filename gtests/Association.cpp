@@ -10,16 +10,56 @@
 #include "Buffer.h"
 #include "FakeTimeService.h"
 #include "sctp/Association.h"
+#include "sctp/PacketHeader.h"
+#include "sctp/chunks/PayloadDataChunk.h"
 
 class Association : public testing::Test
 {
 protected:
+	Association() :
+		client(timeService),
+		server(timeService)
+	{
+		client.SetLocalPort(5000);
+		client.SetRemotePort(5000);
+		server.SetLocalPort(5000);
+		server.SetRemotePort(5000);
+	}
+	
+	//Move packets in both directions until there is nothing else to send, dropping them while disconnected
+	size_t Pump()
+	{
+		size_t packets = 0;
+		uint8_t data[1500];
+		while (client.HasPendingData() || server.HasPendingData())
+		{
+			if (size_t len = client.ReadPacket(data,sizeof(data)); len && connected)
+				server.WritePacket(data,len), packets++;
+			if (size_t len = server.ReadPacket(data,sizeof(data)); len && connected)
+				client.WritePacket(data,len), packets++;
+		}
+		return packets;
+	}
+	
+	//Advance time firing the timers on the way
+	void Wait(std::chrono::milliseconds ms)
+	{
+		for (auto end = timeService.GetNow()+ms; timeService.GetNow()<end; )
+		{
+			timeService.SetNow(timeService.GetNow() + 10ms);
+			Pump();
+		}
+	}
+	
+	FakeTimeService timeService;
+	sctp::Association client;
+	sctp::Association server;
+	bool connected = true;
 };
 
 
 TEST_F(Association, Init)
 {
-	FakeTimeService timeService;
 	sctp::Association association(timeService);
 	
 	association.SetLocalPort(1000);
@@ -32,7 +72,6 @@ TEST_F(Association, Init)
 TEST_F(Association, EmptyRead)
 {
 	Buffer buffer(1500);
-	FakeTimeService timeService;
 	sctp::Association association(timeService);
 	ASSERT_EQ(association.HasPendingData(),false);
 	ASSERT_FALSE(association.ReadPacket(buffer));
@@ -40,7 +79,6 @@ TEST_F(Association, EmptyRead)
 
 TEST_F(Association, Associate)
 {
-	FakeTimeService timeService;
 	sctp::Association association(timeService);
 	
 	association.SetLocalPort(1000);
@@ -91,3 +129,441 @@ TEST_F(Association, Associate)
 	ASSERT_EQ(association.HasPendingData(),false);
 }
 
+
+TEST_F(Association, InitAlone)
+{
+	//Get the INIT
+	uint8_t data[1500];
+	client.Associate();
+	size_t len = client.ReadPacket(data,sizeof(data));
+	ASSERT_TRUE(len);
+	
+	//Bundle a DATA chunk after it
+	uint8_t bundled[1500];
+	memcpy(bundled,data,len);
+	BufferWritter writter(bundled+len,sizeof(bundled)-len);
+	ASSERT_TRUE(sctp::PayloadDataChunk::Serialize(writter,0x03,1,1,0,51,reinterpret_cast<const uint8_t*>("hello"),5));
+	
+	//Packets without tag must only carry the INIT
+	ASSERT_FALSE(server.WritePacket(bundled,len+writter.GetLength()));
+	ASSERT_EQ(server.GetStats().packetsDiscarded,1);
+	ASSERT_FALSE(server.HasPendingData());
+	
+	//The INIT alone is answered
+	server.WritePacket(data,len);
+	ASSERT_EQ(server.GetStats().packetsDiscarded,1);
+	ASSERT_TRUE(server.HasPendingData());
+	Pump();
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+}
+
+TEST_F(Association, Stats)
+{
+	client.Associate();
+	size_t packets = Pump();
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	
+	//Queue a message fragmented in two DATA chunks, first one is acked immediately and second one delayed
+	Buffer message(2048);
+	message.SetSize(2048);
+	auto& stream = client.OpenStream(1);
+	ASSERT_TRUE(stream.Send(51,message.GetData(),message.GetSize()));
+	ASSERT_EQ(stream.GetQueuedBytes(),2048);
+	ASSERT_EQ(client.GetStats().queuedBytes,2048);
+	
+	packets += Pump();
+	//Let the delayed sack fire
+	timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	packets += Pump();
+	
+	auto sent = client.GetStats();
+	auto received = server.GetStats();
+	
+	//Every packet read from one side was written to the other
+	ASSERT_EQ(sent.packetsSent + received.packetsSent,packets);
+	ASSERT_EQ(sent.packetsSent,received.packetsReceived);
+	ASSERT_EQ(sent.bytesSent,received.bytesReceived);
+	ASSERT_EQ(received.packetsDiscarded,0);
+	//Handshake and data
+	ASSERT_EQ(sent.chunksSent[sctp::Chunk::INIT],1);
+	ASSERT_EQ(received.chunksReceived[sctp::Chunk::INIT],1);
+	ASSERT_EQ(sent.chunksSent[sctp::Chunk::PDATA],2);
+	ASSERT_EQ(received.chunksReceived[sctp::Chunk::PDATA],2);
+	ASSERT_EQ(received.chunksSent[sctp::Chunk::SACK],received.acknowledgementsSent);
+	ASSERT_EQ(sent.chunksReceived[sctp::Chunk::SACK],received.acknowledgementsSent);
+	ASSERT_EQ(received.acknowledgementsSent,2);
+	ASSERT_EQ(received.delayedAcknowledgements,1);
+	ASSERT_EQ(sent.retransmissions,0);
+	//All sent and acknowledged
+	ASSERT_EQ(stream.GetQueuedBytes(),0);
+	ASSERT_EQ(sent.queuedBytes,0);
+	ASSERT_EQ(sent.bytesInFlight,0);
+	ASSERT_EQ(sent.outstandingChunks,0);
+	ASSERT_GT(sent.congestionWindow,0);
+	ASSERT_GT(sent.remoteReceiverWindow,0);
+	
+	//Packets for other ports are discarded
+	uint8_t data[1500];
+	server.Associate();
+	size_t len = server.ReadPacket(data,sizeof(data));
+	client.SetLocalPort(6000);
+	ASSERT_FALSE(client.WritePacket(data,len));
+	ASSERT_EQ(client.GetStats().packetsDiscarded,1);
+}
+
+TEST_F(Association, ScatterGather)
+{
+	//Received messages
+	std::vector<Buffer> messages;
+	server.OnMessage([&](sctp::Stream&, uint32_t, const uint8_t* data, uint64_t size){
+		messages.push_back(Buffer(data,size));
+	});
+	
+	//Client packets are read as slices and flattened for the server
+	size_t userData = 0;
+	auto pump = [&](const uint8_t* begin, const uint8_t* end){
+		uint8_t data[1500];
+		uint8_t flat[1500];
+		std::vector<datachannels::Slice> slices;
+		while (client.HasPendingData() || server.HasPendingData())
+		{
+			if (size_t len = client.ReadPacket(data,sizeof(data),slices))
+			{
+				size_t pos = 0;
+				for (const auto& slice : slices)
+				{
+					//Count the slices taken from the message
+					if (slice.data>=begin && slice.data<end)
+						userData += slice.size;
+					memcpy(flat+pos,slice.data,slice.size);
+					pos += slice.size;
+				}
+				ASSERT_EQ(pos,len);
+				server.WritePacket(flat,len);
+			}
+			if (size_t len = server.ReadPacket(data,sizeof(data)))
+				client.WritePacket(data,len);
+		}
+	};
+	
+	client.Associate();
+	pump(nullptr,nullptr);
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	
+	//Odd size so the last fragment needs padding
+	Buffer message(4001);
+	message.SetSize(4001);
+	for (size_t i=0;i<message.GetSize();++i)
+		message.GetData()[i] = i;
+	auto payload = datachannels::CreatePayload(message.GetData(),message.GetSize());
+	ASSERT_TRUE(client.OpenStream(1).Send(51,payload));
+	
+	pump(payload->GetData(),payload->GetData()+payload->GetSize());
+	timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	pump(nullptr,nullptr);
+	
+	//User data was not copied and checksums were valid
+	ASSERT_EQ(userData,message.GetSize());
+	ASSERT_EQ(server.GetStats().packetsDiscarded,0);
+	ASSERT_EQ(messages.size(),1);
+	ASSERT_EQ(messages[0].GetSize(),message.GetSize());
+	ASSERT_EQ(memcmp(messages[0].GetData(),message.GetData(),message.GetSize()),0);
+	ASSERT_EQ(client.GetStats().outstandingChunks,0);
+}
+
+TEST_F(Association, Headroom)
+{
+	//DTLS 1.2 record header and AES-GCM tag
+	const uint32_t headroom = 13;
+	const uint32_t tailroom = 16;
+	
+	client.Associate();
+	ASSERT_TRUE(client.OpenStream(1).Send(51,reinterpret_cast<const uint8_t*>("hello"),5));
+	size_t packets = 0;
+	while (client.HasPendingData() || server.HasPendingData())
+	{
+		uint8_t data[1500];
+		memset(data,0xAA,sizeof(data));
+		if (size_t len = client.ReadPacket(data,sizeof(data),headroom,tailroom))
+		{
+			//Nothing written out of the packet
+			for (size_t i=0;i<headroom;++i)
+				ASSERT_EQ(data[i],0xAA);
+			for (size_t i=headroom+len;i<sizeof(data);++i)
+				ASSERT_EQ(data[i],0xAA);
+			ASSERT_TRUE(server.WritePacket(data+headroom,len));
+			packets++;
+		}
+		if (size_t len = server.ReadPacket(data,sizeof(data)))
+			client.WritePacket(data,len);
+		timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	}
+	ASSERT_GT(packets,0);
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	ASSERT_EQ(server.GetStats().chunksReceived[sctp::Chunk::PDATA],1);
+	
+	//No room left for the packet
+	ASSERT_TRUE(client.GetStream(1)->Send(51,reinterpret_cast<const uint8_t*>("bye"),3));
+	ASSERT_TRUE(client.HasPendingData());
+	uint8_t small[64];
+	ASSERT_FALSE(client.ReadPacket(small,sizeof(small),32,32));
+	//Nor for the largest control chunk, even if this one would fit
+	uint8_t medium[sctp::Association::MinReadSize-1];
+	ASSERT_FALSE(client.ReadPacket(medium,sizeof(medium)));
+	ASSERT_FALSE(client.ReadPacket(medium,sizeof(medium),0,0));
+	ASSERT_EQ(client.GetStats().packetsSent,packets);
+	//Still pending for a big enough one
+	ASSERT_TRUE(client.HasPendingData());
+	uint8_t data[sctp::Association::MinReadSize];
+	ASSERT_TRUE(client.ReadPacket(data,sizeof(data)));
+}
+
+TEST_F(Association, DataBatch)
+{
+	//Received messages as stream and content
+	std::vector<std::pair<uint16_t,std::string>> messages;
+	server.OnMessage([&](sctp::Stream& stream, uint32_t, const uint8_t* data, uint64_t size){
+		messages.emplace_back(stream.GetId(),std::string(reinterpret_cast<const char*>(data),size));
+	});
+	
+	client.Associate();
+	Pump();
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	
+	//First data is acknowledged immediately
+	auto& stream = client.OpenStream(1);
+	ASSERT_TRUE(stream.Send(51,reinterpret_cast<const uint8_t*>("0"),1));
+	Pump();
+	ASSERT_EQ(server.GetStats().acknowledgementsSent,1);
+	
+	//Several messages on a single stream are bundled on one packet
+	for (const char* message : {"a","bb","ccc","dddd"})
+		ASSERT_TRUE(stream.Send(51,reinterpret_cast<const uint8_t*>(message),strlen(message)));
+	Pump();
+	//They are acknowledged together when the delayed ack fires
+	ASSERT_EQ(server.GetStats().acknowledgementsSent,1);
+	timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	Pump();
+	ASSERT_EQ(server.GetStats().acknowledgementsSent,2);
+	ASSERT_EQ(server.GetStats().delayedAcknowledgements,1);
+	
+	//A message fragmented in two packets is acknowledged on the second one
+	std::string large(1500,'x');
+	ASSERT_TRUE(stream.Send(51,reinterpret_cast<const uint8_t*>(large.data()),large.size()));
+	Pump();
+	ASSERT_EQ(server.GetStats().acknowledgementsSent,3);
+	ASSERT_EQ(server.GetStats().delayedAcknowledgements,1);
+	
+	//Chunks for different streams take the generic path
+	ASSERT_TRUE(client.OpenStream(2).Send(51,reinterpret_cast<const uint8_t*>("e"),1));
+	ASSERT_TRUE(stream.Send(51,reinterpret_cast<const uint8_t*>("f"),1));
+	Pump();
+	timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	Pump();
+	
+	ASSERT_EQ(messages.size(),8);
+	std::vector<std::pair<uint16_t,std::string>> expected = {{1,"0"},{1,"a"},{1,"bb"},{1,"ccc"},{1,"dddd"},{1,large},{2,"e"},{1,"f"}};
+	ASSERT_EQ(messages,expected);
+	ASSERT_EQ(server.GetStats().chunksReceived[sctp::Chunk::PDATA],9);
+	ASSERT_EQ(client.GetStats().outstandingChunks,0);
+	ASSERT_EQ(server.GetStats().packetsDiscarded,0);
+}
+
+TEST_F(Association, Heartbeat)
+{
+	size_t failures = 0;
+	client.OnPathFailure([&](){ failures++; });
+	
+	client.Associate();
+	Pump();
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	
+	//Only the client sends heartbeats
+	client.SetHeartbeatInterval(1000ms);
+	server.SetHeartbeatInterval(0ms);
+	
+	//Sent after the interval plus the RTO with its jitter
+	Wait(1000ms);
+	ASSERT_EQ(client.GetStats().chunksSent[sctp::Chunk::HEARTBEAT],0);
+	Wait(1000ms);
+	ASSERT_EQ(client.GetStats().chunksSent[sctp::Chunk::HEARTBEAT],1);
+	ASSERT_EQ(server.GetStats().chunksSent[sctp::Chunk::HEARTBEAT],0);
+	//Answered immediately and used as rtt sample
+	ASSERT_EQ(server.GetStats().chunksSent[sctp::Chunk::HEARTBEAT_ACK],1);
+	ASSERT_EQ(client.GetStats().chunksReceived[sctp::Chunk::HEARTBEAT_ACK],1);
+	ASSERT_GT(client.GetStats().smoothedRoundTripTime,0ms);
+	ASSERT_TRUE(client.IsPathActive());
+	
+	//Peer stops answering
+	connected = false;
+	Wait(60000ms);
+	ASSERT_FALSE(client.IsPathActive());
+	ASSERT_EQ(failures,1);
+	//Heartbeats are backed off but not stopped
+	auto sent = client.GetStats().chunksSent[sctp::Chunk::HEARTBEAT];
+	ASSERT_GT(sent,1+sctp::Association::MaxPathRetransmissions);
+	ASSERT_GT(client.GetStats().retransmissionTimeout,sctp::Association::MinRetransmissionTimeout);
+	
+	//Peer is back, next heartbeat ack marks the path active again
+	connected = true;
+	Wait(sctp::Association::MaxRetransmissionTimeout*3/2 + 2000ms);
+	ASSERT_GT(client.GetStats().chunksSent[sctp::Chunk::HEARTBEAT],sent);
+	ASSERT_TRUE(client.IsPathActive());
+	ASSERT_EQ(failures,1);
+	
+	//No heartbeats while data is being sent and acknowledged
+	sent = client.GetStats().chunksSent[sctp::Chunk::HEARTBEAT];
+	auto& stream = client.OpenStream(1);
+	for (size_t i=0; i<50; ++i)
+	{
+		ASSERT_TRUE(stream.Send(51,reinterpret_cast<const uint8_t*>("ping"),4));
+		Wait(200ms);
+	}
+	ASSERT_EQ(client.GetStats().chunksSent[sctp::Chunk::HEARTBEAT],sent);
+	ASSERT_EQ(server.GetStats().packetsDiscarded,0);
+}
+
+TEST_F(Association, Shutdown)
+{
+	std::vector<std::string> messages;
+	server.OnMessage([&](sctp::Stream&, uint32_t, const uint8_t* data, uint64_t size){
+		messages.emplace_back(reinterpret_cast<const char*>(data),size);
+	});
+	size_t clientClosed = 0;
+	size_t serverClosed = 0;
+	client.OnClosed([&](){ clientClosed++; });
+	server.OnClosed([&](){ serverClosed++; });
+	
+	client.Associate();
+	Pump();
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	
+	//Queue messages and shut down before sending any of them
+	auto& stream = client.OpenStream(1);
+	std::string large(4000,'x');
+	ASSERT_TRUE(stream.Send(51,reinterpret_cast<const uint8_t*>("first"),5));
+	ASSERT_TRUE(stream.Send(51,reinterpret_cast<const uint8_t*>(large.data()),large.size()));
+	ASSERT_TRUE(client.Shutdown());
+	ASSERT_EQ(client.GetState(),sctp::Association::ShutdownPending);
+	//No new messages are accepted
+	ASSERT_FALSE(stream.Send(51,reinterpret_cast<const uint8_t*>("late"),4));
+	
+	//Drop the packet with the first DATA chunks, so they are retransmitted before the SHUTDOWN
+	connected = false;
+	uint8_t data[1500];
+	ASSERT_TRUE(client.ReadPacket(data,sizeof(data)));
+	connected = true;
+	
+	//Everything is delivered and acknowledged, then the association is closed on both sides
+	Wait(5000ms);
+	ASSERT_EQ(messages.size(),2);
+	ASSERT_EQ(messages[0],"first");
+	ASSERT_EQ(messages[1],large);
+	ASSERT_EQ(client.GetState(),sctp::Association::Closed);
+	ASSERT_EQ(server.GetState(),sctp::Association::Closed);
+	ASSERT_EQ(clientClosed,1);
+	ASSERT_EQ(serverClosed,1);
+	ASSERT_EQ(client.GetStats().retransmissions,2);
+	ASSERT_EQ(client.GetStats().outstandingChunks,0);
+	ASSERT_EQ(client.GetStats().chunksSent[sctp::Chunk::SHUTDOWN],1);
+	ASSERT_EQ(server.GetStats().chunksSent[sctp::Chunk::SHUTDOWN_ACK],1);
+	ASSERT_EQ(client.GetStats().chunksSent[sctp::Chunk::SHUTDOWN_COMPLETE],1);
+	ASSERT_EQ(server.GetStats().chunksReceived[sctp::Chunk::SHUTDOWN_COMPLETE],1);
+	ASSERT_FALSE(client.Shutdown());
+	
+	//Peer going away while shutting down
+	client.Associate();
+	Pump();
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	ASSERT_EQ(server.GetState(),sctp::Association::Established);
+	connected = false;
+	ASSERT_TRUE(client.Shutdown());
+	ASSERT_EQ(client.GetState(),sctp::Association::ShutDownSent);
+	Wait(sctp::Association::ShutdownGuardTimeout);
+	//SHUTDOWN is retransmitted until giving up, plus the one of the first shutdown
+	ASSERT_EQ(client.GetState(),sctp::Association::Closed);
+	ASSERT_EQ(clientClosed,2);
+	ASSERT_EQ(client.GetStats().chunksSent[sctp::Chunk::SHUTDOWN],2+sctp::Association::MaxAssociationRetransmissions);
+}
+
+TEST_F(Association, ReceiverWindow)
+{
+	size_t messages = 0;
+	server.OnMessage([&](sctp::Stream&, uint32_t, const uint8_t*, uint64_t){
+		messages++;
+	});
+	
+	client.Associate();
+	Pump();
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	ASSERT_EQ(client.GetStats().remoteReceiverWindow,sctp::Association::ReceiverWindow);
+	
+	//Hold first message so everything after it is received out of order
+	uint8_t lost[1500];
+	ASSERT_TRUE(client.OpenStream(1).Send(51,reinterpret_cast<const uint8_t*>("lost"),4));
+	size_t lostSize = client.ReadPacket(lost,sizeof(lost));
+	ASSERT_GT(lostSize,20);
+	uint32_t tsn = lost[16]<<24 | lost[17]<<16 | lost[18]<<8 | lost[19];
+	
+	//Window advertised on the SACKs sent by the server
+	size_t acknowledgements = 0;
+	uint32_t window = 0;
+	auto acknowledge = [&](){
+		uint8_t data[1500];
+		while (size_t len = server.ReadPacket(data,sizeof(data)))
+		{
+			ASSERT_GT(len,24);
+			ASSERT_EQ(data[12],sctp::Chunk::SACK);
+			window = data[20]<<24 | data[21]<<16 | data[22]<<8 | data[23];
+			acknowledgements++;
+		}
+	};
+	
+	//Unordered unfragmented DATA chunks from a peer ignoring the window
+	auto send = [&](uint32_t tsn, size_t size){
+		uint8_t data[1500];
+		uint8_t payload[1000] = {};
+		BufferWritter writter(data,sizeof(data));
+		sctp::PacketHeader header(5000,5000,server.GetLocalVerificationTag());
+		header.Serialize(writter);
+		sctp::PayloadDataChunk::Serialize(writter,0x07,tsn,1,0,51,payload,size);
+		server.WritePacket(data,writter.GetLength());
+		acknowledge();
+	};
+	
+	//Fill the window
+	const size_t size = 1000;
+	const size_t fit = sctp::Association::ReceiverWindow/size;
+	for (size_t i=1; i<=fit; ++i)
+		send(tsn+i,size);
+	ASSERT_EQ(acknowledgements,fit);
+	ASSERT_EQ(window,sctp::Association::ReceiverWindow-fit*size);
+	ASSERT_EQ(server.GetStats().localReceiverWindow,window);
+	ASSERT_EQ(server.GetStats().droppedTransmissionSequenceNumbers,0);
+	
+	//Smaller ones still fit
+	send(tsn+fit+1,sctp::Association::ReceiverWindow-fit*size);
+	ASSERT_EQ(window,0);
+	
+	//Next ones don't fit, they are dropped and acknowledged immediately
+	send(tsn+fit+2,1);
+	send(tsn+fit+3,1);
+	ASSERT_EQ(server.GetStats().droppedTransmissionSequenceNumbers,2);
+	ASSERT_EQ(acknowledgements,fit+3);
+	ASSERT_EQ(window,0);
+	ASSERT_EQ(messages,0);
+	
+	//Lost one arrives and everything held is delivered, opening the window again
+	server.WritePacket(lost,lostSize);
+	timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	acknowledge();
+	ASSERT_EQ(messages,fit+2);
+	ASSERT_EQ(window,sctp::Association::ReceiverWindow);
+	
+	//TSNs that can't be reported on a gap ack block are dropped even if they fit
+	send(tsn+fit+3,1);
+	send(tsn+fit+1+0x10000,1);
+	ASSERT_EQ(server.GetStats().droppedTransmissionSequenceNumbers,3);
+	ASSERT_EQ(window,sctp::Association::ReceiverWindow-1);
+	ASSERT_EQ(server.GetStats().packetsDiscarded,0);
+}
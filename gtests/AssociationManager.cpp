@@ -0,0 +1,223 @@
+/* 
+ * File:   AssociationManager
+ *
+ * Created on 19-oct-2026, 16:21:40
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Buffer.h"
+#include "FakeTimeService.h"
+#include "sctp/AssociationManager.h"
+
+class AssociationManager : public testing::Test
+{
+protected:
+	//Move packets between both managers until there is nothing else to send
+	static size_t Pump(sctp::AssociationManager& a, sctp::AssociationManager& b)
+	{
+		size_t packets = 0;
+		uint8_t data[1500];
+		
+		//Route by tag, INITs have none so use key
+		auto route = [](sctp::AssociationManager& to){
+			return [&to](sctp::AssociationManager::Key key, const uint8_t* packet, size_t len){
+				uint8_t copy[1500];
+				memcpy(copy,packet,len);
+				if (!to.WritePacket(copy,len))
+					to.WritePacket(key,copy,len);
+			};
+		};
+		
+		while (a.HasPendingData() || b.HasPendingData())
+		{
+			packets += a.ReadPackets(data,sizeof(data),route(b));
+			packets += b.ReadPackets(data,sizeof(data),route(a));
+		}
+		return packets;
+	}
+	
+	FakeTimeService timeService;
+};
+
+TEST_F(AssociationManager, Demultiplex)
+{
+	const size_t count = 1000;
+	
+	sctp::AssociationManager clients(timeService);
+	sctp::AssociationManager servers(timeService);
+	
+	for (sctp::AssociationManager::Key key = 0; key<count; ++key)
+	{
+		auto client = clients.Create(key);
+		auto server = servers.Create(key);
+		ASSERT_TRUE(client);
+		ASSERT_TRUE(server);
+		ASSERT_TRUE(client->Associate());
+	}
+	//Keys are unique
+	ASSERT_FALSE(clients.Create(0));
+	ASSERT_EQ(clients.GetCount(),count);
+	
+	Pump(clients,servers);
+	
+	for (sctp::AssociationManager::Key key = 0; key<count; ++key)
+	{
+		ASSERT_EQ(clients.Get(key)->GetState(),sctp::Association::Established);
+		ASSERT_EQ(servers.Get(key)->GetState(),sctp::Association::Established);
+	}
+	
+	//Nothing to do when idle
+	ASSERT_FALSE(clients.HasPendingData());
+	ASSERT_FALSE(servers.HasPendingData());
+	
+	//Send message on a single association
+	std::string received;
+	servers.Get(42)->OnMessage([&](sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size){
+		received.assign((const char*)data,size);
+	});
+	std::string hello = "hello";
+	ASSERT_TRUE(clients.Get(42)->OpenStream(0).Send(51,(const uint8_t*)hello.data(),hello.size()));
+	
+	//Only that one is read
+	uint8_t data[1500];
+	size_t packets = clients.ReadPackets(data,sizeof(data),[&](sctp::AssociationManager::Key key, const uint8_t* packet, size_t len){
+		ASSERT_EQ(key,42);
+		uint8_t copy[1500];
+		memcpy(copy,packet,len);
+		ASSERT_TRUE(servers.WritePacket(copy,len));
+	});
+	ASSERT_EQ(packets,1);
+	ASSERT_EQ(received,hello);
+	
+	//Removed ones are not routed anymore
+	ASSERT_TRUE(servers.Remove(42));
+	ASSERT_FALSE(servers.Get(42));
+	ASSERT_FALSE(servers.Remove(42));
+}
+
+TEST_F(AssociationManager, Submitted)
+{
+	const size_t count = 100;
+	
+	sctp::AssociationManager clients(timeService);
+	sctp::AssociationManager servers(timeService);
+	
+	//Called from the submitting thread
+	std::atomic<size_t> wakeups = 0;
+	clients.OnSubmitted([&](){ ++wakeups; });
+	
+	ASSERT_TRUE(clients.Create(1)->Associate());
+	ASSERT_TRUE(servers.Create(1));
+	Pump(clients,servers);
+	ASSERT_EQ(clients.Get(1)->GetState(),sctp::Association::Established);
+	
+	size_t received = 0;
+	servers.Get(1)->OnMessage([&](sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size){
+		++received;
+	});
+	
+	//Submit from other thread while this one reads
+	auto client = clients.Get(1);
+	client->OpenStream(0);
+	std::thread producer([&](){
+		for (size_t i=0; i<count; ++i)
+			client->Submit(0,51,datachannels::CreatePayload((const uint8_t*)"hello",5));
+	});
+	while (received<count)
+		Pump(clients,servers);
+	producer.join();
+	
+	//Woken up at least once, but not once per message
+	ASSERT_GE(wakeups,1);
+	ASSERT_LE(wakeups,count);
+	ASSERT_FALSE(clients.HasPendingData());
+}
+
+TEST_F(AssociationManager, SubmitWhileMoving)
+{
+	const size_t count = 1000;
+	
+	sctp::AssociationManager first(timeService);
+	sctp::AssociationManager second(timeService);
+	sctp::AssociationManager servers(timeService);
+	
+	//Called from the submitting thread, not at all if it is being moved
+	std::atomic<size_t> wakeups = 0;
+	first.OnSubmitted([&](){ ++wakeups; });
+	second.OnSubmitted([&](){ ++wakeups; });
+	
+	ASSERT_TRUE(first.Create(1)->Associate());
+	ASSERT_TRUE(servers.Create(1));
+	Pump(first,servers);
+	ASSERT_EQ(first.Get(1)->GetState(),sctp::Association::Established);
+	first.Get(1)->OpenStream(0);
+	
+	size_t received = 0;
+	servers.Get(1)->OnMessage([&](sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size){
+		++received;
+	});
+	
+	//Submit from other thread while this one moves the association between managers
+	auto client = first.Get(1);
+	std::thread producer([&](){
+		for (size_t i=0; i<count; ++i)
+			client->Submit(0,51,datachannels::CreatePayload((const uint8_t*)"hello",5));
+	});
+	sctp::AssociationManager* from = &first;
+	sctp::AssociationManager* to = &second;
+	while (received<count)
+	{
+		ASSERT_TRUE(to->Adopt(1,from->Release(1)));
+		std::swap(from,to);
+		Pump(*from,servers);
+	}
+	producer.join();
+	
+	//Messages submitted while it was not managed are picked up on adoption
+	ASSERT_EQ(received,count);
+}
+
+TEST_F(AssociationManager, RemoveFromCallbacks)
+{
+	sctp::AssociationManager clients(timeService);
+	sctp::AssociationManager servers(timeService);
+	
+	for (sctp::AssociationManager::Key key = 1; key<=2; ++key)
+	{
+		ASSERT_TRUE(clients.Create(key)->Associate());
+		ASSERT_TRUE(servers.Create(key));
+	}
+	Pump(clients,servers);
+	ASSERT_EQ(clients.Get(1)->GetState(),sctp::Association::Established);
+	ASSERT_EQ(clients.Get(2)->GetState(),sctp::Association::Established);
+	
+	//Removed while processing its message
+	size_t received = 0;
+	servers.Get(1)->OnMessage([&](sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size){
+		received++;
+		servers.Remove(1);
+	});
+	ASSERT_TRUE(clients.Get(1)->OpenStream(0).Send(51,(const uint8_t*)"hello",5));
+	Pump(clients,servers);
+	ASSERT_EQ(received,1);
+	ASSERT_FALSE(servers.Get(1));
+	ASSERT_TRUE(servers.Get(2));
+	
+	//Removed while sending its first packet of several
+	std::string large(3000,'x');
+	ASSERT_TRUE(clients.Get(2)->OpenStream(0).Send(51,(const uint8_t*)large.data(),large.size()));
+	uint8_t data[1500];
+	size_t sent = 0;
+	size_t packets = clients.ReadPackets(data,sizeof(data),[&](sctp::AssociationManager::Key key, const uint8_t* packet, size_t len){
+		sent++;
+		clients.Remove(key);
+	});
+	ASSERT_EQ(packets,1);
+	ASSERT_EQ(sent,1);
+	ASSERT_FALSE(clients.Get(2));
+	ASSERT_TRUE(clients.Get(1));
+}
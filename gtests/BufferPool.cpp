@@ -0,0 +1,147 @@
+/*
+ * File:   BufferPool
+ *
+ * Created on 19-oct-2026, 21:14:08
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "Buffer.h"
+#include "BufferPool.h"
+
+class BufferPools : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		//Start with empty lists
+		BufferPool::GetInstance().Trim();
+	}
+};
+
+// Counts the blocks it hands out
+class CountingAllocator : public BufferAllocator
+{
+public:
+	virtual uint8_t* Allocate(size_t size, size_t& capacity) override
+	{
+		allocated++;
+		return SystemAllocator::GetInstance().Allocate(size,capacity);
+	}
+
+	virtual void Release(uint8_t* data, size_t capacity) override
+	{
+		released++;
+		SystemAllocator::GetInstance().Release(data,capacity);
+	}
+
+	size_t allocated = 0;
+	size_t released  = 0;
+};
+
+TEST_F(BufferPools, SizeClasses)
+{
+	ASSERT_EQ(Buffer(1).GetCapacity(),64);
+	ASSERT_EQ(Buffer(65).GetCapacity(),256);
+	ASSERT_EQ(Buffer(1200).GetCapacity(),1216);
+	ASSERT_EQ(Buffer(1217).GetCapacity(),1536);
+	ASSERT_EQ(Buffer(16*1024).GetCapacity(),16*1024);
+	//Too big for the pool
+	ASSERT_EQ(Buffer(16*1024+1).GetCapacity(),16*1024+64);
+}
+
+TEST_F(BufferPools, Reuse)
+{
+	auto& pool = BufferPool::GetInstance();
+	auto before = pool.GetStats();
+
+	uint8_t* data = nullptr;
+	{
+		Buffer buffer(1200);
+		data = buffer.GetData();
+	}
+	ASSERT_EQ(pool.GetStats().cached,before.cached+1);
+
+	//Same block is given again
+	Buffer buffer(1000);
+	ASSERT_EQ(buffer.GetData(),data);
+
+	auto after = pool.GetStats();
+	ASSERT_EQ(after.allocated,before.allocated+1);
+	ASSERT_EQ(after.recycled,before.recycled+1);
+	ASSERT_EQ(after.reused,before.reused+1);
+	ASSERT_EQ(after.cached,before.cached);
+
+	//Large buffers are not cached
+	{
+		Buffer large(64*1024);
+	}
+	ASSERT_EQ(pool.GetStats().cached,before.cached);
+
+	pool.Trim();
+	ASSERT_EQ(pool.GetStats().cached,0);
+}
+
+TEST_F(BufferPools, Grow)
+{
+	Buffer buffer(64);
+	const uint8_t data[100] = {};
+	size_t grown = 0;
+	size_t capacity = buffer.GetCapacity();
+	for (size_t i=0; i<100; ++i)
+	{
+		buffer.AppendData(static_cast<const uint8_t*>(data),sizeof(data));
+		if (buffer.GetCapacity()!=capacity)
+		{
+			capacity = buffer.GetCapacity();
+			grown++;
+		}
+	}
+	ASSERT_EQ(buffer.GetSize(),100*sizeof(data));
+	//Geometric growth
+	ASSERT_LE(grown,10);
+	for (size_t i=0; i<buffer.GetSize(); ++i)
+		ASSERT_EQ(buffer.GetData()[i],0);
+}
+
+TEST_F(BufferPools, CrossThread)
+{
+	auto& pool = BufferPool::GetInstance();
+	auto before = pool.GetStats();
+
+	//Allocated on another thread, released here
+	Buffer buffer;
+	std::thread([&](){ buffer = Buffer(256); }).join();
+	buffer.Release();
+
+	//It is on our list now
+	ASSERT_EQ(pool.GetStats().cached,before.cached+1);
+	ASSERT_EQ(pool.GetStats().recycled,before.recycled+1);
+}
+
+TEST_F(BufferPools, Allocator)
+{
+	CountingAllocator allocator;
+	{
+		Buffer buffer(100,&allocator);
+		ASSERT_EQ(buffer.GetAllocator(),&allocator);
+		buffer.SetSize(2000);
+		//Clones keep the allocator
+		Buffer clone = buffer.Clone();
+		ASSERT_EQ(clone.GetAllocator(),&allocator);
+	}
+	ASSERT_EQ(allocator.allocated,3);
+	ASSERT_EQ(allocator.released,3);
+
+	//Change the default one
+	Buffer::SetDefaultAllocator(&allocator);
+	{
+		Buffer buffer(10);
+	}
+	Buffer::SetDefaultAllocator(nullptr);
+	ASSERT_EQ(allocator.allocated,4);
+	ASSERT_EQ(allocator.released,4);
+	ASSERT_EQ(Buffer::GetDefaultAllocator(),&BufferPool::GetInstance());
+}
@@ -0,0 +1,125 @@
+/*
+ * File:   Capture
+ *
+ * Created on 19-oct-2026, 22:37:05
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "Buffer.h"
+#include "Capture.h"
+#include "FakeTimeService.h"
+#include "sctp/Association.h"
+
+using namespace datachannels;
+
+class PacketCapture : public testing::Test
+{
+protected:
+	//Read an integer in host order from the capture
+	template<typename T>
+	static T Get(const std::vector<uint8_t>& file, size_t pos)
+	{
+		T value;
+		memcpy(&value,file.data()+pos,sizeof(T));
+		return value;
+	}
+	
+	static std::vector<uint8_t> Load(const char* filename)
+	{
+		std::vector<uint8_t> file;
+		FILE* f = fopen(filename,"rb");
+		uint8_t data[4096];
+		while (size_t len = fread(data,1,sizeof(data),f))
+			file.insert(file.end(),data,data+len);
+		fclose(f);
+		return file;
+	}
+};
+
+TEST_F(PacketCapture, Pcapng)
+{
+	const char* filename = "/tmp/datachannels-capture-test.pcapng";
+	
+	FakeTimeService timeService;
+	sctp::Association client(timeService);
+	sctp::Association server(timeService);
+	client.SetLocalPort(5000);
+	client.SetRemotePort(5001);
+	server.SetLocalPort(5001);
+	server.SetRemotePort(5000);
+	
+	auto capture = Capture::Open(filename);
+	ASSERT_TRUE(capture);
+	client.SetCapture(capture);
+	
+	uint8_t data[1500];
+	client.Associate();
+	Buffer message(3000);
+	message.SetSize(message.GetCapacity());
+	client.OpenStream(1).Send(51,message.GetData(),message.GetSize());
+	while (client.HasPendingData() || server.HasPendingData())
+	{
+		if (size_t len = client.ReadPacket(data,sizeof(data)))
+			server.WritePacket(data,len);
+		if (size_t len = server.ReadPacket(data,sizeof(data)))
+			client.WritePacket(data,len);
+	}
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	
+	//Wait until it is on disk
+	capture->Flush();
+	auto file = Load(filename);
+	auto stats = client.GetStats();
+	
+	//Section header and raw IPv4 interface
+	ASSERT_GE(file.size(),48);
+	ASSERT_EQ(Get<uint32_t>(file,0),0x0A0D0D0A);
+	ASSERT_EQ(Get<uint32_t>(file,8),0x1A2B3C4D);
+	ASSERT_EQ(Get<uint32_t>(file,28),1);
+	ASSERT_EQ(Get<uint16_t>(file,36),228);
+	
+	//Walk enhanced packet blocks
+	size_t inbound = 0;
+	size_t outbound = 0;
+	size_t pos = 48;
+	while (pos<file.size())
+	{
+		ASSERT_EQ(Get<uint32_t>(file,pos),6);
+		uint32_t length = Get<uint32_t>(file,pos+4);
+		uint32_t captured = Get<uint32_t>(file,pos+20);
+		ASSERT_EQ(Get<uint32_t>(file,pos+length-4),length);
+		
+		//IPv4 carrying UDP on the sctp tunneling port
+		const uint8_t* ip = file.data()+pos+28;
+		ASSERT_EQ(ip[0],0x45);
+		ASSERT_EQ(ip[9],17);
+		ASSERT_EQ(ip[22]<<8 | ip[23],Capture::Port);
+		
+		//Check source port of the sctp header against the flags option
+		uint16_t source = ip[28]<<8 | ip[29];
+		uint32_t flags = Get<uint32_t>(file,pos+28+((captured+3)&~3)+4);
+		if (flags==Capture::Inbound)
+		{
+			ASSERT_EQ(source,5001);
+			inbound++;
+		} else {
+			ASSERT_EQ(flags,Capture::Outbound);
+			ASSERT_EQ(source,5000);
+			outbound++;
+		}
+		pos += length;
+	}
+	ASSERT_EQ(pos,file.size());
+	ASSERT_EQ(inbound,stats.packetsReceived);
+	ASSERT_EQ(outbound,stats.packetsSent);
+	
+	//Nothing more is written once detached
+	client.SetCapture(nullptr);
+	capture.reset();
+	ASSERT_EQ(Load(filename).size(),file.size());
+	remove(filename);
+}
@@ -277,6 +277,48 @@ TEST_F(Chunks, SerializeCookieAck)
 	
 }
 
+TEST_F(Chunks, SerializeShutdown)
+{
+	Buffer buffer(1200);
+	//Create chunks
+	sctp::ShutdownAssociationChunk shutdown;
+	shutdown.cumulativeTrasnmissionSequenceNumberAck = 0x01020304;
+	sctp::ShutdownCompleteChunk complete;
+	complete.verificationTag = true;
+	
+	//Serialize
+	BufferWritter writter(buffer);
+	ASSERT_TRUE(shutdown.Serialize(writter));
+	ASSERT_TRUE(complete.Serialize(writter));
+	ASSERT_EQ(writter.GetLength(),shutdown.GetSize()+complete.GetSize());
+	buffer.SetSize(writter.GetLength());
+	
+	//Check wire format
+	const uint8_t expected[] = {
+		0x07, 0x00, 0x00, 0x08,
+		0x01, 0x02, 0x03, 0x04,
+		0x0e, 0x01, 0x00, 0x04,
+	};
+	ASSERT_EQ(buffer.GetSize(),sizeof(expected));
+	ASSERT_EQ(memcmp(buffer.GetData(),expected,sizeof(expected)),0);
+	
+	//Parse them again
+	BufferReader reader(buffer);
+	auto chunk = sctp::Chunk::Parse(reader);
+	ASSERT_TRUE(chunk);
+	ASSERT_EQ(chunk->type,sctp::Chunk::SHUTDOWN);
+	ASSERT_EQ(std::static_pointer_cast<sctp::ShutdownAssociationChunk>(chunk)->cumulativeTrasnmissionSequenceNumberAck,0x01020304);
+	chunk = sctp::Chunk::Parse(reader);
+	ASSERT_TRUE(chunk);
+	ASSERT_EQ(chunk->type,sctp::Chunk::SHUTDOWN_COMPLETE);
+	ASSERT_TRUE(std::static_pointer_cast<sctp::ShutdownCompleteChunk>(chunk)->verificationTag);
+	ASSERT_FALSE(reader.GetLeft());
+	
+	//Truncated
+	BufferReader truncated(buffer.GetData(),7);
+	ASSERT_FALSE(sctp::Chunk::Parse(truncated));
+}
+
 //
 //TEST_F(Chunks, SparseHeartbeatRequest)
 //{
@@ -451,3 +493,89 @@ TEST_F(Chunks, ParsePayloadData)
 
 }
 
+
+TEST_F(Chunks, Index)
+{
+	uint8_t data[] = {
+		//DATA with 3 bytes of user data and padding
+		0x00, 0x03, 0x00, 0x13,
+		0x00, 0x00, 0x00, 0x01,
+		0x00, 0x01, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x33,
+		0x61, 0x62, 0x63, 0x00,
+		//COOKIE ACK
+		0x0b, 0x00, 0x00, 0x04,
+	};
+	
+	std::vector<sctp::Chunk::IndexEntry> index;
+	
+	BufferReader reader(data,sizeof(data));
+	ASSERT_TRUE(sctp::Chunk::Index(reader,index));
+	ASSERT_EQ(index.size(),2);
+	ASSERT_EQ(index[0].type,sctp::Chunk::PDATA);
+	ASSERT_EQ(index[0].flag,0x03);
+	ASSERT_EQ(index[0].length,19);
+	ASSERT_EQ(index[0].offset,0);
+	ASSERT_EQ(index[1].type,sctp::Chunk::COOKIE_ACK);
+	ASSERT_EQ(index[1].length,4);
+	ASSERT_EQ(index[1].offset,20);
+	//Reader is not moved
+	ASSERT_EQ(reader.Mark(),0);
+	
+	//Last chunk without its padding
+	BufferReader unpadded(data,sizeof(data)-5);
+	ASSERT_FALSE(sctp::Chunk::Index(unpadded,index));
+	
+	//Chunk length past the end of the packet
+	data[3] = 0x20;
+	ASSERT_FALSE(sctp::Chunk::Index(BufferReader(data,sizeof(data)),index));
+	
+	//DATA shorter than its header
+	data[3] = 0x08;
+	ASSERT_FALSE(sctp::Chunk::Index(BufferReader(data,sizeof(data)),index));
+	
+	//Length smaller than the chunk header
+	data[3] = 0x13;
+	data[23] = 0x02;
+	ASSERT_FALSE(sctp::Chunk::Index(BufferReader(data,sizeof(data)),index));
+}
+
+TEST_F(Chunks, ParseSackGaps)
+{
+	uint8_t data[] = {
+		0x03, 0x00, 0x00, 0x1C,		//SACK length 28
+		0x01, 0x02, 0x03, 0x04,		//Cumulative TSN ack
+		0x00, 0x00, 0xFF, 0xFF,		//a_rwnd
+		0x00, 0x02, 0x00, 0x01,		//2 gaps, 1 duplicate
+		0x00, 0x02, 0x00, 0x03,		//Gap 2-3
+		0x00, 0x05, 0x00, 0x05,		//Gap 5-5
+		0x01, 0x02, 0x03, 0x00,		//Duplicate TSN
+	};
+	
+	sctp::SelectiveAcknowledgementChunk sack;
+	BufferReader reader(data,sizeof(data));
+	ASSERT_TRUE(sctp::SelectiveAcknowledgementChunk::Parse(reader,sack));
+	ASSERT_EQ(sack.cumulativeTrasnmissionSequenceNumberAck,0x01020304);
+	ASSERT_EQ(sack.adveritsedReceiverWindowCredit,0xFFFF);
+	ASSERT_EQ(sack.gapAckBlocks.size(),2);
+	ASSERT_EQ(sack.gapAckBlocks[0].first,2);
+	ASSERT_EQ(sack.gapAckBlocks[0].second,3);
+	ASSERT_EQ(sack.gapAckBlocks[1].first,5);
+	ASSERT_EQ(sack.gapAckBlocks[1].second,5);
+	ASSERT_EQ(sack.duplicateTuplicateTrasnmissionSequenceNumbers.size(),1);
+	ASSERT_EQ(sack.duplicateTuplicateTrasnmissionSequenceNumbers[0],0x01020300);
+	
+	//Serialize it back
+	uint8_t out[sizeof(data)];
+	BufferWritter writter(out,sizeof(out));
+	ASSERT_EQ(sack.Serialize(writter),sizeof(data));
+	ASSERT_EQ(memcmp(out,data,sizeof(data)),0);
+	
+	//Not enough room for it
+	BufferWritter small(out,sizeof(out)-1);
+	ASSERT_EQ(sack.Serialize(small),0);
+	
+	//Gaps and duplicates past the end
+	BufferReader truncated(data,sizeof(data)-4);
+	ASSERT_FALSE(sctp::SelectiveAcknowledgementChunk::Parse(truncated,sack));
+}
@@ -0,0 +1,370 @@
+/* 
+ * File:   Endpoint
+ *
+ * Created on 19-oct-2026, 13:02:17
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Buffer.h"
+#include "FakeTimeService.h"
+#include "Endpoint.h"
+
+class Endpoint : public testing::Test
+{
+protected:
+	//Move packets between both endpoints until there is nothing else to send
+	static size_t Pump(datachannels::Endpoint& a, datachannels::Endpoint& b)
+	{
+		size_t packets = 0;
+		uint8_t data[1500];
+		
+		bool pending = true;
+		while (pending)
+		{
+			pending = false;
+			//From a to b
+			while (size_t len = a.GetTransport().ReadPacket(data,sizeof(data)))
+			{
+				b.GetTransport().WritePacket(data,len);
+				packets++;
+				pending = true;
+			}
+			//From b to a
+			while (size_t len = b.GetTransport().ReadPacket(data,sizeof(data)))
+			{
+				a.GetTransport().WritePacket(data,len);
+				packets++;
+				pending = true;
+			}
+		}
+		return packets;
+	}
+	
+	void Connect()
+	{
+		client = datachannels::Endpoint::Create(timeService);
+		server = datachannels::Endpoint::Create(timeService);
+		
+		ASSERT_TRUE(server->Init({5000,5000,datachannels::Server}));
+		ASSERT_TRUE(client->Init({5000,5000,datachannels::Client}));
+		
+		//Do handshake
+		ASSERT_TRUE(Pump(*client,*server));
+	}
+	
+	FakeTimeService timeService;
+	datachannels::Endpoint::shared client;
+	datachannels::Endpoint::shared server;
+};
+
+
+TEST_F(Endpoint, Negotiated)
+{
+	Connect();
+	
+	datachannels::Datachannel::Options options;
+	options.negotiated = true;
+	options.id = 7;
+	
+	auto local  = client->CreateDatachannel(options);
+	auto remote = server->CreateDatachannel(options);
+	ASSERT_TRUE(local);
+	ASSERT_TRUE(remote);
+	ASSERT_EQ(local->GetId(),7);
+	ASSERT_EQ(remote->GetId(),7);
+	
+	//Can't reuse same id
+	ASSERT_FALSE(client->CreateDatachannel(options));
+	
+	std::string received;
+	remote->OnMessage([&](datachannels::Datachannel::MessageType type, const uint8_t* data, uint64_t size){
+		ASSERT_EQ(type,datachannels::Datachannel::UTF8);
+		received.assign((const char*)data,size);
+	});
+	
+	std::string hello = "hello";
+	ASSERT_TRUE(local->Send(datachannels::Datachannel::UTF8,(const uint8_t*)hello.data(),hello.size()));
+	Pump(*client,*server);
+	
+	ASSERT_EQ(received,hello);
+}
+
+TEST_F(Endpoint, LargeMessage)
+{
+	Connect();
+	
+	datachannels::Datachannel::Options options;
+	options.negotiated = true;
+	options.id = 1;
+	
+	auto local  = client->CreateDatachannel(options);
+	auto remote = server->CreateDatachannel(options);
+	
+	//Message bigger than the initial congestion window
+	Buffer message(64*1024);
+	message.SetSize(message.GetCapacity());
+	for (size_t i=0; i<message.GetSize(); ++i)
+		message.GetData()[i] = i;
+	
+	size_t received = 0;
+	remote->OnMessage([&](datachannels::Datachannel::MessageType type, const uint8_t* data, uint64_t size){
+		ASSERT_EQ(type,datachannels::Datachannel::Binary);
+		ASSERT_EQ(size,message.GetSize());
+		ASSERT_EQ(memcmp(data,message.GetData(),size),0);
+		received++;
+	});
+	
+	ASSERT_TRUE(local->Send(datachannels::Datachannel::Binary,message.GetData(),message.GetSize()));
+	ASSERT_TRUE(local->Send(datachannels::Datachannel::Binary,message.GetData(),message.GetSize()));
+	
+	//Pump and let delayed sacks fire
+	for (size_t i=0; i<100 && received<2; ++i)
+	{
+		Pump(*client,*server);
+		timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	}
+	
+	ASSERT_EQ(received,2);
+}
+
+TEST_F(Endpoint, InBand)
+{
+	Connect();
+	
+	datachannels::Datachannel::Options options;
+	options.label = "chat";
+	options.protocol = "text";
+	options.ordered = false;
+	options.maxRetransmits = 3;
+	
+	//Client uses even ids
+	auto first  = client->CreateDatachannel(options);
+	auto second = client->CreateDatachannel(options);
+	ASSERT_TRUE(first);
+	ASSERT_TRUE(second);
+	ASSERT_EQ(first->GetId(),0);
+	ASSERT_EQ(second->GetId(),2);
+	
+	//Server uses odd ones
+	auto third = server->CreateDatachannel(options);
+	ASSERT_TRUE(third);
+	ASSERT_EQ(third->GetId(),1);
+	
+	//Data can be sent before the ack is received
+	ASSERT_TRUE(first->Send(datachannels::Datachannel::Binary));
+	
+	Pump(*client,*server);
+	
+	//Ack received
+	ASSERT_TRUE(std::static_pointer_cast<datachannels::impl::Datachannel>(first)->IsAcknowledged());
+	ASSERT_TRUE(std::static_pointer_cast<datachannels::impl::Datachannel>(third)->IsAcknowledged());
+}
+
+TEST_F(Endpoint, OnDatachannel)
+{
+	Connect();
+	
+	std::string received;
+	datachannels::Datachannel::shared opened;
+	server->OnDatachannel([&](const datachannels::Datachannel::shared& datachannel){
+		opened = datachannel;
+		//Set listener inside the event, user data may follow the open in the same packet
+		opened->OnMessage([&](datachannels::Datachannel::MessageType type, const uint8_t* data, uint64_t size){
+			received.assign((const char*)data,size);
+		});
+	});
+	
+	datachannels::Datachannel::Options options;
+	options.label = "chat";
+	options.protocol = "text";
+	
+	auto local = client->CreateDatachannel(options);
+	ASSERT_TRUE(local);
+	
+	std::string hello = "hello";
+	ASSERT_TRUE(local->Send(datachannels::Datachannel::UTF8,(const uint8_t*)hello.data(),hello.size()));
+	
+	Pump(*client,*server);
+	
+	//Event launched with the remote options
+	ASSERT_TRUE(opened);
+	ASSERT_EQ(opened->GetId(),local->GetId());
+	ASSERT_EQ(opened->GetOptions().label,"chat");
+	ASSERT_EQ(opened->GetOptions().protocol,"text");
+	ASSERT_EQ(received,hello);
+}
+
+TEST_F(Endpoint, ThreadSafeSend)
+{
+	client = datachannels::Endpoint::Create(timeService);
+	server = datachannels::Endpoint::Create(timeService);
+	
+	datachannels::Endpoint::Options clientOptions = {5000,5000,datachannels::Client};
+	clientOptions.threadSafeSend = true;
+	ASSERT_TRUE(server->Init({5000,5000,datachannels::Server}));
+	ASSERT_TRUE(client->Init(clientOptions));
+	
+	//Count wake ups from the sending threads
+	std::atomic<size_t> signaled{0};
+	client->GetTransport().OnPendingData([&](){ signaled++; });
+	
+	Pump(*client,*server);
+	
+	datachannels::Datachannel::Options options;
+	options.negotiated = true;
+	options.id = 3;
+	auto local  = client->CreateDatachannel(options);
+	auto remote = server->CreateDatachannel(options);
+	
+	static constexpr const size_t Threads = 4;
+	static constexpr const size_t Messages = 200;
+	
+	//Last message received from each thread
+	std::vector<int> last(Threads,-1);
+	size_t received = 0;
+	remote->OnMessage([&](datachannels::Datachannel::MessageType type, const uint8_t* data, uint64_t size){
+		ASSERT_EQ(size,sizeof(uint32_t)*2);
+		uint32_t message[2];
+		memcpy(message,data,size);
+		//Messages of each thread are delivered in order
+		ASSERT_EQ(message[1],last[message[0]]+1);
+		last[message[0]] = message[1];
+		received++;
+	});
+	
+	//Send from several threads while this one owns the transport
+	std::atomic<size_t> running{Threads};
+	std::vector<std::thread> threads;
+	for (uint32_t i=0; i<Threads; ++i)
+		threads.emplace_back([&,i](){
+			for (uint32_t j=0; j<Messages; ++j)
+			{
+				uint32_t message[2] = {i,j};
+				ASSERT_TRUE(local->Send(datachannels::Datachannel::Binary,(const uint8_t*)message,sizeof(message)));
+			}
+			running--;
+		});
+	
+	//Pump while they are sending
+	while (running)
+		Pump(*client,*server);
+	
+	for (auto& thread : threads)
+		thread.join();
+	
+	//Deliver the rest and let delayed sacks fire
+	for (size_t i=0; i<1000 && received<Threads*Messages; ++i)
+	{
+		Pump(*client,*server);
+		timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	}
+	
+	ASSERT_EQ(received,Threads*Messages);
+	ASSERT_GT(signaled,0);
+}
+
+TEST_F(Endpoint, MessageOwnership)
+{
+	Connect();
+	
+	datachannels::Datachannel::Options options;
+	options.negotiated = true;
+	options.id = 5;
+	
+	auto local  = client->CreateDatachannel(options);
+	auto remote = server->CreateDatachannel(options);
+	
+	//One fragmented and one in a single chunk
+	Buffer large(16*1024);
+	large.SetSize(large.GetCapacity());
+	for (size_t i=0; i<large.GetSize(); ++i)
+		large.GetData()[i] = i;
+	std::string small = "small";
+	
+	std::vector<Buffer> received;
+	size_t raw = 0;
+	remote->OnMessage([&](datachannels::Datachannel::MessageType type, const uint8_t* data, uint64_t size){
+		raw++;
+	});
+	remote->OnMessage([&](datachannels::Datachannel::MessageType type, Buffer&& message){
+		received.push_back(std::move(message));
+	});
+	
+	ASSERT_TRUE(local->Send(datachannels::Datachannel::Binary,large.GetData(),large.GetSize()));
+	ASSERT_TRUE(local->Send(datachannels::Datachannel::UTF8,(const uint8_t*)small.data(),small.size()));
+	ASSERT_TRUE(local->Send(datachannels::Datachannel::Binary));
+	
+	for (size_t i=0; i<100 && received.size()<3; ++i)
+	{
+		Pump(*client,*server);
+		timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	}
+	
+	//Both handlers called
+	ASSERT_EQ(raw,3);
+	ASSERT_EQ(received.size(),3);
+	ASSERT_EQ(received[0].GetSize(),large.GetSize());
+	ASSERT_EQ(memcmp(received[0].GetData(),large.GetData(),large.GetSize()),0);
+	ASSERT_EQ(std::string((const char*)received[1].GetData(),received[1].GetSize()),small);
+	ASSERT_TRUE(received[2].IsEmpty());
+	
+	//Reassembly buffer was moved instead of copied
+	auto& stream = std::static_pointer_cast<datachannels::impl::Datachannel>(remote)->stream;
+	ASSERT_EQ(stream.incomingMessage.GetData(),nullptr);
+}
+
+TEST_F(Endpoint, SharedPayload)
+{
+	static constexpr const size_t Channels = 8;
+	
+	Connect();
+	
+	//Same payload on many channels
+	Buffer message(4000);
+	message.SetSize(message.GetCapacity());
+	for (size_t i=0; i<message.GetSize(); ++i)
+		message.GetData()[i] = i;
+	auto payload = datachannels::CreatePayload(std::move(message));
+	
+	std::vector<datachannels::Datachannel::shared> locals;
+	std::vector<datachannels::Datachannel::shared> remotes;
+	size_t received = 0;
+	for (uint16_t id=0; id<Channels; ++id)
+	{
+		datachannels::Datachannel::Options options;
+		options.negotiated = true;
+		options.id = id;
+		locals.push_back(client->CreateDatachannel(options));
+		remotes.push_back(server->CreateDatachannel(options));
+		remotes.back()->OnMessage([&](datachannels::Datachannel::MessageType type, const uint8_t* data, uint64_t size){
+			ASSERT_EQ(type,datachannels::Datachannel::Binary);
+			ASSERT_EQ(size,payload->GetSize());
+			ASSERT_EQ(memcmp(data,payload->GetData(),size),0);
+			received++;
+		});
+	}
+	
+	for (auto& local : locals)
+		ASSERT_TRUE(local->Send(datachannels::Datachannel::Binary,payload));
+	
+	//Queued by reference
+	ASSERT_EQ(payload.use_count(),Channels+1);
+	
+	for (size_t i=0; i<100 && received<Channels; ++i)
+	{
+		Pump(*client,*server);
+		timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	}
+	ASSERT_EQ(received,Channels);
+	
+	//Let the last delayed sack reach the sender
+	timeService.SetNow(timeService.GetNow() + sctp::Association::SackTimeout);
+	Pump(*client,*server);
+	
+	//Released once all fragments have been acknowledged
+	ASSERT_EQ(payload.use_count(),1);
+}
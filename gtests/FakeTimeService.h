@@ -1,6 +1,10 @@
 #ifndef FAKETIMESERVICE_H
 #define FAKETIMESERVICE_H
 
+#include <map>
+#include <optional>
+#include <vector>
+
 #include "Datachannels.h"
 
 using namespace std::chrono_literals;
@@ -126,6 +130,15 @@ public:
 		return now;
 	};
 	
+	std::optional<std::chrono::milliseconds> GetNextDeadline() const
+	{
+		//If no timer is scheduled
+		if (timers.empty())
+			return std::nullopt;
+		//Get first one
+		return timers.begin()->first;
+	}
+	
 	virtual datachannels::Timer::shared CreateTimer(std::function<void(std::chrono::milliseconds)> callback) override
 	{
 		//Create timer without scheduling it
@@ -157,7 +170,7 @@ public:
 
 private:
 	std::multimap<std::chrono::milliseconds,TimerImpl::shared> timers;
-	std::chrono::milliseconds now;
+	std::chrono::milliseconds now = 0ms;
 };
 
 #endif /* FAKETIMESERVICE_H */
@@ -0,0 +1,286 @@
+#ifndef NETWORKSIMULATOR_H
+#define NETWORKSIMULATOR_H
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "Buffer.h"
+#include "BufferReader.h"
+#include "FakeTimeService.h"
+#include "sctp/Association.h"
+
+// Deterministic packet level simulator
+//	Links two associations through a pair of simulated links and runs them in
+//	virtual time on a FakeTimeService, so the same seed always produces the
+//	same packet trace and the same report.
+class NetworkSimulator
+{
+public:
+	struct Link
+	{
+		std::chrono::milliseconds delay		= 20ms;
+		// Uniform random extra delay, packets are not reordered by it
+		std::chrono::milliseconds jitter	= 0ms;
+		double loss				= 0;
+		// Probability of a packet being delayed past the following ones
+		double reorder				= 0;
+		std::chrono::milliseconds reorderDelay	= 10ms;
+		// Bits per second, 0 for unlimited
+		uint64_t bandwidth			= 0;
+		size_t mtu				= 1200;
+	};
+	
+	struct Workload
+	{
+		size_t messages				= 100;
+		size_t size				= 1024;
+		// Time between messages, 0 to send all of them at once
+		std::chrono::milliseconds interval	= 0ms;
+		std::chrono::milliseconds timeout	= 60000ms;
+	};
+	
+	struct Report
+	{
+		size_t sent				= 0;
+		size_t delivered			= 0;
+		bool inOrder				= true;
+		std::chrono::milliseconds duration	= 0ms;
+		// Application bytes per second
+		double goodput				= 0;
+		// Message latency percentiles
+		std::chrono::milliseconds p50		= 0ms;
+		std::chrono::milliseconds p90		= 0ms;
+		std::chrono::milliseconds p99		= 0ms;
+		std::chrono::milliseconds max		= 0ms;
+		size_t packets				= 0;
+		size_t lost				= 0;
+		size_t dataChunks			= 0;
+		size_t retransmissions			= 0;
+		size_t sacks				= 0;
+	};
+private:
+	struct Direction
+	{
+		sctp::Association* from = nullptr;
+		sctp::Association* to = nullptr;
+		Link link;
+		//Time when the link is free to send next packet
+		std::chrono::microseconds busy		= 0us;
+		//Last in order delivery time
+		std::chrono::milliseconds last		= 0ms;
+		//TSNs already seen for detecting retransmissions
+		std::set<uint32_t> transmitted;
+	};
+	struct Packet
+	{
+		Direction* direction;
+		Buffer data;
+	};
+public:
+	NetworkSimulator(FakeTimeService& timeService, uint32_t seed = 1) :
+		timeService(timeService),
+		gen(seed)
+	{
+	}
+	
+	void Connect(sctp::Association& a, sctp::Association& b, const Link& ab, const Link& ba)
+	{
+		forward.from  = &a; forward.to  = &b; forward.link  = ab;
+		backward.from = &b; backward.to = &a; backward.link = ba;
+	}
+	
+	// Run until there is nothing else to send or the condition is met
+	bool Run(std::chrono::milliseconds timeout, const std::function<bool()>& done)
+	{
+		auto end = timeService.GetNow() + timeout;
+		while (!done())
+		{
+			//Send all pending packets
+			Flush(forward);
+			Flush(backward);
+			
+			//Get next event
+			auto next = end;
+			if (!packets.empty())
+				next = std::min(next,packets.begin()->first);
+			if (auto deadline = timeService.GetNextDeadline())
+				next = std::min(next,*deadline);
+			if (next>=end)
+				return done();
+			
+			//Advance time
+			timeService.SetNow(std::max(next,timeService.GetNow()));
+			
+			//Deliver arrived packets
+			while (!packets.empty() && packets.begin()->first<=timeService.GetNow())
+			{
+				auto packet = std::move(packets.begin()->second);
+				packets.erase(packets.begin());
+				packet.direction->to->WritePacket(packet.data);
+			}
+		}
+		return true;
+	}
+	
+	// Send messages from a to b on a stream and measure it
+	Report Transfer(uint16_t id, const Workload& workload)
+	{
+		report = {};
+		
+		std::vector<std::chrono::milliseconds> sent(workload.messages);
+		std::vector<std::chrono::milliseconds> latencies;
+		uint64_t expected = 0;
+		
+		//Receive on the other side
+		forward.to->OpenStream(id).OnMessage([&](uint32_t ppid, const uint8_t* data, uint64_t size){
+			//Get message number
+			uint64_t num = BufferReader(data,size).Get8(0);
+			if (num!=expected++)
+				report.inOrder = false;
+			if (num<sent.size())
+				latencies.push_back(timeService.GetNow()-sent[num]);
+			report.delivered++;
+		});
+		
+		auto& stream = forward.from->OpenStream(id);
+		Buffer message(std::max<size_t>(workload.size,8));
+		message.SetSize(message.GetCapacity());
+		memset(message.GetData(),0xAA,message.GetSize());
+		
+		auto start = timeService.GetNow();
+		auto end = start + workload.timeout;
+		
+		//Send all messages at their time
+		while (report.sent<workload.messages && timeService.GetNow()<end)
+		{
+			//Number message
+			for (size_t i=0;i<8;++i)
+				message.GetData()[i] = report.sent >> (56-8*i);
+			sent[report.sent] = timeService.GetNow();
+			stream.Send(51,message.GetData(),message.GetSize());
+			report.sent++;
+			//Run until next message is due
+			if (workload.interval.count())
+			{
+				auto due = start + workload.interval*report.sent;
+				Run(due - timeService.GetNow(),[&](){ return timeService.GetNow()>=due; });
+			}
+		}
+		
+		//Wait for all of them
+		Run(end - timeService.GetNow(),[&](){ return report.delivered==report.sent; });
+		
+		//Stop listening
+		forward.to->OpenStream(id).OnMessage(nullptr);
+		
+		//Calculate stats
+		report.duration = timeService.GetNow() - start;
+		if (report.duration.count())
+			report.goodput = report.delivered*workload.size*1000.0/report.duration.count();
+		std::sort(latencies.begin(),latencies.end());
+		if (!latencies.empty())
+		{
+			auto percentile = [&](double p){ return latencies[std::min<size_t>(latencies.size()-1,latencies.size()*p)]; };
+			report.p50 = percentile(0.50);
+			report.p90 = percentile(0.90);
+			report.p99 = percentile(0.99);
+			report.max = latencies.back();
+		}
+		return report;
+	}
+	
+	const Report& GetReport() const { return report; }
+private:
+	void Flush(Direction& direction)
+	{
+		uint8_t data[65535];
+		while (size_t len = direction.from->ReadPacket(data,sizeof(data)))
+			Send(direction,data,len);
+	}
+	
+	void Send(Direction& direction, const uint8_t* data, size_t len)
+	{
+		auto now = timeService.GetNow();
+		const Link& link = direction.link;
+		
+		report.packets++;
+		
+		//Count chunks
+		Inspect(direction,data,len);
+		
+		//Packets bigger than the MTU are dropped
+		if (len>link.mtu)
+		{
+			report.lost++;
+			return;
+		}
+		
+		//Serialize on the link
+		if (link.bandwidth)
+		{
+			direction.busy = std::max<std::chrono::microseconds>(direction.busy,now) + std::chrono::microseconds(len*8*1000000/link.bandwidth);
+			now = std::chrono::ceil<std::chrono::milliseconds>(direction.busy);
+		}
+		
+		//Random loss
+		if (link.loss>0 && probability(gen)<link.loss)
+		{
+			report.lost++;
+			return;
+		}
+		
+		//Get arrival time
+		auto arrival = now + link.delay;
+		if (link.jitter.count())
+			arrival += std::chrono::milliseconds(std::uniform_int_distribution<int64_t>(0,link.jitter.count())(gen));
+		
+		//Reordered packets are delayed past the following ones, the rest are kept in order
+		if (link.reorder>0 && probability(gen)<link.reorder)
+			arrival += link.reorderDelay;
+		else
+			direction.last = arrival = std::max(arrival,direction.last);
+		
+		//Enqueue
+		packets.emplace(arrival,Packet{&direction,Buffer(data,len)});
+	}
+	
+	void Inspect(Direction& direction, const uint8_t* data, size_t len)
+	{
+		BufferReader reader(data,len);
+		//Skip common header
+		reader.Skip(12);
+		//Walk chunks
+		while (reader.GetLeft()>=4)
+		{
+			uint8_t type = reader.Get1(reader.Mark());
+			uint16_t length = reader.Get2(reader.Mark()+2);
+			if (length<4 || length>reader.GetLeft())
+				break;
+			//DATA
+			if (type==sctp::Chunk::PDATA && length>=16)
+			{
+				report.dataChunks++;
+				//Check if the TSN was already sent
+				if (!direction.transmitted.insert(reader.Get4(reader.Mark()+4)).second)
+					report.retransmissions++;
+			}
+			//SACK
+			if (type==sctp::Chunk::SACK)
+				report.sacks++;
+			reader.Skip(std::min<size_t>((length+3)&~3,reader.GetLeft()));
+		}
+	}
+private:
+	FakeTimeService& timeService;
+	std::mt19937 gen;
+	std::uniform_real_distribution<double> probability{0,1};
+	Direction forward;
+	Direction backward;
+	std::multimap<std::chrono::milliseconds,Packet> packets;
+	Report report;
+};
+
+#endif /* NETWORKSIMULATOR_H */
@@ -0,0 +1,147 @@
+/*
+ * File:   Runtime
+ *
+ * Created on 19-oct-2026, 23:48:12
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Buffer.h"
+#include "sctp/Runtime.h"
+
+class Runtime : public testing::Test
+{
+protected:
+	//Wait until condition is met or timeout
+	template<typename Condition>
+	static bool WaitFor(Condition condition, std::chrono::milliseconds timeout = std::chrono::milliseconds(10000))
+	{
+		auto until = std::chrono::steady_clock::now() + timeout;
+		while (!condition())
+		{
+			if (std::chrono::steady_clock::now()>until)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+	
+	static uint64_t Sum(const std::vector<sctp::Runtime::Stats>& stats, uint64_t sctp::Runtime::Stats::* field)
+	{
+		uint64_t sum = 0;
+		for (const auto& worker : stats)
+			sum += worker.*field;
+		return sum;
+	}
+};
+
+TEST_F(Runtime, WorkStealing)
+{
+	static constexpr const size_t Associations = 32;
+	static constexpr const size_t Messages = 50;
+	
+	//Connect both runtimes, packets are sent from their workers
+	sctp::Runtime* clients = nullptr;
+	sctp::Runtime* servers = nullptr;
+	sctp::Runtime serverRuntime([&](sctp::Runtime::Key key, const uint8_t* data, size_t size){
+		clients->WritePacket(key,data,size);
+	},4);
+	sctp::Runtime clientRuntime([&](sctp::Runtime::Key key, const uint8_t* data, size_t size){
+		servers->WritePacket(key,data,size);
+	},4);
+	clients = &clientRuntime;
+	servers = &serverRuntime;
+	
+	//Place all client associations on the first worker so the rest have to steal them
+	std::vector<sctp::Runtime::Key> keys;
+	for (sctp::Runtime::Key key = 0; keys.size()<Associations; ++key)
+		if (clientRuntime.GetHome(key)==0)
+			keys.push_back(key);
+	
+	std::atomic<size_t> received{0};
+	Buffer message(1000);
+	message.SetSize(message.GetCapacity());
+	
+	for (auto key : keys)
+	{
+		servers->Create(key,[&](sctp::Association& association){
+			association.SetLocalPort(5000);
+			association.SetRemotePort(5000);
+			association.OnMessage([&](sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size){
+				ASSERT_EQ(size,message.GetSize());
+				received++;
+			});
+		});
+		clients->Create(key,[&](sctp::Association& association){
+			association.SetLocalPort(5000);
+			association.SetRemotePort(5000);
+			association.Associate();
+			//Queued until established
+			auto& stream = association.OpenStream(1);
+			for (size_t i=0; i<Messages; ++i)
+				stream.Send(53,message.GetData(),message.GetSize());
+		});
+	}
+	
+	ASSERT_TRUE(WaitFor([&](){ return received==Associations*Messages; }));
+	
+	//Established ones can be reached wherever they are
+	std::atomic<size_t> established{0};
+	for (auto key : keys)
+		clients->Post(key,[&](sctp::Association& association){
+			if (association.GetState()==sctp::Association::Established)
+				established++;
+		});
+	ASSERT_TRUE(WaitFor([&](){ return established==Associations; }));
+	
+	//Idle workers took some
+	auto stats = clients->GetStats();
+	ASSERT_EQ(stats.size(),4);
+	ASSERT_GT(Sum(stats,&sctp::Runtime::Stats::stolen),0);
+	ASSERT_EQ(Sum(stats,&sctp::Runtime::Stats::stolen),Sum(stats,&sctp::Runtime::Stats::given));
+	ASSERT_LT(stats[0].associations,Associations);
+	
+	//Remove them wherever they are, so nothing is sent while the runtimes are destroyed
+	for (auto key : keys)
+	{
+		clients->Remove(key);
+		servers->Remove(key);
+	}
+	ASSERT_TRUE(WaitFor([&](){
+		size_t count = 0;
+		for (const auto& worker : clients->GetStats())
+			count += worker.associations;
+		for (const auto& worker : servers->GetStats())
+			count += worker.associations;
+		return count==0;
+	}));
+}
+
+TEST_F(Runtime, Dropped)
+{
+	sctp::Runtime runtime([](sctp::Runtime::Key, const uint8_t*, size_t){},2);
+	
+	std::atomic<size_t> run{0};
+	runtime.Create(1,[](sctp::Association& association){
+		association.SetLocalPort(5000);
+		association.SetRemotePort(5000);
+	});
+	runtime.Post(1,[&](sctp::Association&){ run++; });
+	ASSERT_TRUE(WaitFor([&](){ return run==1; }));
+	ASSERT_EQ(Sum(runtime.GetStats(),&sctp::Runtime::Stats::dropped),0);
+	
+	//Messages for unknown associations are counted
+	uint8_t packet[12] = {};
+	runtime.WritePacket(2,packet,sizeof(packet));
+	runtime.Post(2,[&](sctp::Association&){ run++; });
+	ASSERT_TRUE(WaitFor([&](){ return Sum(runtime.GetStats(),&sctp::Runtime::Stats::dropped)==2; }));
+	
+	//And so are the ones for removed ones
+	runtime.Remove(1);
+	runtime.Post(1,[&](sctp::Association&){ run++; });
+	ASSERT_TRUE(WaitFor([&](){ return Sum(runtime.GetStats(),&sctp::Runtime::Stats::dropped)==3; }));
+	ASSERT_EQ(run,1);
+}
@@ -0,0 +1,121 @@
+/* 
+ * File:   Simulator
+ *
+ * Created on 19-oct-2026, 18:40:03
+ */
+
+#include <gtest/gtest.h>
+
+#include "NetworkSimulator.h"
+
+class Simulator : public testing::Test
+{
+protected:
+	void Connect(const NetworkSimulator::Link& ab, const NetworkSimulator::Link& ba)
+	{
+		client = sctp::Association::Create(timeService);
+		server = sctp::Association::Create(timeService);
+		client->SetLocalPort(5000);
+		client->SetRemotePort(5000);
+		server->SetLocalPort(5000);
+		server->SetRemotePort(5000);
+		
+		simulator.Connect(*client,*server,ab,ba);
+		
+		ASSERT_TRUE(client->Associate());
+		ASSERT_TRUE(simulator.Run(10000ms,[&](){
+			return client->GetState()==sctp::Association::Established && server->GetState()==sctp::Association::Established;
+		}));
+	}
+	
+	static void Print(const NetworkSimulator::Report& report)
+	{
+		printf("delivered %zu/%zu in %lldms goodput %.0fB/s latency p50 %lldms p90 %lldms p99 %lldms max %lldms packets %zu lost %zu data %zu rtx %zu sacks %zu\n",
+			report.delivered, report.sent, (long long)report.duration.count(), report.goodput,
+			(long long)report.p50.count(), (long long)report.p90.count(), (long long)report.p99.count(), (long long)report.max.count(),
+			report.packets, report.lost, report.dataChunks, report.retransmissions, report.sacks);
+	}
+	
+	FakeTimeService timeService;
+	NetworkSimulator simulator{timeService};
+	std::shared_ptr<sctp::Association> client;
+	std::shared_ptr<sctp::Association> server;
+};
+
+TEST_F(Simulator, Clean)
+{
+	NetworkSimulator::Link link;
+	Connect(link,link);
+	
+	auto report = simulator.Transfer(0,{1000,1024,1ms});
+	Print(report);
+	
+	ASSERT_EQ(report.delivered,report.sent);
+	ASSERT_TRUE(report.inOrder);
+	ASSERT_EQ(report.retransmissions,0);
+	ASSERT_EQ(report.lost,0);
+	//Paced below capacity so latency is one way delay plus the delayed ack effect on cwnd
+	ASSERT_LE(report.p50,link.delay*2);
+}
+
+TEST_F(Simulator, Bandwidth)
+{
+	NetworkSimulator::Link link;
+	link.bandwidth = 2000000;
+	Connect(link,link);
+	
+	auto report = simulator.Transfer(0,{1000,1024});
+	Print(report);
+	
+	ASSERT_EQ(report.delivered,report.sent);
+	ASSERT_TRUE(report.inOrder);
+	//Can't go faster than the link and should use most of it
+	ASSERT_LE(report.goodput,link.bandwidth/8);
+	ASSERT_GE(report.goodput,link.bandwidth/8*0.7);
+}
+
+TEST_F(Simulator, Lossy)
+{
+	NetworkSimulator::Link link;
+	link.loss = 0.02;
+	link.jitter = 5ms;
+	link.reorder = 0.01;
+	Connect(link,link);
+	
+	auto report = simulator.Transfer(0,{1000,1024,2ms});
+	Print(report);
+	
+	ASSERT_EQ(report.delivered,report.sent);
+	ASSERT_TRUE(report.inOrder);
+	ASSERT_GT(report.lost,0);
+	ASSERT_GT(report.retransmissions,0);
+	ASSERT_GT(report.sacks,0);
+}
+
+TEST_F(Simulator, Deterministic)
+{
+	NetworkSimulator::Link link;
+	link.loss = 0.05;
+	link.jitter = 10ms;
+	Connect(link,link);
+	
+	auto first = simulator.Transfer(0,{200,4096});
+	
+	//Same seed, same run
+	FakeTimeService timeService2;
+	NetworkSimulator simulator2{timeService2};
+	auto client2 = sctp::Association::Create(timeService2);
+	auto server2 = sctp::Association::Create(timeService2);
+	client2->SetLocalPort(5000); client2->SetRemotePort(5000);
+	server2->SetLocalPort(5000); server2->SetRemotePort(5000);
+	simulator2.Connect(*client2,*server2,link,link);
+	client2->Associate();
+	simulator2.Run(10000ms,[&](){ return client2->GetState()==sctp::Association::Established && server2->GetState()==sctp::Association::Established; });
+	auto second = simulator2.Transfer(0,{200,4096});
+	
+	ASSERT_EQ(first.delivered,first.sent);
+	ASSERT_EQ(first.duration,second.duration);
+	ASSERT_EQ(first.packets,second.packets);
+	ASSERT_EQ(first.retransmissions,second.retransmissions);
+	ASSERT_EQ(first.p99,second.p99);
+}
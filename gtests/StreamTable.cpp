@@ -0,0 +1,75 @@
+/* 
+ * File:   StreamTable
+ *
+ * Created on 19-oct-2026, 12:10:31
+ */
+
+#include <gtest/gtest.h>
+
+#include "StreamTable.h"
+
+class StreamTables : public testing::Test
+{
+protected:
+};
+
+
+TEST_F(StreamTables, Empty)
+{
+	StreamTable<uint32_t> table;
+	
+	ASSERT_TRUE(table.IsEmpty());
+	ASSERT_FALSE(table.Get(0));
+	ASSERT_FALSE(table.Get(0xFFFF));
+	ASSERT_FALSE(table.Erase(1));
+}
+
+TEST_F(StreamTables, EmplaceAndErase)
+{
+	StreamTable<uint32_t> table;
+	
+	//Add sparse ids
+	for (uint32_t id = 0; id<=0xFFFF; id+=257)
+		table.Emplace(id,id*2);
+	
+	//Check all of them are there
+	for (uint32_t id = 0; id<=0xFFFF; id+=257)
+	{
+		auto item = table.Get(id);
+		ASSERT_TRUE(item);
+		ASSERT_EQ(*item,id*2);
+		//Neighbours are not
+		if (id<0xFFFF)
+		{
+			ASSERT_FALSE(table.Get(id+1));
+		}
+	}
+	
+	//Count them
+	size_t count = 0;
+	table.ForEach([&](uint16_t id, uint32_t& item){
+		ASSERT_EQ(item,id*2);
+		count++;
+	});
+	ASSERT_EQ(count,table.GetCount());
+	
+	//Remove one
+	ASSERT_TRUE(table.Erase(257));
+	ASSERT_FALSE(table.Get(257));
+	ASSERT_EQ(count-1,table.GetCount());
+}
+
+TEST_F(StreamTables, StableAddress)
+{
+	StreamTable<uint32_t> table;
+	
+	//Get address of first item
+	uint32_t* first = &table.Emplace(1,1);
+	
+	//Fill lots of pages
+	for (uint32_t id = 2; id<=0xFFFF; ++id)
+		table.Emplace(id,id);
+	
+	//Item must not have moved
+	ASSERT_EQ(first,table.Get(1));
+}
@@ -0,0 +1,144 @@
+/* 
+ * File:   TimerWheel
+ *
+ * Created on 19-oct-2026, 17:05:12
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "TimerWheel.h"
+
+using namespace std::chrono_literals;
+
+class TimerWheel : public testing::Test
+{
+protected:
+};
+
+TEST_F(TimerWheel, Timeout)
+{
+	datachannels::TimerWheel wheel;
+	
+	std::vector<std::chrono::milliseconds> fired;
+	auto callback = [&](std::chrono::milliseconds now){ fired.push_back(now); };
+	
+	auto a = wheel.CreateTimer(10ms,callback);
+	auto b = wheel.CreateTimer(100ms,callback);
+	auto c = wheel.CreateTimer(5000ms,callback);
+	auto d = wheel.CreateTimer(callback);
+	ASSERT_EQ(wheel.GetScheduledCount(),3);
+	ASSERT_EQ(wheel.GetNextTimeout(),10ms);
+	
+	wheel.SetNow(9ms);
+	ASSERT_TRUE(fired.empty());
+	wheel.SetNow(10ms);
+	ASSERT_EQ(fired.size(),1);
+	ASSERT_EQ(fired[0],10ms);
+	
+	//Cancel and re-arm
+	c->Cancel();
+	b->Again(50ms);
+	wheel.SetNow(59ms);
+	ASSERT_EQ(fired.size(),1);
+	wheel.SetNow(60ms);
+	ASSERT_EQ(fired.size(),2);
+	ASSERT_EQ(fired[1],60ms);
+	
+	//Nothing else
+	wheel.SetNow(10000ms);
+	ASSERT_EQ(fired.size(),2);
+	ASSERT_EQ(wheel.GetScheduledCount(),0);
+	ASSERT_FALSE(wheel.GetNextTimeout());
+	
+	//Unscheduled timers can be armed later
+	d->Again(0ms);
+	wheel.SetNow(10001ms);
+	ASSERT_EQ(fired.size(),3);
+	ASSERT_EQ(fired[2],10001ms);
+}
+
+TEST_F(TimerWheel, Repeat)
+{
+	datachannels::TimerWheel wheel;
+	
+	size_t count = 0;
+	auto timer = wheel.CreateTimer(10ms,20ms,[&](...){ count++; });
+	
+	wheel.SetNow(10ms);
+	ASSERT_EQ(count,1);
+	wheel.SetNow(29ms);
+	ASSERT_EQ(count,1);
+	wheel.SetNow(30ms);
+	ASSERT_EQ(count,2);
+	wheel.SetNow(110ms);
+	ASSERT_EQ(count,6);
+	
+	timer->Cancel();
+	wheel.SetNow(1000ms);
+	ASSERT_EQ(count,6);
+}
+
+TEST_F(TimerWheel, Release)
+{
+	datachannels::TimerWheel wheel;
+	
+	size_t count = 0;
+	datachannels::Timer::shared self;
+	
+	//Timer released inside its own callback
+	self = wheel.CreateTimer(10ms,[&](...){ count++; self = nullptr; });
+	
+	//Timer released before firing is cancelled
+	wheel.CreateTimer(10ms,[&](...){ count++; });
+	ASSERT_EQ(wheel.GetScheduledCount(),1);
+	
+	wheel.SetNow(100ms);
+	ASSERT_EQ(count,1);
+	ASSERT_FALSE(self);
+	
+	//Timers can outlive the wheel
+	auto wheel2 = std::make_unique<datachannels::TimerWheel>();
+	auto orphan = wheel2->CreateTimer(10ms,[&](...){ count++; });
+	wheel2.reset();
+	orphan->Again(10ms);
+	orphan->Cancel();
+	ASSERT_EQ(count,1);
+}
+
+TEST_F(TimerWheel, Random)
+{
+	datachannels::TimerWheel wheel(1000ms);
+	std::mt19937 gen(1);
+	std::uniform_int_distribution<int> timeout(0,20000000);
+	std::uniform_int_distribution<int> step(0,2000);
+	
+	const size_t num = 10000;
+	std::vector<std::chrono::milliseconds> deadlines(num);
+	std::vector<std::chrono::milliseconds> fired(num);
+	std::vector<datachannels::Timer::shared> timers;
+	
+	for (size_t i=0;i<num;++i)
+	{
+		//Cover all levels, but most on the first ones
+		auto ms = std::chrono::milliseconds(timeout(gen) >> (i%16));
+		deadlines[i] = wheel.GetNow() + std::max(ms,1ms);
+		timers.push_back(wheel.CreateTimer(ms,[&,i](std::chrono::milliseconds now){ fired[i] = now; }));
+	}
+	
+	//Advance with random steps
+	auto now = wheel.GetNow();
+	while (wheel.GetScheduledCount())
+	{
+		auto next = now + std::chrono::milliseconds(step(gen));
+		//Never sleep longer than the next timeout
+		now = std::min(next,now + *wheel.GetNextTimeout());
+		wheel.SetNow(now);
+	}
+	
+	//All timers fired exactly on time
+	for (size_t i=0;i<num;++i)
+		ASSERT_EQ(fired[i],deadlines[i]) << i;
+}
@@ -0,0 +1,118 @@
+/*
+ * File:   Trace
+ *
+ * Created on 19-oct-2026, 20:11:52
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Buffer.h"
+#include "FakeTimeService.h"
+#include "Trace.h"
+#include "sctp/Association.h"
+
+using namespace datachannels;
+
+class Trace : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+#ifndef TRACE_EVENTS
+		GTEST_SKIP() << "configure with -DTRACE_EVENTS=ON";
+#endif
+	}
+	
+	//Count records of an event for an association on all threads
+	static size_t Count(const std::vector<trace::Thread>& threads, trace::Event event, uint32_t association)
+	{
+		size_t count = 0;
+		for (const auto& thread : threads)
+			for (const auto& record : thread.records)
+				if (record.event==event && record.association==association)
+					count++;
+		return count;
+	}
+};
+
+TEST_F(Trace, Lifecycle)
+{
+	FakeTimeService timeService;
+	sctp::Association client(timeService);
+	sctp::Association server(timeService);
+	client.SetLocalPort(5000);
+	client.SetRemotePort(5000);
+	server.SetLocalPort(5000);
+	server.SetRemotePort(5000);
+	
+	//Run it on its own thread so records are not mixed with other tests
+	std::thread([&](){
+		uint8_t data[1500];
+		client.Associate();
+		Buffer message(100);
+		message.SetSize(message.GetCapacity());
+		client.OpenStream(1).Send(51,message.GetData(),message.GetSize());
+		while (client.HasPendingData() || server.HasPendingData())
+		{
+			if (size_t len = client.ReadPacket(data,sizeof(data)))
+				server.WritePacket(data,len);
+			if (size_t len = server.ReadPacket(data,sizeof(data)))
+				client.WritePacket(data,len);
+		}
+	}).join();
+	
+	ASSERT_EQ(client.GetState(),sctp::Association::Established);
+	
+	//Records survive the thread
+	auto threads = trace::Collect();
+	auto stats = server.GetStats();
+	
+	//The server chooses its tag when receiving the INIT, so its first records have none
+	uint32_t tag = server.GetLocalVerificationTag();
+	ASSERT_EQ(Count(threads,trace::PacketRead,tag),stats.packetsSent);
+	ASSERT_EQ(Count(threads,trace::PacketWritten,tag),stats.packetsReceived-1);
+	ASSERT_EQ(Count(threads,trace::StateChanged,tag),1);
+	ASSERT_EQ(Count(threads,trace::Acknowledge,tag),stats.acknowledgementsSent);
+	
+	//All records of a thread are in order
+	for (const auto& thread : threads)
+		for (size_t i=1; i<thread.records.size(); ++i)
+			ASSERT_LE(thread.records[i-1].timestamp,thread.records[i].timestamp);
+}
+
+TEST_F(Trace, Overwritten)
+{
+	const uint32_t tag = 0xDEADBEEF;
+	const uint32_t count = 3*trace::RingSize;
+	
+	//Records of our writer must be consecutive, whatever was overwritten while copying
+	auto check = [&](){
+		for (const auto& thread : trace::Collect())
+		{
+			if (thread.records.empty() || thread.records.back().association!=tag)
+				continue;
+			EXPECT_LT(thread.records.size(),trace::RingSize);
+			for (size_t i=1; i<thread.records.size(); ++i)
+				EXPECT_EQ(thread.records[i].tsn,thread.records[i-1].tsn+1);
+			return thread.records.size();
+		}
+		return size_t(0);
+	};
+	
+	//Wrap the ring several times while collecting
+	std::atomic<bool> done{false};
+	std::thread writer([&](){
+		for (uint32_t tsn=0; tsn<count; ++tsn)
+			trace::Emit(trace::ChunkProcessed,tag,0,0,tsn,0);
+		done = true;
+	});
+	while (!done)
+		check();
+	writer.join();
+	
+	//Only the newest ones are kept once the ring has wrapped
+	ASSERT_EQ(check(),trace::RingSize-1);
+}
@@ -3,8 +3,13 @@
 #include <stdint.h>
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
 #include <functional>
+#include <vector>
+
+// Owned message data, defined in Buffer.h
+class Buffer;
 
 namespace datachannels
 {
@@ -31,6 +36,16 @@ public:
 };
 
 
+// Immutable message data shared by all the datachannels it is sent on
+//	Queued messages and the DATA chunks in flight keep a reference to it, so
+//	sending the same payload on many datachannels does not copy it.
+using Payload = std::shared_ptr<const Buffer>;
+
+// Copy data once into a payload
+Payload CreatePayload(const uint8_t* data, uint64_t size);
+// Take the buffer without copying, i.e. a message received from OnMessage
+Payload CreatePayload(Buffer&& buffer);
+
 class Datachannel
 {
 public:
@@ -42,17 +57,33 @@ public:
 	
 	struct Options
 	{
-		
+		std::string label;
+		std::string protocol;
+		bool ordered					= true;
+		// Partial reliability, only one of them can be set
+		std::optional<uint16_t> maxRetransmits;
+		std::optional<std::chrono::milliseconds> maxPacketLifeTime;
+		// Negotiated out-of-band, no DATA_CHANNEL_OPEN is sent and id is used as stream id
+		bool negotiated					= false;
+		uint16_t id					= 0;
 	};
 
 	using shared = std::shared_ptr<Datachannel>;
 public:
 	virtual ~Datachannel() = default;
 	virtual bool Send(MessageType type, const uint8_t* data = nullptr, const uint64_t size = 0)  = 0;
+	virtual bool Send(MessageType type, const Payload& payload) = 0;
 	virtual bool Close() = 0;
 	
+	// Getters
+	virtual uint16_t GetId() const = 0;
+	virtual const Options& GetOptions() const = 0;
+	
 	// Event handlers
 	virtual void OnMessage(const std::function<void(MessageType, const uint8_t*,uint64_t)>& callback) = 0;
+	//	Called after the one above with the message moved into a buffer the application can keep,
+	//	reassembled messages are moved without copying them
+	virtual void OnMessage(const std::function<void(MessageType, Buffer&&)>& callback) = 0;
 	
 };
 
@@ -62,11 +93,41 @@ enum Setup
 	Server
 };
 	
+// Contiguous piece of a packet, in the spirit of struct iovec
+struct Slice
+{
+	const uint8_t* data	= nullptr;
+	size_t size		= 0;
+};
+
 class Transport
 {
 public:
 	virtual ~Transport() = default;
 	virtual size_t ReadPacket(uint8_t *data, uint32_t size) = 0;
+	// Read next packet as a list of slices to be sent or encrypted in order
+	//	Headers are written to data, which must be as big as for a flat read,
+	//	and the slices may point to the queued messages instead of copying
+	//	them, so they are only valid until the next call to the transport.
+	virtual size_t ReadPacket(uint8_t *data, uint32_t size, std::vector<Slice>& slices)
+	{
+		//Flat by default
+		slices.clear();
+		size_t len = ReadPacket(data,size);
+		if (len)
+			slices.push_back({data,len});
+		return len;
+	}
+	// Write the packet at data+headroom leaving at least tailroom bytes after it
+	//	So the record header can be written before it and the packet encrypted in place.
+	//	Returns the packet length, not counting the headroom.
+	size_t ReadPacket(uint8_t *data, uint32_t size, uint32_t headroom, uint32_t tailroom)
+	{
+		//Check there is room for anything
+		if (headroom+tailroom>=size)
+			return 0;
+		return ReadPacket(data+headroom,size-headroom-tailroom);
+	}
 	virtual size_t WritePacket(uint8_t *data, uint32_t size) = 0; 
 	
 	virtual void OnPendingData(std::function<void(void)> callback) = 0;
@@ -80,6 +141,12 @@ public:
 		uint16_t localPort	= 5000;
 		uint16_t remotePort	= 5000;
 		Setup setup		= Server;
+		// Write all SCTP packets to this pcapng file if set
+		std::string capture	= {};
+		// Datachannel::Send can be called from any thread, messages are handed
+		// over to the transport thread on its next ReadPacket without locking.
+		// The pending data callback is then called from the sending thread.
+		bool threadSafeSend	= false;
 	};
 	
 	using shared = std::shared_ptr<Endpoint>;
@@ -100,6 +167,10 @@ public:
 	virtual uint16_t   GetLocalPort() const = 0;
 	virtual uint16_t   GetRemotePort() const = 0;
 	virtual Transport& GetTransport() = 0;
+	
+	// Event handlers
+	//	Called when the remote peer opens a new datachannel
+	virtual void OnDatachannel(const std::function<void(const Datachannel::shared&)>& callback) = 0;
 };
 
 }; //namespace
@@ -0,0 +1,191 @@
+#include "Capture.h"
+
+#include "BufferWritter.h"
+
+namespace datachannels
+{
+
+// pcapng block types and options
+static constexpr const uint32_t SectionHeaderBlock		= 0x0A0D0D0A;
+static constexpr const uint32_t InterfaceDescriptionBlock	= 0x00000001;
+static constexpr const uint32_t EnhancedPacketBlock		= 0x00000006;
+static constexpr const uint32_t ByteOrderMagic			= 0x1A2B3C4D;
+static constexpr const uint16_t LinkTypeIPv4			= 228;
+static constexpr const uint16_t OptionEndOfOptions		= 0;
+static constexpr const uint16_t OptionFlags			= 2;
+// IPv4 and UDP headers prepended to the SCTP packet
+static constexpr const size_t FramingSize			= 20 + 8;
+
+// Append an integer in host byte order as pcapng blocks use the order of the section header
+template<typename T>
+static void Append(Buffer& buffer, T value)
+{
+	buffer.AppendData(reinterpret_cast<const uint8_t*>(&value),sizeof(value));
+}
+
+Capture::shared Capture::Open(const std::string& filename)
+{
+	//Create file
+	FILE* file = fopen(filename.c_str(),"wb");
+	if (!file)
+		//Error
+		return nullptr;
+	//Start writing
+	return std::make_shared<Capture>(file);
+}
+
+Capture::Capture(FILE* file) :
+	file(file),
+	buffer(FlushSize)
+{
+	//Section header block with unknown section length
+	Append<uint32_t>(buffer,SectionHeaderBlock);
+	Append<uint32_t>(buffer,28);
+	Append<uint32_t>(buffer,ByteOrderMagic);
+	Append<uint16_t>(buffer,1);
+	Append<uint16_t>(buffer,0);
+	Append<int64_t>(buffer,-1);
+	Append<uint32_t>(buffer,28);
+
+	//Interface description block for raw IPv4 without snap length and microsecond timestamps
+	Append<uint32_t>(buffer,InterfaceDescriptionBlock);
+	Append<uint32_t>(buffer,20);
+	Append<uint16_t>(buffer,LinkTypeIPv4);
+	Append<uint16_t>(buffer,0);
+	Append<uint32_t>(buffer,0);
+	Append<uint32_t>(buffer,20);
+	appended = buffer.GetSize();
+
+	//Start writer
+	thread = std::thread([this](){ Run(); });
+}
+
+Capture::~Capture()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		//Stop writer after writing what is left
+		stopping = true;
+	}
+	pending.notify_one();
+	thread.join();
+	fclose(file);
+}
+
+void Capture::Write(Direction direction, const uint8_t* packet, size_t size)
+{
+	//Get wall clock time so it can be correlated with other captures
+	uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	//Build IPv4 and UDP headers
+	uint8_t framing[FramingSize];
+	BufferWritter writter(framing,sizeof(framing));
+	uint32_t source = direction==Outbound ? LocalAddress : RemoteAddress;
+	uint32_t destination = direction==Outbound ? RemoteAddress : LocalAddress;
+	writter.Set1(0x45);			//Version and header length
+	writter.Set1(0);			//DSCP
+	writter.Set2(FramingSize+size);		//Total length
+	writter.Set2(0);			//Identification
+	writter.Set2(0x4000);			//Don't fragment
+	writter.Set1(64);			//TTL
+	writter.Set1(17);			//UDP
+	writter.Set2(0);			//Checksum
+	writter.Set4(source);
+	writter.Set4(destination);
+	writter.Set2(Port);
+	writter.Set2(Port);
+	writter.Set2(8+size);			//UDP length
+	writter.Set2(0);			//No UDP checksum
+
+	//IPv4 header checksum
+	uint32_t sum = 0;
+	for (size_t i=0;i<20;i+=2)
+		sum += framing[i]<<8 | framing[i+1];
+	while (sum>>16)
+		sum = (sum & 0xFFFF) + (sum>>16);
+	writter.Set2(10,~sum);
+
+	//Get padded packet data length
+	uint32_t captured = FramingSize+size;
+	uint32_t padding = (4 - captured%4)%4;
+	uint32_t length = 28 + captured + padding + 8 + 4 + 4;
+	uint8_t zeros[4] = {};
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		//Enhanced packet block
+		Append<uint32_t>(buffer,EnhancedPacketBlock);
+		Append<uint32_t>(buffer,length);
+		Append<uint32_t>(buffer,0);
+		Append<uint32_t>(buffer,timestamp>>32);
+		Append<uint32_t>(buffer,timestamp);
+		Append<uint32_t>(buffer,captured);
+		Append<uint32_t>(buffer,captured);
+		buffer.AppendData(static_cast<const uint8_t*>(framing),sizeof(framing));
+		buffer.AppendData(packet,size);
+		buffer.AppendData(static_cast<const uint8_t*>(zeros),padding);
+		//Direction flag
+		Append<uint16_t>(buffer,OptionFlags);
+		Append<uint16_t>(buffer,4);
+		Append<uint32_t>(buffer,direction);
+		Append<uint16_t>(buffer,OptionEndOfOptions);
+		Append<uint16_t>(buffer,0);
+		Append<uint32_t>(buffer,length);
+		appended += length;
+
+		//If we have enough to write
+		if (buffer.GetSize()<FlushSize)
+			//Wait for more
+			return;
+	}
+	//Wake up writer
+	pending.notify_one();
+}
+
+void Capture::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	//Request writing all appended data
+	requested = appended;
+	//Wake up writer
+	pending.notify_one();
+	//Wait for it
+	flushed.wait(lock,[&](){ return written>=requested; });
+}
+
+void Capture::Run()
+{
+	//Swapped with the buffer so the association can keep appending while we write
+	Buffer writing(FlushSize);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		//Wait until there is enough data, the interval passes or we are stopping
+		pending.wait_for(lock,FlushInterval,[&](){ return stopping || requested>written || buffer.GetSize()>=FlushSize; });
+
+		//Swap buffers
+		std::swap(buffer,writing);
+		bool stop = stopping;
+		lock.unlock();
+
+		//Write them
+		if (!writing.IsEmpty())
+		{
+			fwrite(writing.GetData(),1,writing.GetSize(),file);
+			fflush(file);
+		}
+
+		lock.lock();
+		written += writing.GetSize();
+		writing.SetSize(0);
+		flushed.notify_all();
+
+		//If we are done
+		if (stop && buffer.IsEmpty())
+			break;
+	}
+}
+
+}; // namespace datachannels
@@ -0,0 +1,72 @@
+#ifndef DATACHANNEL_CAPTURE_H_
+#define DATACHANNEL_CAPTURE_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Buffer.h"
+
+namespace datachannels
+{
+
+// pcapng capture of the SCTP packets of an association
+//	Packets are framed in IPv4 and UDP on the SCTP tunneling port (rfc6951)
+//	so Wireshark decodes them as SCTP, with the local side as 10.0.0.1 and
+//	the remote one as 10.0.0.2 and the direction set on the packet flags.
+//	Blocks are appended to a memory buffer and written to the file by a
+//	background thread, so capturing never blocks the association on disk.
+class Capture
+{
+public:
+	using shared = std::shared_ptr<Capture>;
+
+	enum Direction
+	{
+		Inbound		= 1,
+		Outbound	= 2
+	};
+
+	static constexpr const uint16_t Port		= 9899;
+	static constexpr const uint32_t LocalAddress	= 0x0A000001;
+	static constexpr const uint32_t RemoteAddress	= 0x0A000002;
+	// Write to disk when this much data is buffered or after the flush interval
+	static constexpr const size_t FlushSize		= 64*1024;
+	static constexpr const std::chrono::milliseconds FlushInterval{1000};
+public:
+	// Create file and start writer thread, null on error
+	static Capture::shared Open(const std::string& filename);
+
+	Capture(FILE* file);
+	~Capture();
+
+	//Not copiable
+	Capture(const Capture&) = delete;
+	Capture& operator=(const Capture&) = delete;
+
+	void Write(Direction direction, const uint8_t* packet, size_t size);
+	// Wait until all buffered packets are on disk
+	void Flush();
+private:
+	void Run();
+private:
+	FILE* file;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable pending;
+	std::condition_variable flushed;
+	Buffer buffer;
+	// Bytes appended to the buffer, written to the file and requested to be written by Flush
+	uint64_t appended = 0;
+	uint64_t written = 0;
+	uint64_t requested = 0;
+	bool stopping = false;
+};
+
+}; // namespace datachannels
+
+#endif
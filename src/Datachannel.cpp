@@ -2,31 +2,258 @@
 
 namespace datachannels
 {
+
+Payload CreatePayload(const uint8_t* data, uint64_t size)
+{
+	return std::make_shared<const Buffer>(data,size);
+}
+
+Payload CreatePayload(Buffer&& buffer)
+{
+	return std::make_shared<const Buffer>(std::move(buffer));
+}
+
 namespace impl
 {
 
-Datachannel::Datachannel(const sctp::Stream::shared& stream)
+Datachannel::Datachannel(const std::shared_ptr<sctp::Association>& association, sctp::Stream& stream, const Options& options) :
+	association(association),
+	stream(stream),
+	options(options)
+{
+	//Stream id is the channel id
+	this->options.id = stream.GetId();
+	
+	//Negotiated channels are already opened on both sides
+	opened = acknowledged = options.negotiated;
+}
+
+Datachannel::Datachannel(const std::shared_ptr<sctp::Association>& association, sctp::Stream& stream) :
+	association(association),
+	stream(stream)
+{
+}
+
+Datachannel::~Datachannel()
+{
+}
+
+bool Datachannel::Open()
 {
-	this->stream = stream;
-	this->stream->OnMessage([&](const uint8_t ppid, const uint8_t* buffer, const size_t size){
-		
-	});
+	//If already opened
+	if (opened)
+		//Nothing to do
+		return true;
+	
+	//rfc8832#section-6
+	//	To open a data channel, the peer that wants to open it picks a stream
+	//	identifier for which the corresponding incoming and outgoing streams
+	//	are unused and sends a DATA_CHANNEL_OPEN message on the outgoing
+	//	stream.
+	dcep::DataChannelOpenMessage open;
+	
+	//Set channel type and reliability from options
+	if (options.maxRetransmits)
+	{
+		open.channelType = options.ordered ? dcep::Message::PartialReliableRexmit : dcep::Message::PartialReliableRexmitUnordered;
+		open.reliabilityParameter = *options.maxRetransmits;
+	} else if (options.maxPacketLifeTime) {
+		open.channelType = options.ordered ? dcep::Message::PartialReliableTimed : dcep::Message::PartialReliableTimedUnordered;
+		open.reliabilityParameter = options.maxPacketLifeTime->count();
+	} else {
+		open.channelType = options.ordered ? dcep::Message::Reliable : dcep::Message::ReliableUnordered;
+	}
+	open.label	= options.label;
+	open.protocol	= options.protocol;
+	
+	//	The peer that sent the DATA_CHANNEL_OPEN message MAY start sending
+	//	messages containing user data without waiting for the reception of
+	//	the corresponding DATA_CHANNEL_ACK message.
+	opened = true;
+	
+	//Send it
+	return Send(open);
 }
 	
 bool Datachannel::Send(MessageType type, const uint8_t* data, const uint64_t size)
 {
 	uint8_t empty = 0;
 	
-	if (!data || !size)
-		//   SCTP does not support the sending of empty user messages.  Therefore,
-		//   if an empty message has to be sent, the appropriate PPID (WebRTC
-		//   String Empty or WebRTC Binary Empty) is used and the SCTP user
-		//   message of one zero byte is sent.  When receiving an SCTP user
-		//   message with one of these PPIDs, the receiver MUST ignore the SCTP
-		//   user message and process it as an empty message.		
-		return stream->Send(type==UTF8 ? WebRTCStringEmpty : WebRTCBinaryEmpty, &empty, 1);
-	else 
-		return stream->Send(type==UTF8 ? WebRTCString : WebRTCBinary, data, size);
+	//Check it has been opened
+	if (!opened)
+		//Error
+		return false;
+	
+	//rfc8832#section-6
+	//	However, before the DATA_CHANNEL_ACK message is received, all messages
+	//	containing user data MUST be sent ordered, no matter whether the data
+	//	channel is ordered or not.
+	bool unordered = !options.ordered && acknowledged;
+	
+	//   SCTP does not support the sending of empty user messages.  Therefore,
+	//   if an empty message has to be sent, the appropriate PPID (WebRTC
+	//   String Empty or WebRTC Binary Empty) is used and the SCTP user
+	//   message of one zero byte is sent.  When receiving an SCTP user
+	//   message with one of these PPIDs, the receiver MUST ignore the SCTP
+	//   user message and process it as an empty message.		
+	bool isEmpty = !data || !size;
+	uint32_t ppid = isEmpty ? (type==UTF8 ? WebRTCStringEmpty : WebRTCBinaryEmpty) : (type==UTF8 ? WebRTCString : WebRTCBinary);
+	const uint8_t* payload = isEmpty ? &empty : data;
+	size_t length = isEmpty ? 1 : size;
+	
+	//If we may be called from other threads
+	if (threadSafe)
+	{
+		//Copy it and let the association thread queue it on the stream
+		association->Submit(stream.GetId(), ppid, std::make_shared<Buffer>(payload,length), unordered);
+		//Done
+		return true;
+	}
+	
+	return stream.Send(ppid, payload, length, unordered);
+}
+
+bool Datachannel::Send(MessageType type, const datachannels::Payload& payload)
+{
+	//Empty messages are sent with their own ppid
+	if (!payload || payload->IsEmpty())
+		return Send(type);
+	
+	//Check it has been opened
+	if (!opened)
+		//Error
+		return false;
+	
+	//Only unordered once acknowledged, see above
+	bool unordered = !options.ordered && acknowledged;
+	uint32_t ppid = type==UTF8 ? WebRTCString : WebRTCBinary;
+	
+	//If we may be called from other threads
+	if (threadSafe)
+	{
+		//Let the association thread queue it on the stream
+		association->Submit(stream.GetId(), ppid, payload, unordered);
+		//Done
+		return true;
+	}
+	
+	//Queue a reference to it
+	return stream.Send(ppid, payload, unordered);
+}
+
+bool Datachannel::Send(const dcep::Message& message)
+{
+	//Serialize message
+	Buffer buffer(message.GetSize());
+	BufferWritter writter(buffer);
+	size_t len = message.Serialize(writter);
+	
+	//Check it was serialized
+	if (!len)
+		//Error
+		return false;
+	
+	//rfc8832#section-6
+	//	The DATA_CHANNEL_OPEN and DATA_CHANNEL_ACK messages MUST be sent
+	//	ordered and reliably.
+	return stream.Send(WebRTCDCEP, buffer.GetData(), len);
+}
+
+void Datachannel::OnStreamMessage(uint32_t ppid, const uint8_t* data, uint64_t size)
+{
+	//Depending on the payload type
+	switch (ppid)
+	{
+		case WebRTCDCEP:
+		{
+			//Parse message
+			BufferReader reader(data,size);
+			auto message = dcep::Message::Parse(reader);
+			
+			//Ignore unknown or malformed messages
+			if (!message)
+				return;
+			
+			//Depending on the message type
+			switch (message->type)
+			{
+				case dcep::Message::DataChannelOpen:
+					//Process it
+					Process(*std::static_pointer_cast<dcep::DataChannelOpenMessage>(message));
+					break;
+				case dcep::Message::DataChannelAck:
+					//	Once the DATA_CHANNEL_ACK is received the data channel can
+					//	send unordered messages
+					acknowledged = true;
+					break;
+			}
+			return;
+		}
+		case WebRTCString:
+		case WebRTCBinary:
+		case WebRTCStringEmpty:
+		case WebRTCBinaryEmpty:
+		{
+			//Drop data on channels not opened yet
+			if (!opened)
+				return;
+			
+			//rfc8832#section-6
+			//	If a user message is received before the DATA_CHANNEL_ACK, the
+			//	DATA_CHANNEL_OPEN has been received by the peer
+			acknowledged = true;
+			
+			//Get message type
+			MessageType type = ppid==WebRTCString || ppid==WebRTCStringEmpty ? UTF8 : Binary;
+			
+			//Empty messages carry one byte that must be ignored
+			bool isEmpty = ppid==WebRTCStringEmpty || ppid==WebRTCBinaryEmpty;
+			
+			//Launch event
+			if (onMessage)
+				onMessage(type,isEmpty ? nullptr : data,isEmpty ? 0 : size);
+			
+			//Launch the one taking ownership last, as the message is not valid after it
+			if (onMessageBuffer)
+				onMessageBuffer(type,isEmpty ? Buffer() : stream.TakeMessage(data,size));
+			return;
+		}
+	}
+}
+
+void Datachannel::Process(const dcep::DataChannelOpenMessage& open)
+{
+	//Check the channel has not been opened locally or negotiated
+	if (opened)
+		//Ignore
+		return;
+	
+	//Get options from message
+	options.label		= open.label;
+	options.protocol	= open.protocol;
+	options.ordered		= !(open.channelType & 0x80);
+	options.negotiated	= false;
+	options.id		= stream.GetId();
+	
+	//Get reliability
+	switch (open.channelType & 0x7F)
+	{
+		case dcep::Message::PartialReliableRexmit:
+			options.maxRetransmits = open.reliabilityParameter;
+			break;
+		case dcep::Message::PartialReliableTimed:
+			options.maxPacketLifeTime = std::chrono::milliseconds(open.reliabilityParameter);
+			break;
+	}
+	
+	//It is opened now, and the remote side is not waiting for anything from us
+	opened = acknowledged = true;
+	
+	//rfc8832#section-6
+	//	If it is able to do so, the peer receiving the DATA_CHANNEL_OPEN
+	//	message MUST respond with a DATA_CHANNEL_ACK message on its
+	//	corresponding outgoing stream.
+	Send(dcep::DataChannelAckMessage());
 }
 
 bool Datachannel::Close()
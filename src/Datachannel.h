@@ -2,7 +2,11 @@
 #define DATACHANNEL_IMPL_DATACHANNEL_H_
 #include "Datachannels.h"
 
+#include <atomic>
+
+#include "sctp/Association.h"
 #include "sctp/Stream.h"
+#include "dcep/Message.h"
 
 namespace datachannels
 {
@@ -14,6 +18,7 @@ class Datachannel : public datachannels::Datachannel
 public:
 	enum Payload 
 	{
+		WebRTCDCEP	  = 50,
 		WebRTCString	  = 51,
 		WebRTCBinary	  = 53,
 		WebRTCStringEmpty = 56,
@@ -22,20 +27,55 @@ public:
 	};
 	
 public:
-	Datachannel(const sctp::Stream::shared& stream);
-	virtual ~Datachannel() = default;
+	// Channel opened locally
+	Datachannel(const std::shared_ptr<sctp::Association>& association, sctp::Stream& stream, const Options& options);
+	// Channel opened by the remote peer, waiting for the DATA_CHANNEL_OPEN
+	Datachannel(const std::shared_ptr<sctp::Association>& association, sctp::Stream& stream);
+	virtual ~Datachannel();
+	
+	bool Open();
 	virtual bool Send(MessageType type, const uint8_t* data = nullptr, const uint64_t size = 0) override;
+	virtual bool Send(MessageType type, const datachannels::Payload& payload) override;
 	virtual bool Close() override;
 	
+	// Getters
+	virtual uint16_t GetId() const override			{ return stream.GetId();	}
+	virtual const Options& GetOptions() const override	{ return options;		}
+	bool IsOpened() const					{ return opened;		}
+	bool IsAcknowledged() const				{ return acknowledged;		}
+	
+	// Allow calling Send from any thread, messages are submitted to the association
+	void SetThreadSafe(bool threadSafe)			{ this->threadSafe = threadSafe;	}
+	
 	// Event handlers
 	virtual void OnMessage(const std::function<void(MessageType, const uint8_t*,uint64_t)>& callback) override
 	{
 		//Store callback
 		onMessage = callback;
-	}	
+	}
+	virtual void OnMessage(const std::function<void(MessageType, Buffer&&)>& callback) override
+	{
+		//Store callback
+		onMessageBuffer = callback;
+	}
+	
+	// Called by the endpoint with the messages received on the stream
+	void OnStreamMessage(uint32_t ppid, const uint8_t* data, uint64_t size);
+private:
+	void Process(const dcep::DataChannelOpenMessage& open);
+	bool Send(const dcep::Message& message);
 private:
-	sctp::Stream::shared stream;
+	std::shared_ptr<sctp::Association> association;
+	sctp::Stream& stream;
+	Options options;
+	//DATA_CHANNEL_OPEN sent or received, or negotiated
+	std::atomic<bool> opened{false};
+	//DATA_CHANNEL_ACK received, or negotiated
+	std::atomic<bool> acknowledged{false};
+	//Send can be called from other threads
+	bool threadSafe = false;
 	std::function<void(MessageType, const uint8_t*,uint64_t)> onMessage;
+	std::function<void(MessageType, Buffer&&)> onMessageBuffer;
 };
 
 }; //namespace impl
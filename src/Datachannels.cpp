@@ -1,7 +1,12 @@
 // Unity jumbo build file
+#include "Capture.cpp"
 #include "Datachannel.cpp"
 #include "Endpoint.cpp"
+#include "TimerWheel.cpp"
+#include "Trace.cpp"
 #include "sctp/Association.cpp"
+#include "sctp/AssociationManager.cpp"
+#include "sctp/Runtime.cpp"
 #include "sctp/PacketHeader.cpp"
 #include "sctp/Stream.cpp"
 #include "sctp/Chunk.cpp"
@@ -22,5 +27,8 @@
 #include "sctp/chunks/ForwardCumulativeTSNChunk.cpp"
 #include "sctp/chunks/UnknownChunk.cpp"
 #include "sctp/chunks/PaddingChunk.cpp"
+#include "dcep/Message.cpp"
+#include "dcep/DataChannelOpenMessage.cpp"
+#include "dcep/DataChannelAckMessage.cpp"
 
 
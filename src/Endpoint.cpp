@@ -16,23 +16,53 @@ namespace impl
 {
 
 Endpoint::Endpoint(datachannels::TimeService& timeService) :
-	association(sctp::Association::Create(timeService))
+	association(sctp::Association::Create(timeService)),
+	transport(*this)
 {
-	
+	//Listen for streams opened by the remote peer
+	association->OnIncomingStream([this](sctp::Stream& stream){
+		OnIncomingStream(stream);
+	});
+	//Dispatch the messages of all streams from a single handler
+	association->OnMessage([this](sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size){
+		OnMessage(stream,ppid,data,size);
+	});
 }
 
 Endpoint::~Endpoint()
 {
+	//Stop listening
+	association->OnIncomingStream(nullptr);
+	association->OnMessage(nullptr);
 	//Terminate association now!
 	association->Abort();
 }
 
 bool Endpoint::Init(const Options& options)
 {
+	//Store options
+	this->options = options;
+	
+	//Sending threads wake up the transport one with the pending data callback
+	association->OnSubmitted(options.threadSafeSend ? onPendingData : nullptr);
+
 	//Set ports on sctp
 	association->SetLocalPort(options.localPort);
 	association->SetRemotePort(options.remotePort);
 	
+	//If we have to capture packets
+	if (!options.capture.empty())
+	{
+		//Create capture file
+		auto capture = Capture::Open(options.capture);
+		//Check it
+		if (!capture)
+			//Error
+			return false;
+		//Dump all packets on it
+		association->SetCapture(capture);
+	}
+	
 	//If we are clients
 	if (options.setup==Setup::Client)
 		//Start association
@@ -42,9 +72,97 @@ bool Endpoint::Init(const Options& options)
 	return true;
 }
 
-Datachannel::shared Endpoint::CreateDatachannel(const Datachannel::Options& options)
+datachannels::Datachannel::shared Endpoint::CreateDatachannel(const datachannels::Datachannel::Options& options)
+{
+	//Wider than a stream id, so the search for a free one can't wrap around
+	uint32_t id = options.id;
+	
+	//If it was not negotiated out-of-band
+	if (!options.negotiated)
+	{
+		//rfc8832#section-6
+		//	The DTLS role of the SCTP transport determines if the peer uses the
+		//	even or odd stream identifiers: the DTLS client MUST use even
+		//	identifiers and the DTLS server MUST use odd identifiers.
+		id = this->options.setup==Setup::Client ? 0 : 1;
+		//Find first free one
+		while (id<=MaxStreamId && association->GetStream(id))
+			id += 2;
+	}
+	
+	//Check it is valid
+	if (id>MaxStreamId)
+		//Error
+		return nullptr;
+	
+	//Get stream
+	auto stream = association->GetStream(id);
+	
+	//If it is already in use
+	if (stream)
+	{
+		//The remote peer may have sent data on a negotiated channel before we created it
+		auto existing = datachannels.Get(id);
+		//Only reuse it if it was not opened
+		if (!options.negotiated || !existing || (*existing)->IsOpened())
+			//Error
+			return nullptr;
+	} else {
+		//Open new one
+		stream = &association->OpenStream(id);
+	}
+	
+	//Create datachannel and store it
+	auto& datachannel = datachannels.Emplace(id,std::make_shared<Datachannel>(association,*stream,options));
+	datachannel->SetThreadSafe(this->options.threadSafeSend);
+	
+	//Send DATA_CHANNEL_OPEN if not negotiated, data can be sent right after it
+	if (!datachannel->Open())
+	{
+		//Remove it
+		datachannels.Erase(id);
+		//Error
+		return nullptr;
+	}
+	
+	//Done
+	return std::static_pointer_cast<datachannels::Datachannel>(datachannel);
+}
+
+Datachannel* Endpoint::GetDatachannel(uint16_t id) const
+{
+	//Find it
+	auto datachannel = datachannels.Get(id);
+	//Return it if found
+	return datachannel ? datachannel->get() : nullptr;
+}
+
+void Endpoint::OnIncomingStream(sctp::Stream& stream)
+{
+	//Create datachannel waiting for the DATA_CHANNEL_OPEN from the remote peer
+	auto& datachannel = datachannels.Emplace(stream.GetId(),std::make_shared<Datachannel>(association,stream));
+	datachannel->SetThreadSafe(options.threadSafeSend);
+}
+
+void Endpoint::OnMessage(sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size)
 {
-	return nullptr;
+	//Get datachannel by reference, no ref counting on the message path
+	auto datachannel = datachannels.Get(stream.GetId());
+	
+	//Streams are only opened by us or by OnIncomingStream, but just in case
+	if (!datachannel)
+		return;
+	
+	//Check if it was opened before this message
+	bool opened = (*datachannel)->IsOpened();
+	
+	//Process it
+	(*datachannel)->OnStreamMessage(ppid,data,size);
+	
+	//If the remote peer has just opened it via DATA_CHANNEL_OPEN
+	if (!opened && (*datachannel)->IsOpened() && onDatachannel)
+		//Launch event
+		onDatachannel(*datachannel);
 }
 
 bool Endpoint::Close()
@@ -66,7 +184,33 @@ uint16_t Endpoint::GetRemotePort() const
 
 datachannels::Transport& Endpoint::GetTransport()
 {
-	return *association.get();
+	return transport;
+}
+
+size_t Endpoint::Transport::ReadPacket(uint8_t *data, uint32_t size)
+{
+	return endpoint.association->ReadPacket(data,size);
+}
+
+size_t Endpoint::Transport::ReadPacket(uint8_t *data, uint32_t size, std::vector<Slice>& slices)
+{
+	return endpoint.association->ReadPacket(data,size,slices);
+}
+
+size_t Endpoint::Transport::WritePacket(uint8_t *data, uint32_t size)
+{
+	return endpoint.association->WritePacket(data,size);
+}
+
+void Endpoint::Transport::OnPendingData(std::function<void(void)> callback)
+{
+	//Keep it in case thread safe send is enabled later on Init
+	endpoint.onPendingData = callback;
+	//Called from the transport thread
+	endpoint.association->OnPendingData(callback);
+	//And from the sending threads, swapped atomically as they may be running
+	if (endpoint.options.threadSafeSend)
+		endpoint.association->OnSubmitted(callback);
 }
 	
 }; // namespace impl
@@ -1,7 +1,9 @@
 #ifndef DATACHANNEL_IMPL_ENDPOINT_H_
 #define DATACHANNEL_IMPL_ENDPOINT_H_
 #include "Datachannels.h"
+#include "Datachannel.h"
 #include "sctp/Association.h"
+#include "StreamTable.h"
 
 namespace datachannels
 {
@@ -10,20 +12,59 @@ namespace impl
 
 class Endpoint : public datachannels::Endpoint
 {
+private:
+	// Transport handed to the embedder, forwarding to the association
+	//	With thread safe send the pending data callback is also set as the
+	//	submitted one, so it is called from the sending threads too.
+	class Transport : public datachannels::Transport
+	{
+	public:
+		Transport(Endpoint& endpoint) : endpoint(endpoint) {}
+		
+		using datachannels::Transport::ReadPacket;
+		virtual size_t ReadPacket(uint8_t *data, uint32_t size) override;
+		virtual size_t ReadPacket(uint8_t *data, uint32_t size, std::vector<Slice>& slices) override;
+		virtual size_t WritePacket(uint8_t *data, uint32_t size) override;
+		virtual void OnPendingData(std::function<void(void)> callback) override;
+	private:
+		Endpoint& endpoint;
+	};
+public:
+	// rfc8832#section-6
+	//	The stream identifier 65535 is reserved due to SCTP INIT and
+	//	INIT-ACK chunks only allowing a maximum of 65535 streams.
+	static constexpr const uint16_t MaxStreamId = 65534;
 public:
 	Endpoint(TimeService& timeService);
 	virtual ~Endpoint();
 	
 	virtual bool Init(const Options& options)  override;
-	virtual Datachannel::shared CreateDatachannel(const Datachannel::Options& options)  override;
+	virtual datachannels::Datachannel::shared CreateDatachannel(const datachannels::Datachannel::Options& options)  override;
 	virtual bool Close()  override;
 	
 	// Getters
 	virtual uint16_t GetLocalPort() const override;
 	virtual uint16_t GetRemotePort() const override;
 	virtual datachannels::Transport& GetTransport() override;
+	Datachannel* GetDatachannel(uint16_t id) const;
+	
+	// Event handlers
+	virtual void OnDatachannel(const std::function<void(const datachannels::Datachannel::shared&)>& callback) override
+	{
+		//Store callback
+		onDatachannel = callback;
+	}
+private:
+	void OnIncomingStream(sctp::Stream& stream);
+	void OnMessage(sctp::Stream& stream, uint32_t ppid, const uint8_t* data, uint64_t size);
 private:
+	Options options;
 	std::shared_ptr<sctp::Association> association;
+	Transport transport;
+	//Datachannels indexed by stream id
+	StreamTable<std::shared_ptr<Datachannel>> datachannels;
+	std::function<void(const datachannels::Datachannel::shared&)> onDatachannel;
+	std::function<void(void)> onPendingData;
 };
 
 }; //namespace impl
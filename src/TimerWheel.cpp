@@ -0,0 +1,285 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+namespace datachannels
+{
+
+TimerWheel::TimerImpl::TimerImpl(TimerWheel& wheel, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> callback) :
+	wheel(&wheel),
+	repeat(repeat),
+	callback(std::move(callback))
+{
+}
+
+TimerWheel::TimerImpl::~TimerImpl()
+{
+	//Remove from wheel if still linked
+	if (wheel && scheduled)
+		wheel->Unschedule(this);
+}
+
+void TimerWheel::TimerImpl::Cancel()
+{
+	//We don't have to repeat this
+	repeat = std::chrono::milliseconds(0);
+	
+	//Remove from wheel
+	if (wheel && scheduled)
+		wheel->Unschedule(this);
+}
+
+void TimerWheel::TimerImpl::Again(const std::chrono::milliseconds& ms)
+{
+	//Check wheel is still alive
+	if (!wheel)
+		return;
+	
+	//Remove from current slot
+	if (scheduled)
+		wheel->Unschedule(this);
+	
+	//Schedule again
+	wheel->Schedule(this,wheel->current + ms.count());
+}
+
+TimerWheel::TimerWheel(const std::chrono::milliseconds& now) :
+	current(now.count())
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+	//Detach all the timers still alive
+	auto detach = [](TimerImpl* timer) {
+		while (timer)
+		{
+			auto next = timer->next;
+			timer->wheel = nullptr;
+			timer->scheduled = false;
+			timer->prev = timer->next = nullptr;
+			timer = next;
+		}
+	};
+	for (auto& level : slots)
+		for (auto& slot : level)
+			detach(slot);
+}
+
+const std::chrono::milliseconds TimerWheel::GetNow() const
+{
+	return std::chrono::milliseconds(current);
+}
+
+Timer::shared TimerWheel::CreateTimer(std::function<void(std::chrono::milliseconds)> callback)
+{
+	//Create timer without scheduling it
+	return std::make_shared<TimerImpl>(*this,std::chrono::milliseconds(0),std::move(callback));
+}
+
+Timer::shared TimerWheel::CreateTimer(const std::chrono::milliseconds& ms, std::function<void(std::chrono::milliseconds)> timeout)
+{
+	//Timer without repeat
+	return CreateTimer(ms,std::chrono::milliseconds(0),std::move(timeout));
+}
+
+Timer::shared TimerWheel::CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> timeout)
+{
+	//Create timer
+	auto timer = std::make_shared<TimerImpl>(*this,repeat,std::move(timeout));
+	
+	//Schedule it
+	Schedule(timer.get(),current + ms.count());
+	
+	//Done
+	return timer;
+}
+
+void TimerWheel::Schedule(TimerImpl* timer, uint64_t deadline)
+{
+	//Set expiration, not before next tick
+	timer->deadline = std::max(deadline,current+1);
+	timer->scheduled = true;
+	
+	//Add to slot
+	Link(timer);
+	
+	//One more
+	scheduled++;
+}
+
+void TimerWheel::Link(TimerImpl* timer)
+{
+	//Get distance in ticks, clamping the ones out of range to the last level
+	uint64_t delta = std::min(timer->deadline - current, MaxTicks);
+	uint64_t tick = current + delta;
+	
+	//Find the level which covers that distance
+	size_t level = 0;
+	while (level<Levels-1 && delta>=(1ull << (SlotBits*(level+1))))
+		level++;
+	
+	//Get slot for the tick on that level
+	size_t slot = (tick >> (SlotBits*level)) & SlotMask;
+	
+	timer->level = level;
+	timer->slot = slot;
+	TimerImpl** head = &slots[level][slot];
+	
+	//Slot is not empty now
+	bitmaps[level] |= 1ull << slot;
+	
+	//Link at the head
+	timer->prev = nullptr;
+	timer->next = *head;
+	if (*head)
+		(*head)->prev = timer;
+	*head = timer;
+}
+
+void TimerWheel::Unschedule(TimerImpl* timer)
+{
+	//Get list head
+	TimerImpl** head = &slots[timer->level][timer->slot];
+	
+	//Unlink
+	if (timer->prev)
+		timer->prev->next = timer->next;
+	else
+		*head = timer->next;
+	if (timer->next)
+		timer->next->prev = timer->prev;
+	
+	//If slot is empty now
+	if (!*head)
+		//Clear bit
+		bitmaps[timer->level] &= ~(1ull << timer->slot);
+	
+	//Not scheduled anymore
+	timer->prev = timer->next = nullptr;
+	timer->scheduled = false;
+	
+	//One less
+	scheduled--;
+}
+
+void TimerWheel::Cascade(size_t level)
+{
+	//Get slot for current tick on that level
+	size_t slot = (current >> (SlotBits*level)) & SlotMask;
+	
+	//Take the whole list
+	TimerImpl* timer = slots[level][slot];
+	slots[level][slot] = nullptr;
+	bitmaps[level] &= ~(1ull << slot);
+	
+	//Move them to lower levels
+	while (timer)
+	{
+		auto next = timer->next;
+		Link(timer);
+		timer = next;
+	}
+}
+
+void TimerWheel::Expire(TimerImpl*& head)
+{
+	//Fire all timers in the list, callbacks may arm or cancel any timer
+	while (head)
+	{
+		//Keep it alive while running, the callback may release the last reference
+		auto timer = head->shared_from_this();
+		
+		//Remove from wheel
+		Unschedule(timer.get());
+		
+		//Execute it
+		timer->callback(std::chrono::milliseconds(current));
+		
+		//If we have to reschedule it and the callback did not do it
+		if (timer->wheel && timer->repeat.count() && !timer->scheduled)
+			//Schedule again
+			Schedule(timer.get(),current + timer->repeat.count());
+	}
+}
+
+void TimerWheel::SetNow(const std::chrono::milliseconds& ms)
+{
+	uint64_t now = ms.count();
+	
+	//Ensure now is after now
+	if (now<current)
+		return;
+	
+	//Advance wheel
+	while (current<now)
+	{
+		//If there are no timers
+		if (!scheduled)
+		{
+			//Jump
+			current = now;
+			break;
+		}
+		
+		//Next tick to process
+		uint64_t tick = current + 1;
+		
+		//If it is not the start of a new round
+		if (tick & SlotMask)
+		{
+			//Find next non empty slot until end of the round
+			uint64_t pending = bitmaps[0] & (~0ull << (tick & SlotMask));
+			//Go to it or to the start of next round
+			tick = pending ? (tick & ~SlotMask) | __builtin_ctzll(pending) : (tick | SlotMask) + 1;
+		}
+		
+		//If it is in the future
+		if (tick>now)
+		{
+			//Nothing else to do
+			current = now;
+			break;
+		}
+		
+		//Move to it
+		current = tick;
+		
+		//If it is the start of a round
+		if (!(current & SlotMask))
+		{
+			//Find how many levels have completed a round
+			size_t level = 1;
+			while (level<Levels-1 && !((current >> (SlotBits*level)) & SlotMask))
+				level++;
+			//Move timers down from the top one
+			for (;level>0;--level)
+				Cascade(level);
+		}
+		
+		//Fire timers on slot
+		Expire(slots[0][current & SlotMask]);
+	}
+}
+
+std::optional<std::chrono::milliseconds> TimerWheel::GetNextTimeout() const
+{
+	//If there are no timers
+	if (!scheduled)
+		//Wait forever
+		return std::nullopt;
+	
+	//Next tick
+	uint64_t tick = current + 1;
+	
+	//Find next non empty slot until end of the round
+	uint64_t pending = (tick & SlotMask) ? bitmaps[0] & (~0ull << (tick & SlotMask)) : 0;
+	
+	//If found it is exact, if not we need to run at next round start to move timers down
+	uint64_t next = pending ? (tick & ~SlotMask) | __builtin_ctzll(pending) : (current | SlotMask) + 1;
+	
+	//Done
+	return std::chrono::milliseconds(next - current);
+}
+
+}; //namespace datachannels
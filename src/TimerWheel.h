@@ -0,0 +1,98 @@
+#ifndef DATACHANNEL_TIMERWHEEL_H_
+#define DATACHANNEL_TIMERWHEEL_H_
+#include <stdint.h>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "Datachannels.h"
+
+namespace datachannels
+{
+
+// Hierarchical hashed timing wheel
+//	Timers are kept in intrusive lists hanging from 4 levels of 64 slots of
+//	1ms, 64ms, 4s and 4.6min, so arming, cancelling and re-arming a timer is
+//	just linking or unlinking it from a slot. Timers are moved to the lower
+//	level when the wheel reaches their slot, and empty slots are skipped by
+//	checking a bitmap per level. Timers armed with no delay fire on the next
+//	tick. Not thread safe, like the rest of the library
+//	it must be driven from a single event loop calling SetNow.
+class TimerWheel : public TimeService
+{
+public:
+	static constexpr const size_t Levels	= 4;
+	static constexpr const size_t SlotBits	= 6;
+	static constexpr const size_t Slots	= 1 << SlotBits;
+	static constexpr const uint64_t SlotMask= Slots - 1;
+	//Timers further away than this are placed on the last slot and rescheduled when reached
+	static constexpr const uint64_t MaxTicks= (1ull << (SlotBits*Levels)) - 1;
+	
+	class TimerImpl : public Timer, public std::enable_shared_from_this<TimerImpl>
+	{
+	public:
+		using shared = std::shared_ptr<TimerImpl>;
+	public:
+		TimerImpl(TimerWheel& wheel, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> callback);
+		virtual ~TimerImpl();
+		
+		//Not copiable, it is linked on the wheel
+		TimerImpl(const TimerImpl&) = delete;
+		TimerImpl& operator=(const TimerImpl&) = delete;
+		
+		virtual void Cancel() override;
+		virtual void Again(const std::chrono::milliseconds& ms) override;
+		virtual std::chrono::milliseconds GetRepeat() const override { return repeat; }
+		
+		bool IsScheduled() const { return scheduled; }
+	private:
+		friend class TimerWheel;
+		
+		TimerWheel* wheel;
+		std::chrono::milliseconds repeat;
+		std::function<void(std::chrono::milliseconds)> callback;
+		//Absolute expiration tick
+		uint64_t deadline	= 0;
+		//Intrusive list on the slot
+		TimerImpl* prev		= nullptr;
+		TimerImpl* next		= nullptr;
+		uint8_t level		= 0;
+		uint8_t slot		= 0;
+		bool scheduled		= false;
+	};
+public:
+	TimerWheel(const std::chrono::milliseconds& now = std::chrono::milliseconds(0));
+	virtual ~TimerWheel();
+	
+	//Not copiable, timers point to us
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+	
+	// Advance the wheel firing all the timers expired up to now
+	void SetNow(const std::chrono::milliseconds& now);
+	// Maximum time the event loop can wait before calling SetNow again, none if there are no timers
+	std::optional<std::chrono::milliseconds> GetNextTimeout() const;
+	size_t GetScheduledCount() const { return scheduled; }
+	
+	virtual const std::chrono::milliseconds GetNow() const override;
+	virtual Timer::shared CreateTimer(std::function<void(std::chrono::milliseconds)> callback) override;
+	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, std::function<void(std::chrono::milliseconds)> timeout) override;
+	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> timeout) override;
+private:
+	void Schedule(TimerImpl* timer, uint64_t deadline);
+	void Unschedule(TimerImpl* timer);
+	void Link(TimerImpl* timer);
+	void Cascade(size_t level);
+	void Expire(TimerImpl*& head);
+private:
+	//Current tick, all slots before it have been processed
+	uint64_t current = 0;
+	size_t scheduled = 0;
+	std::array<std::array<TimerImpl*,Slots>,Levels> slots = {};
+	std::array<uint64_t,Levels> bitmaps = {};
+};
+
+}; //namespace datachannels
+#endif
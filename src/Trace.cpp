@@ -0,0 +1,160 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace datachannels::trace
+{
+
+namespace
+{
+	// Records are stored as relaxed atomic words, so the collector can copy a slot while it is overwritten
+	static constexpr const size_t Words = sizeof(Record)/sizeof(uint64_t);
+	static_assert(sizeof(Record)%sizeof(uint64_t)==0,"Record must be made of whole words");
+
+	// Single producer ring owned by a thread
+	//	Works as a seqlock: the collector copies the slots and then reads head
+	//	again to discard the ones the writer may have touched meanwhile.
+	struct Ring
+	{
+		uint32_t id = 0;
+		//Number of records ever written, next one goes to head % RingSize
+		std::atomic<uint64_t> head{0};
+		std::atomic<uint64_t> records[RingSize][Words] = {};
+		Ring* next = nullptr;
+	};
+
+	//Lock free list of all the rings
+	std::atomic<Ring*> rings{nullptr};
+	std::atomic<uint32_t> threads{0};
+
+	Ring* Register()
+	{
+		//Never freed, so records can be collected after the thread has finished
+		auto ring = new Ring();
+		ring->id = threads.fetch_add(1,std::memory_order_relaxed);
+		//Push it to the list
+		ring->next = rings.load(std::memory_order_relaxed);
+		while (!rings.compare_exchange_weak(ring->next,ring,std::memory_order_release,std::memory_order_relaxed));
+		return ring;
+	}
+}
+
+void Emit(Event event, uint32_t association, uint8_t type, uint8_t state, uint32_t tsn, uint32_t size)
+{
+	//Get ring for this thread, registered on first event
+	thread_local Ring* ring = Register();
+
+	//Get next slot, we are the only writer
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	auto& slot = ring->records[head & (RingSize-1)];
+
+	//Fill it
+	Record record;
+	record.timestamp	= std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	record.association	= association;
+	record.event		= event;
+	record.type		= type;
+	record.state		= state;
+	record.reserved		= 0;
+	record.tsn		= tsn;
+	record.size		= size;
+
+	//A collector seeing any word of the slot also sees the head published before overwriting it
+	std::atomic_thread_fence(std::memory_order_release);
+
+	//Store it
+	uint64_t words[Words];
+	memcpy(words,&record,sizeof(record));
+	for (size_t i=0; i<Words; ++i)
+		slot[i].store(words[i],std::memory_order_relaxed);
+
+	//Publish it
+	ring->head.store(head+1,std::memory_order_release);
+}
+
+std::vector<Thread> Collect()
+{
+	std::vector<Thread> collected;
+
+	//For each ring
+	for (Ring* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next)
+	{
+		auto& thread = collected.emplace_back();
+		thread.id = ring->id;
+
+		//Get published records
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		//The slot of the oldest one is the next to be written, so skip it
+		uint64_t first = head>=RingSize ? head-RingSize+1 : 0;
+
+		//Copy them
+		thread.records.resize(head-first);
+		for (uint64_t i=first; i<head; ++i)
+		{
+			uint64_t words[Words];
+			for (size_t j=0; j<Words; ++j)
+				words[j] = ring->records[i & (RingSize-1)][j].load(std::memory_order_relaxed);
+			memcpy(&thread.records[i-first],words,sizeof(Record));
+		}
+
+		//Check how many have been written while copying
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t last = ring->head.load(std::memory_order_relaxed);
+
+		//The slot of record last is being written, and it holds record last-RingSize
+		uint64_t valid = last>=RingSize ? last-RingSize+1 : 0;
+
+		//Drop the ones that could have been overwritten
+		if (valid>first)
+			thread.records.erase(thread.records.begin(),thread.records.begin()+std::min(valid-first,head-first));
+	}
+
+	//Done
+	return collected;
+}
+
+bool Save(const char* filename)
+{
+	//Open file
+	FILE* file = fopen(filename,"wb");
+	if (!file)
+		//Error
+		return false;
+
+	bool ok = fwrite(&Magic,sizeof(Magic),1,file)==1 && fwrite(&Version,sizeof(Version),1,file)==1;
+
+	//For each thread
+	for (const auto& thread : Collect())
+	{
+		uint32_t count = thread.records.size();
+		ok = ok && fwrite(&thread.id,sizeof(thread.id),1,file)==1;
+		ok = ok && fwrite(&count,sizeof(count),1,file)==1;
+		ok = ok && fwrite(thread.records.data(),sizeof(Record),count,file)==count;
+	}
+
+	//Done
+	return fclose(file)==0 && ok;
+}
+
+const char* GetName(Event event)
+{
+	switch (event)
+	{
+		case PacketRead:	return "PacketRead";
+		case PacketWritten:	return "PacketWritten";
+		case PacketDiscarded:	return "PacketDiscarded";
+		case ChunkProcessed:	return "ChunkProcessed";
+		case Acknowledge:	return "Acknowledge";
+		case ChunkEnqueued:	return "ChunkEnqueued";
+		case StreamEnqueued:	return "StreamEnqueued";
+		case StateChanged:	return "StateChanged";
+		case TimerExpired:	return "TimerExpired";
+		default:		return "Unknown";
+	}
+}
+
+}; // namespace datachannels::trace
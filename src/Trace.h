@@ -0,0 +1,74 @@
+#ifndef DATACHANNEL_TRACE_H_
+#define DATACHANNEL_TRACE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Binary event tracing for the packet and chunk lifecycle
+//	Trace points are compiled out unless the library is built with
+//	TRACE_EVENTS. When enabled each thread appends fixed size records to its
+//	own ring, so emitting is a clock read and a store without locks nor
+//	allocations, and the oldest records are overwritten when it is full.
+//	Rings are collected from any thread and saved to a binary file that the
+//	tracedump tool converts to JSON or to a Chrome trace.
+namespace datachannels::trace
+{
+
+enum Event : uint8_t
+{
+	PacketRead,		// Packet returned by ReadPacket, size is its length
+	PacketWritten,		// Packet passed to WritePacket, size is its length
+	PacketDiscarded,	// Packet dropped by WritePacket
+	ChunkProcessed,		// Received chunk, tsn and user data size for DATA, cumulative tsn ack for SACK
+	Acknowledge,		// SACK generated, tsn is the cumulative tsn ack and size the number of gap blocks
+	ChunkEnqueued,		// Control chunk queued for sending, size is the chunk size
+	StreamEnqueued,		// Stream scheduled for sending, tsn is the stream id and size its queued bytes
+	StateChanged,		// Association moved to state
+	TimerExpired,		// Protocol timer fired, type is the timeout
+	NumEvents
+};
+
+#pragma pack(push,1)
+struct Record
+{
+	uint64_t timestamp;	// Nanoseconds from the steady clock
+	uint32_t association;	// Local verification tag
+	uint8_t  event;
+	uint8_t  type;		// Chunk type or timeout
+	uint8_t  state;		// Association state after the event
+	uint8_t  reserved;
+	uint32_t tsn;
+	uint32_t size;
+};
+#pragma pack(pop)
+
+// Records kept per thread, must be a power of two
+static constexpr const size_t RingSize = 8192;
+
+// Records of a thread, oldest first
+struct Thread
+{
+	uint32_t id;
+	std::vector<Record> records;
+};
+
+// Binary file format: magic and version, then for each thread its id, the number of records and the records
+static constexpr const uint32_t Magic	= 0x44435452; // DCTR
+static constexpr const uint32_t Version	= 1;
+
+void Emit(Event event, uint32_t association, uint8_t type, uint8_t state, uint32_t tsn, uint32_t size);
+// Copy records of all threads, the ones overwritten while copying are skipped
+std::vector<Thread> Collect();
+bool Save(const char* filename);
+
+const char* GetName(Event event);
+
+}; // namespace datachannels::trace
+
+#ifdef TRACE_EVENTS
+#define TRACE_EVENT(...) datachannels::trace::Emit(__VA_ARGS__)
+#else
+#define TRACE_EVENT(...)
+#endif
+
+#endif
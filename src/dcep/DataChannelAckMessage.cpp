@@ -0,0 +1,47 @@
+#include "dcep/DataChannelAckMessage.h"
+
+namespace dcep
+{
+	
+size_t DataChannelAckMessage::GetSize() const
+{
+	//Message type
+	return 1;
+}
+
+size_t DataChannelAckMessage::Serialize(BufferWritter& writter) const
+{
+	//Check length
+	if (!writter.Assert(1))
+		return 0;
+	
+	//Get init pos
+	size_t ini = writter.Mark();
+	
+	//Write type
+	writter.Set1(type);
+	
+	//Done
+	return writter.GetOffset(ini);
+}
+	
+Message::shared DataChannelAckMessage::Parse(BufferReader& reader)
+{
+	//Check size
+	if (!reader.Assert(1)) 
+		//Error
+		return nullptr;
+	
+	//Check type
+	if (reader.Get1()!=Type::DataChannelAck)
+		//Error
+		return nullptr;
+		
+	//Create message
+	auto ack = std::make_shared<DataChannelAckMessage>();
+		
+	//Done
+	return std::static_pointer_cast<Message>(ack);
+}
+	
+};
@@ -0,0 +1,29 @@
+#ifndef DCEP_DATACHANNELACKMESSAGE_H_
+#define DCEP_DATACHANNELACKMESSAGE_H_
+
+#include "dcep/Message.h"
+
+namespace dcep
+{
+	
+class DataChannelAckMessage : public Message
+{
+public:
+	DataChannelAckMessage() : Message(Message::DataChannelAck) {}
+	virtual ~DataChannelAckMessage() = default;
+	
+	virtual size_t Serialize(BufferWritter& buffer) const override;
+	virtual size_t GetSize() const override;
+
+	static Message::shared Parse(BufferReader& reader);
+public:
+	//        0                   1                   2                   3
+	//        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+	//       +-+-+-+-+-+-+-+-+
+	//       |  Message Type |
+	//       +-+-+-+-+-+-+-+-+
+};
+
+}; // namespace dcep
+
+#endif
@@ -0,0 +1,75 @@
+#include "dcep/DataChannelOpenMessage.h"
+
+namespace dcep
+{
+	
+size_t DataChannelOpenMessage::GetSize() const
+{
+	//Header + label + protocol
+	return 12 + label.length() + protocol.length();
+}
+
+size_t DataChannelOpenMessage::Serialize(BufferWritter& writter) const
+{
+	//Check length
+	if (!writter.Assert(GetSize()))
+		return 0;
+	
+	//Get init pos
+	size_t ini = writter.Mark();
+	
+	//Write header
+	writter.Set1(type);
+	writter.Set1(channelType);
+	writter.Set2(priority);
+	writter.Set4(reliabilityParameter);
+	writter.Set2(label.length());
+	writter.Set2(protocol.length());
+	
+	//Write label and protocol
+	writter.Set(label);
+	writter.Set(protocol);
+	
+	//Done
+	return writter.GetOffset(ini);
+}
+	
+Message::shared DataChannelOpenMessage::Parse(BufferReader& reader)
+{
+	//Check size
+	if (!reader.Assert(12)) 
+		//Error
+		return nullptr;
+	
+	//Get header
+	uint8_t type	= reader.Get1();
+	
+	//Check type
+	if (type!=Type::DataChannelOpen)
+		//Error
+		return nullptr;
+		
+	//Create message
+	auto open = std::make_shared<DataChannelOpenMessage>();
+	
+	//Read params
+	open->channelType		= reader.Get1();
+	open->priority			= reader.Get2();
+	open->reliabilityParameter	= reader.Get4();
+	uint16_t labelLength		= reader.Get2();
+	uint16_t protocolLength		= reader.Get2();
+	
+	//Check size
+	if (!reader.Assert(labelLength+protocolLength)) 
+		//Error
+		return nullptr;
+	
+	//Get label and protocol
+	open->label	= reader.GetString(labelLength);
+	open->protocol	= reader.GetString(protocolLength);
+		
+	//Done
+	return std::static_pointer_cast<Message>(open);
+}
+	
+};
@@ -0,0 +1,47 @@
+#ifndef DCEP_DATACHANNELOPENMESSAGE_H_
+#define DCEP_DATACHANNELOPENMESSAGE_H_
+
+#include <string>
+#include "dcep/Message.h"
+
+namespace dcep
+{
+	
+class DataChannelOpenMessage : public Message
+{
+public:
+	DataChannelOpenMessage() : Message(Message::DataChannelOpen) {}
+	virtual ~DataChannelOpenMessage() = default;
+	
+	virtual size_t Serialize(BufferWritter& buffer) const override;
+	virtual size_t GetSize() const override;
+
+	static Message::shared Parse(BufferReader& reader);
+public:
+	//        0                   1                   2                   3
+	//        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	//       |  Message Type |  Channel Type |            Priority           |
+	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	//       |                    Reliability Parameter                      |
+	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	//       |         Label Length          |       Protocol Length         |
+	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	//       \                                                               /
+	//       |                             Label                             |
+	//       /                                                               \
+	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	//       \                                                               /
+	//       |                            Protocol                           |
+	//       /                                                               \
+	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	uint8_t channelType		= ChannelType::Reliable;
+	uint16_t priority		= 0;
+	uint32_t reliabilityParameter	= 0;
+	std::string label;
+	std::string protocol;
+};
+
+}; // namespace dcep
+
+#endif
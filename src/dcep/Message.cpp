@@ -0,0 +1,27 @@
+#include "dcep/Message.h"
+
+namespace dcep
+{
+	
+Message::shared Message::Parse(BufferReader& reader)
+{
+	//Ensure we have at laast the message type
+	if (!reader.Assert(1))
+		//Error
+		return nullptr;
+	
+	// Peek type
+	switch((Type)reader.Peek1())
+	{
+		case Type::DataChannelAck:
+			return DataChannelAckMessage::Parse(reader);
+		case Type::DataChannelOpen:
+			return DataChannelOpenMessage::Parse(reader);
+	}
+	
+	//rfc8832#section-5
+	//	Unknown message types MUST be ignored
+	return nullptr;
+}
+
+};
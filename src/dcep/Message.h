@@ -0,0 +1,60 @@
+#ifndef DCEP_MESSAGE_H_
+#define DCEP_MESSAGE_H_
+#include <stdint.h>
+#include <memory>
+
+#include "Buffer.h"
+#include "BufferReader.h"
+#include "BufferWritter.h"
+
+namespace dcep
+{
+
+// Data Channel Establishment Protocol rfc8832
+class Message
+{
+public:
+	using shared = std::shared_ptr<Message>;
+	
+	//rfc8832#section-8.2.1
+	enum Type
+	{
+		DataChannelAck		= 0x02,
+		DataChannelOpen		= 0x03,
+	};
+	
+	//rfc8832#section-8.2.2
+	enum ChannelType
+	{
+		Reliable			= 0x00,
+		ReliableUnordered		= 0x80,
+		PartialReliableRexmit		= 0x01,
+		PartialReliableRexmitUnordered	= 0x81,
+		PartialReliableTimed		= 0x02,
+		PartialReliableTimedUnordered	= 0x82,
+	};
+	
+	// rfc8832#section-8.1
+	//	The data channel protocol uses the SCTP PPID 50 (WebRTC DCEP)
+	static constexpr const uint32_t PayloadProtocolIdentifier = 50;
+	
+	Message(uint8_t type)
+	{
+		this->type = type;
+	}
+	virtual ~Message() = default;
+	
+	static Message::shared Parse(BufferReader& buffer);
+	virtual size_t GetSize() const = 0;
+	virtual size_t Serialize(BufferWritter& buffer) const = 0;
+	
+public:
+	uint8_t type;
+};
+
+}; // namespace dcep
+
+#include "dcep/DataChannelOpenMessage.h"
+#include "dcep/DataChannelAckMessage.h"
+
+#endif
@@ -3,15 +3,12 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <cstdlib>
+#include <algorithm>
 #include <cstring>
 #include <utility>
 #include <memory>
 
-//Allingment must be a power of 2
-inline int RoundUp(size_t alignment, size_t size) 
-{
-   return size ? (size + alignment - 1) & -alignment : 0;
-}
+#include "BufferPool.h"
 
 class Buffer
 {
@@ -19,38 +16,30 @@ public:
 	using shared = std::shared_ptr<Buffer>;
 	using unique = std::unique_ptr<Buffer>;
 public:
-        Buffer(const uint8_t* data, const size_t size)
-        {
-                //Set buffer size to a
-                capacity = RoundUp(64,size);
-                //Allocate memory
-#ifdef HAVE_STD_ALIGNED_ALLOC
-                buffer = (uint8_t*) std::aligned_alloc(64, this->capacity);
-#else
-                buffer = (uint8_t*) std::malloc(this->capacity);
-#endif
-                //Copy
-                memcpy(buffer,data,size);
-                //Reset size
-                this->size = size;
-        }
-
-        Buffer(size_t capacity = 0)
-        {
-                //Set buffer size
-                this->capacity = RoundUp(64,capacity);
-#ifdef HAVE_STD_ALIGNED_ALLOC
-                //Allocate memory
-                buffer = capacity ? (uint8_t*) std::aligned_alloc(64, this->capacity) : nullptr;
-#else
-                buffer = capacity ? (uint8_t*) std::malloc(this->capacity) : nullptr;
-#endif
-                //NO size
-                this->size = 0;
-        }
+	Buffer(const uint8_t* data, const size_t size, BufferAllocator* allocator = nullptr) :
+		allocator(allocator ? allocator : GetDefaultAllocator())
+	{
+		//Allocate memory
+		buffer = size ? this->allocator->Allocate(size,capacity) : nullptr;
+		//Copy
+		if (size)
+			memcpy(buffer,data,size);
+		//Reset size
+		this->size = size;
+	}
+
+	Buffer(size_t capacity = 0, BufferAllocator* allocator = nullptr) :
+		allocator(allocator ? allocator : GetDefaultAllocator())
+	{
+		//Allocate memory
+		buffer = capacity ? this->allocator->Allocate(capacity,this->capacity) : nullptr;
+		//NO size
+		this->size = 0;
+	}
 	
 	Buffer(Buffer &&other) noexcept
 	{
+		this->allocator = other.allocator;
 		this->capacity = other.capacity;
 		this->buffer = other.buffer;
 		this->size = other.size;
@@ -61,7 +50,8 @@ public:
 	
 	Buffer& operator=(Buffer&& other) noexcept
 	{
-		std::free(this->buffer);
+		Release();
+		this->allocator = other.allocator;
 		this->capacity = other.capacity;
 		this->buffer = other.buffer;
 		this->size = other.size;
@@ -77,12 +67,13 @@ public:
 	
 	~Buffer()
 	{
-		std::free(buffer);
+		Release();
 	}
 	
 	uint8_t* GetData() const		{ return buffer;		}
 	size_t GetCapacity() const		{ return capacity;		}
 	size_t GetSize() const			{ return size;			}
+	BufferAllocator* GetAllocator() const	{ return allocator;		}
 
 	bool IsEmpty() const			{ return !size;			}			
 
@@ -98,14 +89,33 @@ public:
 
 	void Alloc(size_t capacity)
 	{
-		//Calculate new size
-		this->capacity = capacity;
-		//Realloc
-		buffer = ( uint8_t*) std::realloc(buffer,capacity);
 		//Check new size
 		if (size>capacity)
 			//reduce size
 			size = capacity;
+		//Allocate new memory, the allocator may round the capacity up
+		size_t allocated = 0;
+		uint8_t* data = capacity ? allocator->Allocate(capacity,allocated) : nullptr;
+		//Copy previous content
+		if (size)
+			std::memcpy(data,buffer,size);
+		//Return old one, keeping the size
+		size_t size = this->size;
+		Release();
+		//Set new memory
+		buffer = data;
+		this->capacity = allocated;
+		this->size = size;
+	}
+
+	// Return memory to the allocator
+	void Release()
+	{
+		if (buffer)
+			allocator->Release(buffer,capacity);
+		buffer = nullptr;
+		capacity = 0;
+		size = 0;
 	}
 
 	void SetData(const uint8_t* data,const size_t size)
@@ -129,8 +139,8 @@ public:
 	{
 		//Check size
 		if (this->size+size>capacity)
-			//Allocate new size
-			Alloc(this->size+size);
+			//Grow geometrically so appending in small pieces is not quadratic
+			Alloc(std::max(this->size+size,capacity*2));
 		//Copy
 		std::memcpy(buffer+this->size,data,size);
 		//Increase size
@@ -151,12 +161,13 @@ public:
 	
 	Buffer Clone() const
 	{
-		return Buffer(buffer,size);
+		return Buffer(buffer,size,allocator);
 	}
 	
+	// Take ownership of memory allocated with malloc
 	static Buffer Wrap(uint8_t* data, size_t size)
 	{
-		Buffer buffer;
+		Buffer buffer(0,&SystemAllocator::GetInstance());
 		
 		buffer.buffer = data;
 		buffer.capacity = size;
@@ -169,8 +180,16 @@ public:
 	{
 		size = 0;
 	}
+
+	// Allocator used by buffers created without one, the per thread pool by default
+	static void SetDefaultAllocator(BufferAllocator* allocator)	{ defaultAllocator = allocator;								}
+	static BufferAllocator* GetDefaultAllocator()			{ return defaultAllocator ? defaultAllocator : &BufferPool::GetInstance();	}
 	
 protected:
+	//Constant initialized so buffers in other static objects can be created at any time
+	static inline BufferAllocator* defaultAllocator = nullptr;
+
+	BufferAllocator* allocator;
 	uint8_t* buffer		= nullptr;
 	size_t capacity		= 0;
 	size_t size		= 0;
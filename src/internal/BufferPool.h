@@ -0,0 +1,207 @@
+#ifndef LIBDATACHANNELS_INTERNAL_BUFFERPOOL_H_
+#define LIBDATACHANNELS_INTERNAL_BUFFERPOOL_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <cstdlib>
+#include <utility>
+
+//Allingment must be a power of 2
+inline size_t RoundUp(size_t alignment, size_t size)
+{
+   return size ? (size + alignment - 1) & -alignment : 0;
+}
+
+// Memory provider for Buffer
+class BufferAllocator
+{
+public:
+	virtual ~BufferAllocator() = default;
+	// Allocate at least size bytes aligned to 64 bytes, returning the usable capacity
+	virtual uint8_t* Allocate(size_t size, size_t& capacity) = 0;
+	// Release memory allocated by this allocator with the capacity it returned
+	virtual void Release(uint8_t* data, size_t capacity) = 0;
+};
+
+// Global allocator
+class SystemAllocator : public BufferAllocator
+{
+public:
+	static SystemAllocator& GetInstance()
+	{
+		static SystemAllocator instance;
+		return instance;
+	}
+
+	virtual uint8_t* Allocate(size_t size, size_t& capacity) override
+	{
+		//Round to cache line
+		capacity = RoundUp(64,size);
+#ifdef HAVE_STD_ALIGNED_ALLOC
+		return (uint8_t*) std::aligned_alloc(64,capacity);
+#else
+		return (uint8_t*) std::malloc(capacity);
+#endif
+	}
+
+	virtual void Release(uint8_t* data, size_t /*capacity*/) override
+	{
+		std::free(data);
+	}
+};
+
+// Per thread pool of fixed size blocks
+//	Blocks are taken from the global allocator the first time and kept on a
+//	free list per size class when released, so buffers of the usual SCTP
+//	sizes are recycled without touching the global allocator nor sharing
+//	any lock with other threads. Blocks released on a different thread than
+//	the one that allocated them go to the pool of the releasing thread.
+//	Larger buffers are taken from the global allocator directly.
+class BufferPool : public BufferAllocator
+{
+public:
+	// Small control messages, SACKs, DTLS/SCTP MTU, Ethernet MTU and large messages
+	static constexpr const std::array<size_t,5> SizeClasses = {64, 256, 1200, 1500, 16*1024};
+	// Memory kept on each free list of a thread, the rest is returned to the global allocator
+	static constexpr const size_t MaxCachedBytes = 1024*1024;
+
+	struct Stats
+	{
+		// Blocks taken from and returned to the global allocator
+		uint64_t allocated	= 0;
+		uint64_t freed		= 0;
+		// Blocks served from and returned to the free lists
+		uint64_t reused		= 0;
+		uint64_t recycled	= 0;
+		// Blocks on the free lists
+		size_t cached		= 0;
+	};
+private:
+	// Free block, the link is stored on the block itself
+	struct Block
+	{
+		Block* next;
+	};
+
+	struct Cache
+	{
+		std::array<Block*,SizeClasses.size()> free = {};
+		std::array<size_t,SizeClasses.size()> count = {};
+		Stats stats;
+
+		~Cache()
+		{
+			//Release all blocks
+			for (auto block : free)
+				while (block)
+					std::free(std::exchange(block,block->next));
+			//Buffers destroyed later on this thread use the global allocator
+			exited = true;
+		}
+	};
+public:
+	static BufferPool& GetInstance()
+	{
+		static BufferPool instance;
+		return instance;
+	}
+
+	virtual uint8_t* Allocate(size_t size, size_t& capacity) override
+	{
+		//Get size class
+		size_t index = GetSizeClass(size);
+
+		//If it is too big or the thread is exiting
+		if (index==SizeClasses.size() || exited)
+			//Use global allocator
+			return SystemAllocator::GetInstance().Allocate(size,capacity);
+
+		//All blocks of the class have the same size
+		capacity = GetBlockSize(index);
+
+		//If there is a free one
+		if (Block* block = cache.free[index])
+		{
+			//Take it
+			cache.free[index] = block->next;
+			cache.count[index]--;
+			cache.stats.reused++;
+			return reinterpret_cast<uint8_t*>(block);
+		}
+
+		//Allocate new one
+		cache.stats.allocated++;
+		return SystemAllocator::GetInstance().Allocate(capacity,capacity);
+	}
+
+	virtual void Release(uint8_t* data, size_t capacity) override
+	{
+		//Get size class, blocks have the exact size of their class
+		size_t index = GetSizeClass(capacity);
+
+		//If it does not belong to a class, the thread is exiting or the list is full
+		if (index==SizeClasses.size() || capacity!=GetBlockSize(index) || exited || (cache.count[index]+1)*capacity>MaxCachedBytes)
+		{
+			//Return it
+			if (index<SizeClasses.size() && !exited)
+				cache.stats.freed++;
+			SystemAllocator::GetInstance().Release(data,capacity);
+			return;
+		}
+
+		//Add it to the free list
+		Block* block = reinterpret_cast<Block*>(data);
+		block->next = cache.free[index];
+		cache.free[index] = block;
+		cache.count[index]++;
+		cache.stats.recycled++;
+	}
+
+	// Return the cached blocks of this thread to the global allocator
+	void Trim()
+	{
+		for (size_t i=0; i<SizeClasses.size(); ++i)
+		{
+			while (Block* block = cache.free[i])
+			{
+				cache.free[i] = block->next;
+				std::free(block);
+				cache.stats.freed++;
+			}
+			cache.count[i] = 0;
+		}
+	}
+
+	// Counters of this thread
+	Stats GetStats() const
+	{
+		Stats stats = cache.stats;
+		for (auto count : cache.count)
+			stats.cached += count;
+		return stats;
+	}
+
+	static constexpr size_t GetSizeClass(size_t size)
+	{
+		//First class big enough
+		size_t index = 0;
+		while (index<SizeClasses.size() && GetBlockSize(index)<size)
+			++index;
+		return index;
+	}
+
+	static constexpr size_t GetBlockSize(size_t index)
+	{
+		//Keep cache line alignment of all blocks
+		return (SizeClasses[index] + 63) & ~static_cast<size_t>(63);
+	}
+private:
+	static thread_local Cache cache;
+	//Trivially destructible, so it is still valid while other thread locals are destroyed
+	static inline thread_local bool exited = false;
+};
+
+//Defined out of the class as its nested types must be complete
+inline thread_local BufferPool::Cache BufferPool::cache;
+
+#endif
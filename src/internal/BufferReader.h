@@ -8,9 +8,35 @@
 #include <limits>
 
 #include "Buffer.h"
+#include "ByteOrder.h"
 
 class BufferReader
 {
+public:
+	// Cursor over bytes already checked to be in the reader, reading them needs no more checks
+	class Window
+	{
+	public:
+		Window() = default;
+		
+		inline uint8_t  Get1()				{ return data[pos++];				}
+		inline uint16_t Get2()				{ return Get<uint16_t>();			}
+		inline uint32_t Get4()				{ return Get<uint32_t>();			}
+		inline uint64_t Get8()				{ return Get<uint64_t>();			}
+		inline uint32_t Get4Reversed()			{ return ByteSwap(Get<uint32_t>());		}
+		inline const uint8_t* GetData(size_t num)	{ const uint8_t* val = data+pos; pos+=num; return val;	}
+		size_t GetLeft() const				{ return size-pos;				}
+	private:
+		friend class BufferReader;
+		Window(const uint8_t* data, size_t size) : data(data), size(size) {}
+		
+		template<typename T>
+		inline T Get()					{ T val = LoadBigEndian<T>(data+pos); pos+=sizeof(T); return val;	}
+	private:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		size_t pos = 0;
+	};
 public:
 	BufferReader() = default;
 	BufferReader(const Buffer& buffer)  :
@@ -107,6 +133,15 @@ public:
 	}
 	
 	bool   Assert(size_t num) const 	{ return pos+num<=size;	}
+	// Check num bytes are left and consume them, so they are read from the window without further checks
+	bool   GetWindow(size_t num, Window& window)
+	{
+		if (!Assert(num))
+			return false;
+		window = Window(data+pos,num);
+		pos += num;
+		return true;
+	}
 	void   GoTo(size_t mark) 		{ pos = mark;		}
 	size_t Skip(size_t num) 		{ size_t mark = pos; pos += num; return mark;	}
 	int64_t  GetOffset(size_t mark) const 	{ return pos-mark;	}
@@ -6,9 +6,35 @@
 #include <string>
 
 #include "Buffer.h"
+#include "ByteOrder.h"
 
 class BufferWritter
 {
+public:
+	// Cursor over bytes already checked to fit in the writter, writing them needs no more checks
+	class Window
+	{
+	public:
+		Window() = default;
+		
+		inline void Set1(uint8_t val)			{ data[pos++] = val;				}
+		inline void Set2(uint16_t val)			{ Set<uint16_t>(val);				}
+		inline void Set4(uint32_t val)			{ Set<uint32_t>(val);				}
+		inline void Set8(uint64_t val)			{ Set<uint64_t>(val);				}
+		inline void Set4Reversed(uint32_t val)		{ Set<uint32_t>(ByteSwap(val));			}
+		inline uint8_t* Consume(size_t num)		{ uint8_t* consumed = data+pos; pos+=num; return consumed;	}
+		size_t GetLeft() const				{ return size-pos;				}
+	private:
+		friend class BufferWritter;
+		Window(uint8_t* data, size_t size) : data(data), size(size) {}
+		
+		template<typename T>
+		inline void Set(T val)				{ StoreBigEndian<T>(data+pos,val); pos+=sizeof(T);	}
+	private:
+		uint8_t* data = nullptr;
+		size_t size = 0;
+		size_t pos = 0;
+	};
 public:
 	BufferWritter(Buffer& buffer)
 	{
@@ -155,6 +181,15 @@ public:
 	uint8_t* Consume(size_t num)		{ uint8_t* consumed = data + pos; pos += num; return consumed;	}
 
 	bool   Assert(size_t num) const 	{ return pos+num<=size;	}
+	// Check num bytes fit and reserve them, so they are written through the window without further checks
+	bool   GetWindow(size_t num, Window& window)
+	{
+		if (!Assert(num))
+			return false;
+		window = Window(data+pos,num);
+		pos += num;
+		return true;
+	}
 	void   GoTo(size_t mark) 		{ pos = mark;		}
 	size_t Skip(size_t num) 		{ size_t mark = pos; pos += num; return mark;	}
 	int64_t  GetOffset(size_t mark) const 	{ return pos-mark;	}
@@ -0,0 +1,54 @@
+#ifndef LIBDATACHANNELS_INTERNAL_BYTEORDER_H_
+#define LIBDATACHANNELS_INTERNAL_BYTEORDER_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <cstring>
+#include <type_traits>
+
+// Network byte order loads and stores of unaligned unsigned integers
+//	They are done with a memcpy and a byte swap, which the compiler turns
+//	into a single load or store plus bswap and can merge with the adjacent ones.
+
+template<typename T>
+inline T ByteSwap(T value)
+{
+	static_assert(std::is_unsigned_v<T>, "Only unsigned integers");
+#if defined(__GNUC__) || defined(__clang__)
+	if constexpr (sizeof(T)==1)
+		return value;
+	else if constexpr (sizeof(T)==2)
+		return __builtin_bswap16(value);
+	else if constexpr (sizeof(T)==4)
+		return __builtin_bswap32(value);
+	else
+		return __builtin_bswap64(value);
+#else
+	T swapped = 0;
+	for (size_t i=0; i<sizeof(T); ++i)
+		swapped = static_cast<T>(swapped << 8 | ((value >> (8*i)) & 0xFF));
+	return swapped;
+#endif
+}
+
+template<typename T>
+inline T LoadBigEndian(const uint8_t* data)
+{
+	T value;
+	std::memcpy(&value,data,sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return value;
+#else
+	return ByteSwap(value);
+#endif
+}
+
+template<typename T>
+inline void StoreBigEndian(uint8_t* data, T value)
+{
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+	value = ByteSwap(value);
+#endif
+	std::memcpy(data,&value,sizeof(T));
+}
+
+#endif
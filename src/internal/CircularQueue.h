@@ -0,0 +1,111 @@
+#ifndef LIBDATACHANNELS_INTERNAL_CIRCULARQUEUE_H_
+#define LIBDATACHANNELS_INTERNAL_CIRCULARQUEUE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+// Double ended queue stored on a power of two ring
+//	Unlike std::deque it never releases memory when items are popped, so a
+//	queue that is pushed and popped at a steady rate stops allocating once it
+//	has grown to its working size. Popped slots are reset to a default
+//	constructed item so any resource they hold is released straight away.
+template<typename T>
+class CircularQueue
+{
+private:
+	template<typename Queue, typename Item>
+	class Iterator
+	{
+	public:
+		Iterator(Queue* queue, size_t index) : queue(queue), index(index) {}
+		Item& operator*() const				{ return (*queue)[index];		}
+		Item* operator->() const			{ return &(*queue)[index];		}
+		Iterator& operator++()				{ ++index; return *this;		}
+		bool operator==(const Iterator& other) const	{ return index==other.index;		}
+		bool operator!=(const Iterator& other) const	{ return index!=other.index;		}
+	private:
+		Queue* queue;
+		size_t index;
+	};
+public:
+	using iterator		= Iterator<CircularQueue,T>;
+	using const_iterator	= Iterator<const CircularQueue,const T>;
+public:
+	CircularQueue() = default;
+
+	bool empty() const			{ return !count;			}
+	size_t size() const			{ return count;				}
+	size_t capacity() const			{ return items.size();			}
+
+	T& operator[](size_t i)			{ return items[(head+i) & mask];	}
+	const T& operator[](size_t i) const	{ return items[(head+i) & mask];	}
+	T& front()				{ return items[head];			}
+	const T& front() const			{ return items[head];			}
+	T& back()				{ return (*this)[count-1];		}
+	const T& back() const			{ return (*this)[count-1];		}
+
+	iterator begin()			{ return iterator(this,0);		}
+	iterator end()				{ return iterator(this,count);		}
+	const_iterator begin() const		{ return const_iterator(this,0);	}
+	const_iterator end() const		{ return const_iterator(this,count);	}
+
+	void push_back(const T& item)		{ emplace_back() = item;		}
+	void push_back(T&& item)		{ emplace_back() = std::move(item);	}
+
+	T& emplace_back()
+	{
+		//If it is full
+		if (count==items.size())
+			//Double the ring
+			grow(count ? count*2 : 8);
+		//Get slot after last one, it is already default constructed
+		return items[(head+count++) & mask];
+	}
+
+	void pop_front()
+	{
+		//Release item
+		items[head] = T();
+		//Move head
+		head = (head+1) & mask;
+		count--;
+	}
+
+	void clear()
+	{
+		//Release all items but keep the ring
+		while (count)
+			pop_front();
+		head = 0;
+	}
+
+	void reserve(size_t size)
+	{
+		//Get next power of two
+		size_t capacity = 8;
+		while (capacity<size)
+			capacity *= 2;
+		//Only grow
+		if (capacity>items.size())
+			grow(capacity);
+	}
+private:
+	void grow(size_t capacity)
+	{
+		std::vector<T> ring(capacity);
+		//Move items in order to the begining of the new ring
+		for (size_t i=0;i<count;++i)
+			ring[i] = std::move((*this)[i]);
+		items = std::move(ring);
+		head = 0;
+		mask = capacity-1;
+	}
+private:
+	std::vector<T> items;
+	size_t head = 0;
+	size_t count = 0;
+	size_t mask = 0;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef LIBDATACHANNELS_INTERNAL_FIXEDLAYOUT_H_
+#define LIBDATACHANNELS_INTERNAL_FIXEDLAYOUT_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+#include "ByteOrder.h"
+#include "BufferReader.h"
+#include "BufferWritter.h"
+
+// Wire format of a fixed size header, as the list of its big endian fields in order
+//	Size and field offsets are known at compile time, so the whole header is
+//	written or read after a single bounds check with a sequence of stores or
+//	loads the compiler can merge, and serializing and parsing use the same
+//	description so they can't drift apart.
+template<typename... Fields>
+class FixedLayout
+{
+	static_assert((std::is_unsigned_v<Fields> && ...), "Fields must be unsigned integers");
+public:
+	static constexpr const size_t Size = (sizeof(Fields) + ... + 0);
+
+	// Write all fields, returns the position after them or 0 if they don't fit
+	static size_t Serialize(BufferWritter& writter, Fields... values)
+	{
+		//Check length once
+		if (!writter.Assert(Size))
+			return 0;
+		//Get memory for all of them
+		uint8_t* data = writter.Consume(Size);
+		//Store each one at its offset
+		size_t offset = 0;
+		((StoreBigEndian<Fields>(data+offset,values), offset += sizeof(Fields)), ...);
+		return writter.Mark();
+	}
+
+	// Read all fields, fails without reading any if they are not all in the reader
+	static bool Parse(BufferReader& reader, Fields&... values)
+	{
+		//Check length once
+		if (!reader.Assert(Size))
+			return false;
+		//Get all of them
+		const uint8_t* data = reader.GetData(Size);
+		//Load each one from its offset
+		size_t offset = 0;
+		((values = LoadBigEndian<Fields>(data+offset), offset += sizeof(Fields)), ...);
+		return true;
+	}
+};
+
+#endif
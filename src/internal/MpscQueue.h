@@ -0,0 +1,84 @@
+#ifndef LIBDATACHANNELS_INTERNAL_MPSCQUEUE_H_
+#define LIBDATACHANNELS_INTERNAL_MPSCQUEUE_H_
+#include <atomic>
+#include <utility>
+
+// Unbounded lock free multiple producer single consumer queue
+//	Items are pushed to an intrusive linked list with a single atomic
+//	exchange, so producers never wait on each other nor on the consumer.
+//	Only one thread can pop, and a pop may miss an item whose producer has
+//	exchanged the head but not linked it yet; it will be returned by the
+//	next pop, so consumers must be signaled after the push completes.
+template<typename T>
+class MpscQueue
+{
+private:
+	struct Node
+	{
+		std::atomic<Node*> next{nullptr};
+		T item;
+	};
+public:
+	MpscQueue() :
+		head(&stub),
+		tail(&stub)
+	{
+	}
+
+	~MpscQueue()
+	{
+		//Release pending items
+		T item;
+		while (pop(item));
+		//Release last consumed node
+		if (tail!=&stub)
+			delete tail;
+	}
+
+	//Not copiable
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// Can be called from any thread
+	void push(T&& item)
+	{
+		//Create node
+		Node* node = new Node();
+		node->item = std::move(item);
+		//Make it the new head
+		Node* prev = head.exchange(node,std::memory_order_acq_rel);
+		//Link it after the previous one so the consumer can reach it
+		prev->next.store(node,std::memory_order_release);
+	}
+
+	// Only from the consumer thread
+	bool pop(T& item)
+	{
+		//Get first item after the last consumed node
+		Node* next = tail->next.load(std::memory_order_acquire);
+		//If there is none or it is not linked yet
+		if (!next)
+			//Empty
+			return false;
+		//Move it out, next becomes the consumed node
+		item = std::move(next->item);
+		next->item = T();
+		//Release previous consumed node
+		if (tail!=&stub)
+			delete tail;
+		tail = next;
+		return true;
+	}
+
+	// Only from the consumer thread
+	bool empty() const
+	{
+		return !tail->next.load(std::memory_order_acquire);
+	}
+private:
+	Node stub;
+	std::atomic<Node*> head;
+	Node* tail;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef LIBDATACHANNELS_INTERNAL_STREAMTABLE_H_
+#define LIBDATACHANNELS_INTERNAL_STREAMTABLE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Two-level page table indexed by a 16 bit stream id
+//	Slots are stored by value inside fixed size pages that are only allocated
+//	when a stream id falling in them is first used, so lookup is two array
+//	indexes and the address of a stored item never changes while it lives.
+template<typename T, size_t PageBits = 4>
+class StreamTable
+{
+public:
+	static constexpr const size_t PageSize = 1 << PageBits;
+	static constexpr const size_t PageMask = PageSize - 1;
+	static constexpr const size_t MaxPages = 0x10000 >> PageBits;
+private:
+	using Page = std::array<std::optional<T>,PageSize>;
+public:
+	StreamTable() = default;
+
+	//Not copiable
+	StreamTable(const StreamTable&) = delete;
+	StreamTable& operator=(const StreamTable&) = delete;
+
+	inline T* Get(uint16_t id) const
+	{
+		//Get page index
+		size_t index = id >> PageBits;
+		//Check if page is allocated
+		if (index>=pages.size() || !pages[index])
+			//Not found
+			return nullptr;
+		//Get slot
+		auto& slot = (*pages[index])[id & PageMask];
+		//Return item if present
+		return slot ? const_cast<T*>(&*slot) : nullptr;
+	}
+
+	template<typename ...Args>
+	T& Emplace(uint16_t id, Args&& ...args)
+	{
+		//Get page index
+		size_t index = id >> PageBits;
+		//Grow directory if needed
+		if (index>=pages.size())
+			pages.resize(index+1);
+		//Allocate page lazily
+		if (!pages[index])
+			pages[index] = std::make_unique<Page>();
+		//Get slot
+		auto& slot = (*pages[index])[id & PageMask];
+		//If it was empty
+		if (!slot)
+			//One more
+			count++;
+		//Construct in place
+		return slot.emplace(std::forward<Args>(args)...);
+	}
+
+	bool Erase(uint16_t id)
+	{
+		//Get page index
+		size_t index = id >> PageBits;
+		//Check if page is allocated
+		if (index>=pages.size() || !pages[index])
+			//Not found
+			return false;
+		//Get slot
+		auto& slot = (*pages[index])[id & PageMask];
+		//If it was not present
+		if (!slot)
+			//Not found
+			return false;
+		//Destroy item
+		slot.reset();
+		//One less
+		count--;
+		//Done
+		return true;
+	}
+
+	template<typename Func>
+	void ForEach(Func&& func)
+	{
+		//For each allocated page
+		for (size_t i=0;i<pages.size();++i)
+		{
+			//Skip unallocated ones
+			if (!pages[i])
+				continue;
+			//For each slot
+			for (size_t j=0;j<PageSize;++j)
+			{
+				auto& slot = (*pages[i])[j];
+				//If present
+				if (slot)
+					//Call with id and item
+					func(static_cast<uint16_t>(i<<PageBits | j),*slot);
+			}
+		}
+	}
+
+	void Clear()
+	{
+		pages.clear();
+		count = 0;
+	}
+
+	size_t GetCount() const	{ return count;		}
+	bool IsEmpty() const	{ return !count;	}
+
+private:
+	std::vector<std::unique_ptr<Page>> pages;
+	size_t count = 0;
+};
+
+#endif
@@ -1,7 +1,10 @@
 #include "sctp/Association.h"
 #include "sctp/Chunk.h"
+#include "Trace.h"
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
 #include <random>
 #include <crc32c/crc32c.h>
 #include <condition_variable>
@@ -9,14 +12,29 @@
 namespace sctp
 {
 	
-//Random stuff
-std::random_device rd;
-std::mt19937 gen{rd()};
-std::uniform_int_distribution<unsigned long> dis{1, 4294967295};
+//Random stuff, per thread as associations may run on different workers
+thread_local std::mt19937 gen{std::random_device{}()};
+thread_local std::uniform_int_distribution<unsigned long> dis{1, 4294967295};
 
 Association::Association(datachannels::TimeService& timeService) :
-	TimeServiceWrapper<Association>(timeService)
+	TimeServiceWrapper<Association>(timeService),
+	timeService(timeService)
 {
+	//rfc4960#section-7.2.1
+	//	The initial cwnd before DATA transmission or after a sufficiently
+	//	long idle period MUST be set to min(4*MTU, max (2*MTU, 4380
+	//	bytes)).
+	congestionWindow = std::min(4*MaxPacketSize, std::max<size_t>(2*MaxPacketSize, 4380));
+	//	The initial value of ssthresh MAY be arbitrarily high (for
+	//	example, implementations MAY use the size of the receiver
+	//	advertised window).
+	slowStartThreshold = std::numeric_limits<uint32_t>::max();
+	
+	//No timer running
+	deadlines.fill(Never);
+	
+	//Enough for the chunks of any usual packet, so the receiving path doesn't allocate
+	chunkIndex.reserve(MaxPacketSize/(PayloadDataChunk::HeaderSize+4));
 }
 
 Association::~Association()
@@ -27,33 +45,132 @@ Association::~Association()
 
 void Association::ResetTimers()
 {
-	//Reset any pending timer
-	if (sackTimer)
+	//Stop all protocol timers
+	deadlines.fill(Never);
+	//No need to retransmit anything
+	t1Chunk = nullptr;
+	//Cancel embedder timer
+	if (timer)
+		timer->Cancel();
+	//Not armed
+	timerDeadline = Never;
+}
+
+void Association::StartTimer(Timeout timeout, std::chrono::milliseconds ms)
+{
+	//Get deadline
+	auto deadline = timeService.GetNow() + ms;
+	
+	//Set it, restarting it if it was already running
+	deadlines[timeout] = deadline;
+	
+	//If the embedder timer will fire before
+	if (timerDeadline<=deadline)
+		//Nothing else, OnTimer will rearm it for this one
+		return;
+	
+	//If not created yet
+	if (!timer)
+		//Create timer without scheduling it
+		timer = CreateTimerSafe([this](std::chrono::milliseconds now){
+			OnTimer(now);
+		});
+	
+	//Arm it for the new earliest deadline
+	timer->Again(ms);
+	timerDeadline = deadline;
+}
+
+void Association::OnTimer(std::chrono::milliseconds now)
+{
+	//Not armed anymore
+	timerDeadline = Never;
+	
+	//For each protocol timer
+	for (size_t i=0; i<NumTimeouts; ++i)
 	{
-		//Cancel it
-		sackTimer->Cancel();
-		//Reset it
-		sackTimer = nullptr;
+		//If not expired
+		if (deadlines[i]>now)
+			//Skip
+			continue;
+		
+		//Stop it, the handler may restart it
+		deadlines[i] = Never;
+		TRACE_EVENT(datachannels::trace::TimerExpired,localVerificationTag,i,state,0,0);
+		
+		//Fire it
+		switch (i)
+		{
+			case T1:
+				OnT1Timeout();
+				break;
+			case T2:
+				OnT2Timeout();
+				break;
+			case T3:
+				OnRetransmissionTimeout();
+				break;
+			case T5:
+				OnShutdownGuardTimeout();
+				break;
+			case DelayedAck:
+				stats.delayedAcknowledgements++;
+				Acknowledge();
+				break;
+			case Heartbeat:
+				OnHeartbeatTimeout(now);
+				break;
+		}
 	}
-	if (cookieEchoTimer)
+	
+	//Get earliest deadline
+	auto next = *std::min_element(deadlines.begin(),deadlines.end());
+	
+	//If there is any timer running and the handlers have not armed the embedder timer before it
+	if (next!=Never && next<timerDeadline)
 	{
-		//Cancel it
-		cookieEchoTimer->Cancel();
-		//Reset it
-		cookieEchoTimer = nullptr;
+		//Arm it, expired timers (if any) are fired right away
+		timer->Again(std::max(next - now,0ms));
+		timerDeadline = next;
 	}
-	if (initTimer)
+}
+
+void Association::OnT1Timeout()
+{
+	//rfc4960#section-5.1
+	//	C) If the T1-init timer expires, the endpoint MUST retransmit INIT
+	//	and re-start the T1-init timer without changing state.  This MUST be
+	//	repeated up to 'Max.Init.Retransmits' times.  After that, the
+	//	endpoint MUST abort the initialization process and report the error
+	//	to the SCTP user.
+	//	The same applies to the COOKIE ECHO on T1-cookie expiration
+	if (t1Chunk && initRetransmissions++<MaxInitRetransmits)
 	{
-		//Cancel it
-		initTimer->Cancel();
-		//Reset it
-		initTimer = nullptr;
+		//Retransmit
+		Enqueue(t1Chunk);
+		//Retry again
+		StartTimer(T1,InitRetransmitTimeout);
+	} else {
+		//No more retransmissions
+		t1Chunk = nullptr;
+		//Close
+		SetState(State::Closed);
 	}
 }
 
 void Association::SetState(State state)
 {
 	this->state = state;
+	TRACE_EVENT(datachannels::trace::StateChanged,localVerificationTag,0,state,0,0);
+	
+	//If we can start sending data
+	if (state==State::Established)
+	{
+		//Streams could have enqueued messages before
+		SignalPendingData();
+		//Start monitoring the path
+		StartHeartbeatTimer();
+	}
 }
 
 bool Association::Associate()
@@ -81,10 +198,10 @@ bool Association::Associate()
 	
 	//Set params
 	init->initiateTag			= localVerificationTag;
-	init->advertisedReceiverWindowCredit	= 0;
+	init->advertisedReceiverWindowCredit	= localAdvertisedReceiverWindowCredit;
 	init->numberOfOutboundStreams		= 0xFFFF;
 	init->numberOfInboundStreams		= 0xFFFF;
-	init->initialTransmissionSequenceNumber = 0;
+	init->initialTransmissionSequenceNumber = static_cast<uint32_t>(nextTransmissionSequenceNumber);
 	
 	// draft-ietf-rtcweb-data-channel-13
 	//	The INIT and INIT-ACK chunk MUST NOT contain any IPv4 Address or
@@ -97,20 +214,9 @@ bool Association::Associate()
 	//	defined in [RFC6525].  Other features of [RFC5061] are OPTIONAL.
 	init->supportedExtensions.push_back(Chunk::Type::RE_CONFIG);
 		
-	//Set timer
-	initTimer = CreateTimerSafe(InitRetransmitTimeout,[=](...){
-		//Retransmit init chunk
-		if (initRetransmissions++<MaxInitRetransmits)
-		{
-			//Enquee
-			Enqueue(std::static_pointer_cast<Chunk>(init));
-			//Retry again
-			initTimer->Again(InitRetransmitTimeout);
-		} else {
-			//Close
-			SetState(State::Closed);
-		}
-	});
+	//Start T1-init timer
+	t1Chunk = init;
+	StartTimer(T1,InitRetransmitTimeout);
 	
 	//Change state
 	SetState(State::CookieWait);
@@ -122,11 +228,84 @@ bool Association::Associate()
 	return true;
 }
 
+bool Association::Discard(uint32_t size)
+{
+	//Count it
+	stats.packetsDiscarded++;
+	TRACE_EVENT(datachannels::trace::PacketDiscarded,localVerificationTag,0,state,0,size);
+	//Always false so it can be returned by WritePacket
+	return false;
+}
+
+Association::Stats Association::GetStats() const
+{
+	//Copy counters
+	Stats snapshot = stats;
+	
+	//Fill current values
+	snapshot.congestionWindow	= congestionWindow;
+	snapshot.slowStartThreshold	= slowStartThreshold;
+	snapshot.remoteReceiverWindow	= remoteAdvertisedReceiverWindowCredit;
+	snapshot.localReceiverWindow	= localAdvertisedReceiverWindowCredit;
+	snapshot.bytesInFlight		= bytesInFlight;
+	snapshot.outstandingChunks	= outstanding.size();
+	snapshot.queuedBytes		= queuedBytes;
+	snapshot.retransmissionTimeout	= retransmissionTimeout;
+	snapshot.smoothedRoundTripTime	= smoothedRoundTripTime;
+	
+	//Done
+	return snapshot;
+}
+
+Stream& Association::OpenStream(uint16_t id)
+{
+	//Check if it is already opened
+	if (auto stream = streams.Get(id))
+		//Reuse it
+		return *stream;
+	//Create it in place
+	return streams.Emplace(id,*this,id);
+}
+
 bool Association::Shutdown()
 {
-	//Reset timers
-	ResetTimers();
-	//TODO: Shutdown
+	//Depending on the state
+	switch (state)
+	{
+		case State::Closed:
+			//Nothing to close
+			return false;
+		case State::CookieWait:
+		case State::CookieEchoed:
+			//The peer has not set up the association yet, so there is no data to drain
+			CompleteShutdown();
+			return true;
+		case State::Established:
+			break;
+		default:
+			//Already shutting down
+			return true;
+	}
+	
+	//Messages already submitted from other threads were sent before the shutdown
+	if (submitted.load(std::memory_order_relaxed))
+		DrainSubmissions();
+	
+	//rfc4960#section-9.2
+	//	Upon receipt of the SHUTDOWN primitive from its upper layer, the
+	//	endpoint enters the SHUTDOWN-PENDING state and remains there until
+	//	all outstanding data has been acknowledged by its peer.
+	SetState(State::ShutdownPending);
+	
+	//	The sender of the SHUTDOWN MAY also start an overall guard timer
+	//	'T5-shutdown-guard' to bound the overall time for the shutdown
+	//	sequence.
+	StartTimer(T5,ShutdownGuardTimeout);
+	
+	//Send SHUTDOWN now if there is nothing to wait for
+	ContinueShutdown();
+	
+	//Done
 	return true;
 }
 
@@ -143,32 +322,134 @@ size_t Association::WritePacket(uint8_t *data, uint32_t size)
 	//Create reader
 	BufferReader reader(data,size);
 	
+	//Count it, even if it is discarded later
+	stats.packetsReceived++;
+	stats.bytesReceived += size;
+	TRACE_EVENT(datachannels::trace::PacketWritten,localVerificationTag,0,state,0,size);
+	
+	//If capturing
+	if (capture)
+		//Dump it before it is processed
+		capture->Write(datachannels::Capture::Inbound,data,size);
+	
 	//TODO: Check crc 
 	
-	//Parse packet header
-	auto header = PacketHeader::Parse(reader);
+	//Parse packet header in place
+	PacketHeader header;
 
 	//Ensure it was correctly parsed
-	if (!header)
-		//Error
-		return false;
+	if (!PacketHeader::Parse(reader,header))
+		//Malformed
+		return Discard(size);
 
 	//Check correct local and remote port
-	if (header->sourcePortNumber!=remotePort || header->destinationPortNumber!=localPort || header->verificationTag!=localVerificationTag)
-		//Error
-		return false;
+	if (header.sourcePortNumber!=remotePort || header.destinationPortNumber!=localPort)
+		//Not for us
+		return Discard(size);
+	
+	//rfc4960#section-8.5.1
+	//	A) Rules for packet carrying INIT:
+	//	-   When an endpoint receives an SCTP packet with the Verification
+	//	    Tag set to 0, it should verify that the packet contains only an
+	//	    INIT chunk.  Otherwise, the receiver MUST silently discard the
+	//	    packet.
+	//So a retransmitted INIT is accepted even if we already have chosen our tag
+	bool init = !header.verificationTag && reader.GetLeft()>=4 && reader.Peek1()==Chunk::Type::INIT;
 	
-	//Read chunks
-	while (reader.GetLeft()>4)
+	//Check verification tag
+	if (header.verificationTag!=localVerificationTag && !init)
+		//Out of the blue or spoofed
+		return Discard(size);
+	
+	//Check the chunk framing before processing any of them, so truncated packets are dropped whole
+	//Chunk bodies are only parsed when processed, so a malformed one is discarded after the previous ones took effect
+	if (!Chunk::Index(reader,chunkIndex))
+		//Malformed
+		return Discard(size);
+	
+	//Packets without tag can only carry the INIT, see above
+	if (!header.verificationTag && (chunkIndex.size()!=1 || chunkIndex[0].type!=Chunk::Type::INIT))
+		//Discard silently
+		return Discard(size);
+	
+	//If it has only DATA chunks in sequence for a single stream, and maybe a SACK
+	if (IsDataBatch(reader))
 	{
-		//Parse chunk
-		auto chunk = Chunk::Parse(reader);
-		//Check 
-		if (!chunk)
-			//Error
-			return false;
-		//Process it
-		Process(chunk);
+		//Process all of them at once
+		if (!ProcessDataBatch(reader))
+			//Malformed
+			return Discard(size);
+	}
+	//Read chunks one by one
+	else for (const auto& entry : chunkIndex)
+	{
+		//Count it
+		stats.chunksReceived[entry.type]++;
+		
+		//Parse it on its own reader, so it can't read past its padding
+		BufferReader chunk = reader.GetReader(entry.offset,SizePad(entry.length,4));
+		
+		//DATA and SACK chunks are parsed in place so the established path doesn't allocate
+		switch (entry.type)
+		{
+			case Chunk::Type::PDATA:
+			{
+				PayloadDataChunk::View pdata;
+				//Parse it pointing to the packet data
+				if (!PayloadDataChunk::Parse(chunk,pdata))
+					//Malformed
+					return Discard(size);
+				//Process it
+				Process(pdata);
+				break;
+			}
+			case Chunk::Type::SACK:
+			{
+				//Parse it reusing last one
+				if (!SelectiveAcknowledgementChunk::Parse(chunk,receivedAcknowledgement))
+					//Malformed
+					return Discard(size);
+				//Process it
+				Process(receivedAcknowledgement);
+				break;
+			}
+			default:
+			{
+				//Parse chunk
+				auto parsed = Chunk::Parse(chunk);
+				//Check 
+				if (!parsed)
+					//Malformed
+					return Discard(size);
+				//Process it
+				Process(parsed);
+			}
+		}
+	}
+	
+	//rfc4960#section-9.2
+	//	An endpoint in the SHUTDOWN-SENT state MUST immediately respond to
+	//	each received packet containing one or more DATA chunks with a
+	//	SHUTDOWN chunk and restart the T2-shutdown timer.  If a SHUTDOWN
+	//	chunk by itself cannot acknowledge all of the received DATA chunks
+	//	(i.e., there are TSNs that can be acknowledged that are larger than
+	//	the cumulative TSN, and thus gaps exist in the TSN sequence), or if
+	//	duplicate TSNs have been received, then a SACK chunk MUST also be
+	//	sent.
+	if (pendingAcknowledge && state==State::ShutDownSent)
+	{
+		//Send it again with the new cumulative tsn
+		SendShutdown();
+		//If it acknowledges everything
+		if (receivedOutOfOrder.empty() && duplicatedTransmissionSequenceNumbers.empty())
+		{
+			//No SACK needed
+			pendingAcknowledge = false;
+			StopTimer(DelayedAck);
+		} else {
+			//Send it along
+			pendingAcknowledgeTimeout = 0ms;
+		}
 	}
 	
 	//If we need to acknowledge
@@ -185,15 +466,12 @@ size_t Association::WritePacket(uint8_t *data, uint32_t size)
 		//	within 200 ms of the arrival of any unacknowledged DATA chunk.
 
 		//If there was already a timeout
-		else if (sackTimer.get())
+		else if (IsTimerRunning(DelayedAck))
 			//We should do sack now
 			Acknowledge();
 		else
 			//Schedule timer
-			sackTimer = CreateTimerSafe(pendingAcknowledgeTimeout,[this](...){
-				//In the future
-				Acknowledge();
-			});
+			StartTimer(DelayedAck,pendingAcknowledgeTimeout);
 	}
 		
 	//Done
@@ -202,13 +480,37 @@ size_t Association::WritePacket(uint8_t *data, uint32_t size)
 
 size_t Association::ReadPacket(uint8_t *data, uint32_t size)
 {
+	//Copy everything into data
+	return BuildPacket(data,size,nullptr);
+}
+
+size_t Association::ReadPacket(uint8_t *data, uint32_t size, std::vector<datachannels::Slice>& slices)
+{
+	//Reuse the vector
+	slices.clear();
+	//Gather user data from the messages
+	return BuildPacket(data,size,&slices);
+}
+
+size_t Association::BuildPacket(uint8_t *data, uint32_t size, std::vector<datachannels::Slice>* slices)
+{
+	//Check the largest control chunk fits
+	if (size<MinReadSize)
+		//Error
+		return 0;
+	
+	//If other threads have sent messages
+	if (submitted.load(std::memory_order_relaxed))
+		//Pass them to their streams
+		DrainSubmissions();
+	
 	//Check there is pending data
 	if (!pendingData)
 		//Nothing to do
 		return 0;
 	
 	//Create buffer writter
-	BufferWritter writter(data,size);
+	BufferWritter writter(data,std::min<size_t>(size,MaxPacketSize));
 	
 	//Create new packet header
 	PacketHeader header(localPort,remotePort,remoteVerificationTag);
@@ -219,6 +521,7 @@ size_t Association::ReadPacket(uint8_t *data, uint32_t size)
 		return 0;
 
 	size_t num = 0;
+	bool alone = false;
 	
 	//Fill chunks from control queue first
 	for (auto it=queue.begin();it!=queue.end();)
@@ -245,36 +548,132 @@ size_t Association::ReadPacket(uint8_t *data, uint32_t size)
 		
 		//Serialize chunk
 		chunk->Serialize(writter);
+		stats.chunksSent[chunk->type]++;
+		num++;
 		
 		//Check if it must be sent alone
 		if (chunk->type==Chunk::Type::INIT || chunk->type==Chunk::Type::INIT_ACK || chunk->type==Chunk::Type::COOKIE_ECHO)
+		{
 			//Send alone
+			alone = true;
 			break;
+		}
+	}
+
+	//If all control chunks have been sent and we have to acknowledge, bundle the sacks after them
+	if (queue.empty() && !alone && pendingAcknowledgements)
+	{
+		size_t i = 0;
+		//Serialize them in order while they fit
+		for (;i<pendingAcknowledgements && writter.GetLeft()>=acknowledgements[i].GetSize();++i)
+		{
+			//Serialize it
+			acknowledgements[i].Serialize(writter);
+			stats.chunksSent[Chunk::Type::SACK]++;
+			stats.acknowledgementsSent++;
+			stats.gapAckBlocksSent += acknowledgements[i].gapAckBlocks.size();
+		}
+		//If all have been sent
+		if (i==pendingAcknowledgements)
+		{
+			//Done
+			pendingAcknowledgements = 0;
+		} else {
+			//Keep only the latest one, it supersedes the rest
+			std::swap(acknowledgements[0],acknowledgements[pendingAcknowledgements-1]);
+			pendingAcknowledgements = 1;
+		}
 	}
 
-	//TODO:Check in which stata data can be sent
-		//TODO:Now fill data chunks from streams
+	//If all control chunks have been sent and data can be bundled after them
+	if (queue.empty() && !alone && CanSendData())
+	{
+		//Get now
+		auto now = timeService.GetNow();
+		//Headers start on the packet begining
+		this->slices = slices;
+		sliced = 0;
+		//Retransmissions go first
+		size_t sent = WriteRetransmissions(writter,now);
+		//Then fill data chunks from streams
+		sent += WriteData(writter,now);
+		//Done gathering
+		this->slices = nullptr;
+		//Count them
+		stats.chunksSent[Chunk::Type::PDATA] += sent;
+		//If we have sent any data
+		if (sent)
+		{
+			//Ensure the retransmission timer is running
+			StartRetransmissionTimer();
+			//Path is not idle
+			lastDataSent = now;
+		}
+	}
 
+	//Check if there is more data to send
+	pendingData = !queue.empty() || pendingAcknowledgements || IsDataReady();
+	
+	//If no chunk fitted or data is held back by the windows
+	if (writter.GetLength()==header.GetSize())
+		//Don't send just the header
+		return 0;
+	
 	//Get length
 	size_t length = writter.GetLength();
-	//Calculate crc
-	header.checksum  = crc32c::Crc32c(data,length);
+	//If gathering
+	if (slices)
+	{
+		//Add the headers after the last user data
+		if (sliced<length)
+			slices->push_back({data+sliced,length-sliced});
+		//Calculate crc over the slices in order
+		uint32_t crc = 0;
+		for (const auto& slice : *slices)
+			crc = crc32c::Extend(crc,slice.data,slice.size);
+		header.checksum = crc;
+	} else {
+		//Calculate crc
+		header.checksum  = crc32c::Crc32c(data,length);
+	}
 	//Go to the begining
 	writter.GoTo(0);
 	
 	//Serialize it now with checksum
 	header.Serialize(writter);
 	
-	//Check if there is more data to send
-	if (!queue.size())
-		//No
-		pendingData = false;
+	//Count packet
+	stats.packetsSent++;
+	stats.bytesSent += length;
+	TRACE_EVENT(datachannels::trace::PacketRead,localVerificationTag,0,state,0,length);
+	
+	//If capturing
+	if (capture)
+		//Dump it with the checksum already set, user data is also copied to data when gathering
+		capture->Write(datachannels::Capture::Outbound,data,length);
+	
 	//Done
 	return length;
 }
 
 void Association::Process(const Chunk::shared& chunk)
 {
+	TRACE_EVENT(datachannels::trace::ChunkProcessed,localVerificationTag,chunk->type,state,0,0);
+	
+	//Heartbeats are handled the same way in all states once the association is up
+	if (state>=State::Established)
+	{
+		switch(chunk->type)
+		{
+			case Chunk::Type::HEARTBEAT:
+				Process(*std::static_pointer_cast<HeartbeatRequestChunk>(chunk));
+				return;
+			case Chunk::Type::HEARTBEAT_ACK:
+				Process(*std::static_pointer_cast<HeartbeatAckChunk>(chunk));
+				return;
+		}
+	}
+	
 	//Depending onthe state
 	switch (state)
 	{
@@ -298,6 +697,12 @@ void Association::Process(const Chunk::shared& chunk)
 					
 					//Get remote verification tag
 					remoteVerificationTag = init->initiateTag;
+					
+					//Get remote window
+					remoteAdvertisedReceiverWindowCredit = init->advertisedReceiverWindowCredit;
+					
+					//The last TSN received before the first DATA chunk is the initial one minus one
+					lastReceivedTransmissionSequenceNumber = receivedTransmissionSequenceNumberWrapper.Wrap(init->initialTransmissionSequenceNumber-1);
 						
 					//Create new verification tag
 					localVerificationTag = dis(gen);
@@ -313,7 +718,7 @@ void Association::Process(const Chunk::shared& chunk)
 					initAck->advertisedReceiverWindowCredit	= localAdvertisedReceiverWindowCredit;
 					initAck->numberOfOutboundStreams	= 0xFFFF;
 					initAck->numberOfInboundStreams		= 0xFFFF;
-					initAck->initialTransmissionSequenceNumber = 0;
+					initAck->initialTransmissionSequenceNumber = static_cast<uint32_t>(nextTransmissionSequenceNumber);
 
 					// draft-ietf-rtcweb-data-channel-13
 					//	The INIT and INIT-ACK chunk MUST NOT contain any IPv4 Address or
@@ -386,7 +791,16 @@ void Association::Process(const Chunk::shared& chunk)
 					//
 					
 					// Stop timer
-					initTimer->Cancel();
+					StopTimer(T1);
+					
+					//Get remote verification tag
+					remoteVerificationTag = initAck->initiateTag;
+					
+					//Get remote window
+					remoteAdvertisedReceiverWindowCredit = initAck->advertisedReceiverWindowCredit;
+					
+					//The last TSN received before the first DATA chunk is the initial one minus one
+					lastReceivedTransmissionSequenceNumber = receivedTransmissionSequenceNumberWrapper.Wrap(initAck->initialTransmissionSequenceNumber-1);
 					
 					//Enqueue new INIT chunk
 					auto cookieEcho = std::make_shared<CookieEchoChunk>();
@@ -397,24 +811,9 @@ void Association::Process(const Chunk::shared& chunk)
 					//Reset cookie retransmissions
 					initRetransmissions = 0;
 					
-					//Set timer
-					cookieEchoTimer = CreateTimerSafe(100ms,[=](...){
-						//3)  If the T1-cookie timer expires, the endpoint MUST retransmit
-						//    COOKIE ECHO and restart the T1-cookie timer without changing
-						//    state.  This MUST be repeated up to 'Max.Init.Retransmits' times.
-						//    After that, the endpoint MUST abort the initialization process
-						//    and report the error to the SCTP user.
-						if (initRetransmissions++<MaxInitRetransmits)
-						{
-							//Retransmit
-							Enqueue(std::static_pointer_cast<Chunk>(cookieEcho));
-							//Retry again
-							initTimer->Again(100ms);
-						} else {
-							//Close
-							SetState(State::Closed);
-						}
-					});
+					//Start T1-cookie timer
+					t1Chunk = cookieEcho;
+					StartTimer(T1,InitRetransmitTimeout);
 					
 					///Enquee
 					Enqueue(std::static_pointer_cast<Chunk>(cookieEcho));
@@ -439,7 +838,8 @@ void Association::Process(const Chunk::shared& chunk)
 					//	cookie timer.
 					
 					// Stop timer
-					cookieEchoTimer->Cancel();
+					StopTimer(T1);
+					t1Chunk = nullptr;
 					
 					//Change state
 					SetState(State::Established);
@@ -454,77 +854,30 @@ void Association::Process(const Chunk::shared& chunk)
 		{
 			switch(chunk->type)
 			{
-				case Chunk::Type::PDATA:
+				case Chunk::Type::COOKIE_ECHO:
 				{
-					//Get chunk of correct type
-					auto pdata = std::static_pointer_cast<PayloadDataChunk>(chunk);
-					
-					//	After the reception of the first DATA chunk in an association the
-					//	endpoint MUST immediately respond with a SACK to acknowledge the DATA
-					//	chunk.  Subsequent acknowledgements should be done as described in
-					bool first = lastReceivedTransmissionSequenceNumber == MaxTransmissionSequenceNumber;
-					
-					//Get tsn
-					auto tsn = receivedTransmissionSequenceNumberWrapper.Wrap(pdata->transmissionSequenceNumber);
-					
-					//Storea tsn, if the container has elements with equivalent key, inserts at the upper bound of that range 
-					auto it = receivedTransmissionSequenceNumbers.insert(tsn);
-					
-					//	When a packet arrives with duplicate DATA chunk(s) and with no new
-					//	DATA chunk(s), the endpoint MUST immediately send a SACK with no
-					//	delay.  If a packet arrives with duplicate DATA chunk(s) bundled with
-					//	new DATA chunks, the endpoint MAY immediately send a SACK.
-					bool duplicated = it != receivedTransmissionSequenceNumbers.begin() && *(--it)!=tsn;
-					
-					//rfc4960#page-89
-					//	Upon the reception of a new DATA chunk, an endpoint shall examine the
-					//	continuity of the TSNs received.  If the endpoint detects a gap in
-					//	the received DATA chunk sequence, it SHOULD send a SACK with Gap Ack
-					//	Blocks immediately.  The data receiver continues sending a SACK after
-					//	receipt of each SCTP packet that doesn't fill the gap.
-					bool hasGaps = false;
-					
-					//Iterate the received transmission numbers
-					uint64_t prev = MaxTransmissionSequenceNumber;
-					for (auto curr : receivedTransmissionSequenceNumbers)
-					{
-						//Check if not first or if ther is a jump bigger than 1 seq num
-						if (prev!=MaxTransmissionSequenceNumber && curr>prev+1)
-						{
-							//It has a gap at least
-							hasGaps = true;
-							break;
-						}
-						//Next
-						prev = curr;
-					}
-
-					//rfc4960#page-78
-					//	When the receiver's advertised window is 0, the receiver MUST drop
-					//	any new incoming DATA chunk with a TSN larger than the largest TSN
-					//	received so far.  If the new incoming DATA chunk holds a TSN value
-					//	less than the largest TSN received so far, then the receiver SHOULD
-					//	drop the largest TSN held for reordering and accept the new incoming
-					//	DATA chunk.  In either case, if such a DATA chunk is dropped, the
-					//	receiver MUST immediately send back a SACK with the current receive
-					//	window showing only DATA chunks received and accepted so far.  The
-					//	dropped DATA chunk(s) MUST NOT be included in the SACK, as they were
-					//	not accepted. 
-					
-					//We need to acknoledfe
-					pendingAcknowledge = true;
-					
-					//If we need to send it now
-					if (first || hasGaps || duplicated || sackTimer)
-						//Acknoledge now
-						pendingAcknowledgeTimeout = 0ms; 
-					else 
-						//Create timer
-						pendingAcknowledgeTimeout = SackTimeout; 
+					//rfc4960#section-5.2.4
+					//	D) When both local and remote tags match, the endpoint should
+					//	enter the ESTABLISHED state, if it is in the COOKIE-ECHOED
+					//	state.  It should stop any cookie timer that may be running
+					//	and send a COOKIE ACK.
+					//Our COOKIE ACK was lost, send it again
+					Enqueue(std::make_shared<CookieAckChunk>());
 					break;
 				}
-				case Chunk::Type::SACK:
+				case Chunk::Type::SHUTDOWN:
 				{
+					//rfc4960#section-9.2
+					//	Upon reception of the SHUTDOWN, the peer endpoint shall
+					//	-  enter the SHUTDOWN-RECEIVED state,
+					//	-  stop accepting new data from its SCTP user, and
+					//	-  verify, by checking the Cumulative TSN Ack field of the chunk,
+					//	   that all its outstanding DATA chunks have been received by the
+					//	   SHUTDOWN sender.
+					Process(*std::static_pointer_cast<ShutdownAssociationChunk>(chunk));
+					SetState(State::ShutDownReceived);
+					//Reply if there is nothing to wait for
+					ContinueShutdown();
 					break;
 				}
 			}
@@ -532,14 +885,65 @@ void Association::Process(const Chunk::shared& chunk)
 		}
 		case State::ShutdownPending:
 		{
+			switch(chunk->type)
+			{
+				case Chunk::Type::SHUTDOWN:
+				{
+					//rfc4960#section-9.2
+					//	If an endpoint is in the SHUTDOWN-PENDING state and receives
+					//	a SHUTDOWN chunk, it shall move to SHUTDOWN-RECEIVED state
+					//	and act as if it had received a SHUTDOWN from its peer.
+					Process(*std::static_pointer_cast<ShutdownAssociationChunk>(chunk));
+					SetState(State::ShutDownReceived);
+					//Reply if there is nothing to wait for
+					ContinueShutdown();
+					break;
+				}
+			}
 			break;
 		}
 		case State::ShutDownSent:
 		{
+			switch(chunk->type)
+			{
+				case Chunk::Type::SHUTDOWN:
+				{
+					//rfc4960#section-9.2
+					//	If an endpoint is in the SHUTDOWN-SENT state and receives a
+					//	SHUTDOWN chunk from its peer, the endpoint shall respond
+					//	immediately with a SHUTDOWN ACK to its peer, and move into the
+					//	SHUTDOWN-ACK-SENT state restarting its T2-shutdown timer.
+					shutdownRetransmissions = 0;
+					SendShutdownAcknowledgement();
+					SetState(State::ShutDownAckSent);
+					break;
+				}
+				case Chunk::Type::SHUTDOWN_ACK:
+				{
+					//rfc4960#section-9.2
+					//	Upon the receipt of the SHUTDOWN ACK, the SHUTDOWN sender shall
+					//	stop the T2-shutdown timer, send a SHUTDOWN COMPLETE chunk to
+					//	its peer, and remove all record of the association.
+					Enqueue(std::make_shared<ShutdownCompleteChunk>());
+					CompleteShutdown();
+					break;
+				}
+			}
 			break;
 		}
 		case State::ShutDownReceived:
 		{
+			switch(chunk->type)
+			{
+				case Chunk::Type::SHUTDOWN:
+				{
+					//Retransmitted, it may acknowledge more data
+					Process(*std::static_pointer_cast<ShutdownAssociationChunk>(chunk));
+					//Reply if there is nothing to wait for
+					ContinueShutdown();
+					break;
+				}
+			}
 			break;
 		}
 		case State::ShutDown:
@@ -548,17 +952,147 @@ void Association::Process(const Chunk::shared& chunk)
 		}
 		case State::ShutDownAckSent:
 		{
+			switch(chunk->type)
+			{
+				case Chunk::Type::SHUTDOWN_ACK:
+				{
+					//rfc4960#section-9.2
+					//	If an endpoint is in the SHUTDOWN-ACK-SENT state and receives a
+					//	SHUTDOWN ACK, it shall stop the T2-shutdown timer, send a
+					//	SHUTDOWN COMPLETE chunk to its peer, and remove all record of
+					//	the association.
+					Enqueue(std::make_shared<ShutdownCompleteChunk>());
+					CompleteShutdown();
+					break;
+				}
+				case Chunk::Type::SHUTDOWN_COMPLETE:
+				{
+					//rfc4960#section-9.2
+					//	Upon reception of the SHUTDOWN COMPLETE chunk, the endpoint will
+					//	verify that it is in the SHUTDOWN-ACK-SENT state; if it is not,
+					//	the chunk should be discarded.  If the endpoint is in the
+					//	SHUTDOWN-ACK-SENT state, the endpoint should stop the
+					//	T2-shutdown timer and remove all knowledge of the association
+					//	(and thus the association enters the CLOSED state).
+					CompleteShutdown();
+					break;
+				}
+			}
 			break;
 		}
 	}
 }
 
 
-void Association::Acknowledge()
+void Association::Process(const PayloadDataChunk::View& pdata)
 {
-	//New sack message
-	auto sack = std::make_shared<SelectiveAcknowledgementChunk>();
+	TRACE_EVENT(datachannels::trace::ChunkProcessed,localVerificationTag,Chunk::Type::PDATA,state,pdata.transmissionSequenceNumber,pdata.userDataSize);
+	
+	//Data is only accepted once established and until the peer shuts down
+	if (!CanReceiveData())
+		//Drop it
+		return;
+	
+	//	After the reception of the first DATA chunk in an association the
+	//	endpoint MUST immediately respond with a SACK to acknowledge the DATA
+	//	chunk.  Subsequent acknowledgements should be done as described in
+	bool first = !dataReceived;
+	
+	//Get tsn
+	auto tsn = receivedTransmissionSequenceNumberWrapper.Wrap(pdata.transmissionSequenceNumber);
+	
+	//If we didn't got the initial tsn from the INIT/INIT ACK
+	if (lastReceivedTransmissionSequenceNumber==MaxTransmissionSequenceNumber)
+		//Start from this one
+		lastReceivedTransmissionSequenceNumber = tsn-1;
+	
+	//We have received data now
+	dataReceived = true;
+	
+	//	When a packet arrives with duplicate DATA chunk(s) and with no new
+	//	DATA chunk(s), the endpoint MUST immediately send a SACK with no
+	//	delay.  If a packet arrives with duplicate DATA chunk(s) bundled with
+	//	new DATA chunks, the endpoint MAY immediately send a SACK.
+	bool duplicated = tsn<=lastReceivedTransmissionSequenceNumber || receivedOutOfOrder.count(tsn);
+	bool dropped = false;
 	
+	//If it is duplicated
+	if (duplicated)
+	{
+		//Report it on next SACK
+		duplicatedTransmissionSequenceNumbers.push_back(pdata.transmissionSequenceNumber);
+		stats.duplicateTransmissionSequenceNumbers++;
+	}
+	//If it is the next one in sequence
+	else if (tsn==lastReceivedTransmissionSequenceNumber+1)
+	{
+		//Deliver it now
+		Deliver(pdata);
+		//Update cumulative tsn
+		lastReceivedTransmissionSequenceNumber = tsn;
+		//Deliver any out of order chunk that is in sequence now
+		for (auto it = receivedOutOfOrder.begin(); it!=receivedOutOfOrder.end() && it->first==lastReceivedTransmissionSequenceNumber+1; )
+		{
+			//Deliver it 
+			Deliver(it->second->GetView());
+			//Update cumulative tsn
+			lastReceivedTransmissionSequenceNumber = it->first;
+			//Not buffered anymore
+			receivedOutOfOrderBytes -= it->second->userData.GetSize();
+			//Remove it
+			it = receivedOutOfOrder.erase(it);
+		}
+	}
+	//If it doesn't fit in the window or can't be reported on a gap ack block, as offsets are 16 bits
+	else if (tsn-lastReceivedTransmissionSequenceNumber>std::numeric_limits<uint16_t>::max() || receivedOutOfOrderBytes+pdata.userDataSize>ReceiverWindow)
+	{
+		//rfc4960#section-6.2
+		//	When the receiver's advertised window is 0, the receiver MUST drop
+		//	any new incoming DATA chunk with a TSN larger than the largest TSN
+		//	received so far.
+		//Held ones are not reneged to make room, as the sender doesn't retransmit gap acked chunks
+		dropped = true;
+		stats.droppedTransmissionSequenceNumbers++;
+	} else {
+		//Store it until the gap is filled
+		receivedOutOfOrder.emplace(tsn,std::make_shared<PayloadDataChunk>(pdata));
+		//Count it against the window
+		receivedOutOfOrderBytes += pdata.userDataSize;
+	}
+	
+	//Advertise what is left
+	localAdvertisedReceiverWindowCredit = ReceiverWindow - receivedOutOfOrderBytes;
+	
+	//rfc4960#page-89
+	//	Upon the reception of a new DATA chunk, an endpoint shall examine the
+	//	continuity of the TSNs received.  If the endpoint detects a gap in
+	//	the received DATA chunk sequence, it SHOULD send a SACK with Gap Ack
+	//	Blocks immediately.  The data receiver continues sending a SACK after
+	//	receipt of each SCTP packet that doesn't fill the gap.
+	bool hasGaps = !receivedOutOfOrder.empty();
+
+	//rfc4960#page-78
+	//	In either case, if such a DATA chunk is dropped, the
+	//	receiver MUST immediately send back a SACK with the current receive
+	//	window showing only DATA chunks received and accepted so far.  The
+	//	dropped DATA chunk(s) MUST NOT be included in the SACK, as they were
+	//	not accepted. 
+	
+	//If we need to send it now
+	if (first || hasGaps || duplicated || dropped || IsTimerRunning(DelayedAck))
+		//Acknoledge now
+		pendingAcknowledgeTimeout = 0ms; 
+	//If it is the first chunk not acknowledged
+	else if (!pendingAcknowledge)
+		//Create timer
+		pendingAcknowledgeTimeout = SackTimeout; 
+	
+	//We need to acknoledge
+	pendingAcknowledge = true;
+}
+
+void Association::Acknowledge()
+{
 	//rfc4960#page-34
 	//	By definition, the value of the Cumulative TSN Ack parameter is the
 	//	last TSN received before a break in the sequence of received TSNs
@@ -580,83 +1114,70 @@ void Association::Acknowledge()
 	//	Gap Ack Blocks as can fit in a single SACK chunk limited by the
 	//	current path MTU.
 	
-	//Iterate the received transmission numbers
-	uint64_t prev = MaxTransmissionSequenceNumber;
-	uint64_t gap  = MaxTransmissionSequenceNumber;
-	for (auto it = receivedTransmissionSequenceNumbers.begin();it!=receivedTransmissionSequenceNumbers.end();)
+	//Get next sack, reusing the ones already sent
+	if (pendingAcknowledgements==acknowledgements.size())
+		acknowledgements.emplace_back();
+	auto& acknowledgement = acknowledgements[pendingAcknowledgements];
+	
+	//Build gap blocks from the chunks received out of order
+	acknowledgement.gapAckBlocks.clear();
+	uint64_t start = MaxTransmissionSequenceNumber;
+	uint64_t end   = MaxTransmissionSequenceNumber;
+	for (const auto& [tsn,pdata] : receivedOutOfOrder)
 	{
-		//Get current
-		uint64_t current = *it;
-		//If we have a continous sequence number or it is the first one
-		if (lastReceivedTransmissionSequenceNumber==MaxTransmissionSequenceNumber || current==lastReceivedTransmissionSequenceNumber+1)
-		{
-			//Update last received tsn
-			lastReceivedTransmissionSequenceNumber = current;
-		}
-		//Check if is duplicated
-		else if (prev==current)
-		{
-			//It is duplicated
-			sack->duplicateTuplicateTrasnmissionSequenceNumbers.push_back(current);
-		}
-		//If it is a gap
-		else if (prev!=MaxTransmissionSequenceNumber && current>prev+1)
+		//If it is continous with previous block
+		if (start!=MaxTransmissionSequenceNumber && tsn==end+1)
 		{
-			//If we had a gap start
-			if (gap)
-				//Add block ending at previous one
-				sack->gapAckBlocks.push_back({
-					static_cast<uint16_t>(gap-lastReceivedTransmissionSequenceNumber),
-					static_cast<uint16_t>(prev-lastReceivedTransmissionSequenceNumber)
-				});
-			//Start new gap
-			gap = current;
+			//Extend it
+			end = tsn;
+			continue;
 		}
-		
-		//Move next
-		prev = current;
-		
-		//Remove everything up to the cumulative sequence number
-		if (lastReceivedTransmissionSequenceNumber==current)
-			//Erase and move
-			it = receivedTransmissionSequenceNumbers.erase(it);
-		else
-			//Next
-			++it;
+		//If we had a gap start
+		if (start!=MaxTransmissionSequenceNumber)
+			//Add block ending at previous one
+			acknowledgement.gapAckBlocks.push_back({
+				static_cast<uint16_t>(start-lastReceivedTransmissionSequenceNumber),
+				static_cast<uint16_t>(end-lastReceivedTransmissionSequenceNumber)
+			});
+		//Start new block
+		start = end = tsn;
 	}
 	
 	//If we had a gap start
-	if (gap!=MaxTransmissionSequenceNumber)
+	if (start!=MaxTransmissionSequenceNumber)
 		//Add block ending at last one
-		sack->gapAckBlocks.push_back({
-			static_cast<uint16_t>(gap-lastReceivedTransmissionSequenceNumber),
-			static_cast<uint16_t>(prev-lastReceivedTransmissionSequenceNumber)
+		acknowledgement.gapAckBlocks.push_back({
+			static_cast<uint16_t>(start-lastReceivedTransmissionSequenceNumber),
+			static_cast<uint16_t>(end-lastReceivedTransmissionSequenceNumber)
 		});
+	
+	//Report duplicated ones since last sack, swapping keeps the capacity of both
+	acknowledgement.duplicateTuplicateTrasnmissionSequenceNumbers.swap(duplicatedTransmissionSequenceNumbers);
+	duplicatedTransmissionSequenceNumbers.clear();
 		
 	//Set last consecutive recevied number
-	sack->cumulativeTrasnmissionSequenceNumberAck = receivedTransmissionSequenceNumberWrapper.UnWrap(lastReceivedTransmissionSequenceNumber);
+	acknowledgement.cumulativeTrasnmissionSequenceNumberAck = receivedTransmissionSequenceNumberWrapper.UnWrap(lastReceivedTransmissionSequenceNumber);
 	
 	//Set window
-	sack->adveritsedReceiverWindowCredit = localAdvertisedReceiverWindowCredit;
+	acknowledgement.adveritsedReceiverWindowCredit = localAdvertisedReceiverWindowCredit;
 	
-	//Send it
-	Enqueue(sack);
+	TRACE_EVENT(datachannels::trace::Acknowledge,localVerificationTag,Chunk::Type::SACK,state,acknowledgement.cumulativeTrasnmissionSequenceNumberAck,acknowledgement.gapAckBlocks.size());
 	
 	//No need to acknoledge
 	pendingAcknowledge = false;
 	
-	//Reset any pending sack timer
-	if (sackTimer)
-	{
-		//Cancel it
-		sackTimer->Cancel();
-		//Reset it
-		sackTimer = nullptr;
-	}
+	//Stop any pending sack timer
+	StopTimer(DelayedAck);
+	
+	//Send it on next packet
+	pendingAcknowledgements++;
+	SignalPendingData();
 }
 
 void Association::Enqueue(const Chunk::shared& chunk)
 {
+	TRACE_EVENT(datachannels::trace::ChunkEnqueued,localVerificationTag,chunk->type,state,0,chunk->GetSize());
+	
 	bool wasPending = pendingData;
 	//Push back
 	queue.push_back(chunk);
@@ -668,4 +1189,1114 @@ void Association::Enqueue(const Chunk::shared& chunk)
 		onPendingData();
 }
 
+void Association::Enqueue(Stream& stream)
+{
+	//If it was already scheduled
+	if (stream.queued)
+		//Nothing to do
+		return;
+	//Schedule it
+	pendingStreams.push_back(stream.GetId());
+	stream.queued = true;
+	TRACE_EVENT(datachannels::trace::StreamEnqueued,localVerificationTag,Chunk::Type::PDATA,state,stream.GetId(),stream.queuedBytes);
+	//Check if it can be sent now
+	SignalPendingData();
+}
+
+bool Association::IsDataReady() const
+{
+	//Check in which states data can be sent
+	if (!CanSendData())
+		//No
+		return false;
+	
+	//rfc4960#section-6.1
+	//	C) When the time comes for the sender to transmit, before sending new
+	//	DATA chunks, the sender MUST first transmit any outstanding DATA
+	//	chunks that are marked for retransmission (limited by the current
+	//	cwnd).
+	if (pendingRetransmissions && bytesInFlight<congestionWindow)
+		//Yes
+		return true;
+	
+	//Check if there is any new message
+	if (pendingStreams.empty())
+		//No
+		return false;
+	
+	//	A) At any given time, the data sender MUST NOT transmit new data to
+	//	any destination transport address if its peer's rwnd indicates
+	//	that the peer has no buffer space (i.e., rwnd is 0; see Section
+	//	6.2.1).  However, regardless of the value of rwnd (including if it
+	//	is 0), the data sender can always have one DATA chunk in flight to
+	//	the receiver if allowed by cwnd (see rule B, below).
+	if (!remoteAdvertisedReceiverWindowCredit && bytesInFlight)
+		//No
+		return false;
+	
+	//	B) At any given time, the sender MUST NOT transmit new data to a
+	//	given transport address if it has cwnd or more bytes of data
+	//	outstanding to that transport address.
+	return bytesInFlight<congestionWindow;
+}
+
+void Association::Submit(uint16_t id, uint32_t ppid, const datachannels::Payload& payload, bool unordered)
+{
+	//Queue it without locking
+	Submission submission;
+	submission.id		= id;
+	submission.ppid		= ppid;
+	submission.unordered	= unordered;
+	submission.payload	= payload;
+	submissions.push(std::move(submission));
+	
+	//If the owning thread was already signaled
+	if (submitted.exchange(true,std::memory_order_acq_rel))
+		//Done
+		return;
+	
+	//Wake it up, only the submitted callback can be read from this thread
+	if (auto callback = std::atomic_load(&onSubmitted))
+		(*callback)();
+}
+
+void Association::DrainSubmissions()
+{
+	//Clear flag before popping, so any message pushed after the last pop signals again
+	if (!submitted.exchange(false,std::memory_order_acq_rel))
+		//Nothing new
+		return;
+	
+	//For each message
+	Submission submission;
+	while (submissions.pop(submission))
+	{
+		//Get stream
+		Stream* stream = streams.Get(submission.id);
+		//Drop messages for streams that are gone
+		if (!stream)
+			continue;
+		//Send it
+		stream->Send(submission.ppid,submission.payload,submission.unordered);
+	}
+}
+
+void Association::SignalPendingData()
+{
+	//If we already have pending data or there is nothing to send
+	if (pendingData || (!pendingAcknowledgements && !IsDataReady()))
+		//Nothing to do
+		return;
+	//We have data to send
+	pendingData = true;
+	//Call callback
+	if (onPendingData)
+		onPendingData();
+}
+
+bool Association::WriteDataChunk(BufferWritter& writter, const Transmission& transmission)
+{
+	//User data is a slice of the message
+	const uint8_t* userData = transmission.payload->GetData()+transmission.offset;
+	
+	//If not gathering
+	if (!slices)
+		//Copy it to the packet
+		return PayloadDataChunk::Serialize(writter,
+				transmission.flag,
+				static_cast<uint32_t>(transmission.transmissionSequenceNumber),
+				transmission.streamIdentifier,
+				transmission.streamSequenceNumber,
+				transmission.payloadProtocolIdentifier,
+				userData,
+				transmission.length);
+	
+	//Only write the header
+	if (!PayloadDataChunk::SerializeHeader(writter,
+			transmission.flag,
+			static_cast<uint32_t>(transmission.transmissionSequenceNumber),
+			transmission.streamIdentifier,
+			transmission.streamSequenceNumber,
+			transmission.payloadProtocolIdentifier,
+			transmission.length))
+		return false;
+	
+	//Check user data size
+	if (!writter.Assert(transmission.length))
+		return false;
+	
+	//Add headers written since previous user data
+	slices->push_back({writter.GetData()+sliced,writter.Mark()-sliced});
+	//And the user data from the message
+	slices->push_back({userData,transmission.length});
+	
+	//Leave room for the user data, it is only filled for the capture
+	uint8_t* room = writter.Consume(transmission.length);
+	if (capture)
+		memcpy(room,userData,transmission.length);
+	
+	//Next headers start on the padding
+	sliced = writter.Mark();
+	
+	//Pad
+	return writter.PadTo(4);
+}
+
+size_t Association::WriteRetransmissions(BufferWritter& writter, std::chrono::milliseconds now)
+{
+	size_t num = 0;
+	
+	//For each chunk in flight
+	for (auto& transmission : outstanding)
+	{
+		//If we don't have to retransmit more or cwnd is full
+		if (!pendingRetransmissions || bytesInFlight>=congestionWindow)
+			//Done
+			break;
+		//If it has not been marked for retransmission
+		if (!transmission.retransmit)
+			//Skip
+			continue;
+		//Ensure we have enought space for chunk
+		if (writter.GetLeft()<SizePad(PayloadDataChunk::HeaderSize+transmission.length,4))
+			//We cant send more on this packet
+			break;
+		//Serialize chunk
+		if (!WriteDataChunk(writter,transmission))
+			//Error
+			break;
+		//It is in flight again
+		transmission.retransmit = false;
+		transmission.transmissions++;
+		transmission.missingReports = 0;
+		transmission.sent = now;
+		bytesInFlight += transmission.length;
+		pendingRetransmissions--;
+		stats.retransmissions++;
+		num++;
+	}
+	//Done
+	return num;
+}
+
+size_t Association::WriteData(BufferWritter& writter, std::chrono::milliseconds now)
+{
+	size_t num = 0;
+	
+	//While we have streams with pending messages and the windows allow it
+	while (!pendingStreams.empty() && bytesInFlight<congestionWindow && (remoteAdvertisedReceiverWindowCredit || !bytesInFlight))
+	{
+		//Get stream
+		auto stream = streams.Get(pendingStreams.front());
+		
+		//If it has been removed or has nothing to send
+		if (!stream || stream->outgoingMessages.empty())
+		{
+			//Remove from queue
+			pendingStreams.pop_front();
+			//Not queued anymore
+			if (stream) stream->queued = false;
+			//Next
+			continue;
+		}
+		
+		//Get next message
+		auto& message = stream->outgoingMessages.front();
+		
+		//Get remaining data to send from message
+		size_t remaining = message.payload->GetSize() - message.offset;
+		
+		//Check how much user data can we fit on this packet
+		size_t left = writter.GetLeft();
+		size_t max = left>PayloadDataChunk::HeaderSize ? (left - PayloadDataChunk::HeaderSize) & ~static_cast<size_t>(3) : 0;
+		
+		//If it doesn't fit and we would have to create a too small fragment
+		if (remaining>max && max<MinFragmentSize)
+			//Send it on next packet
+			break;
+		
+		//Get fragment length
+		size_t length = std::min(remaining,max);
+		
+		//Create new transmission
+		Transmission transmission;
+		transmission.transmissionSequenceNumber	= nextTransmissionSequenceNumber;
+		transmission.streamIdentifier		= stream->GetId();
+		transmission.payloadProtocolIdentifier	= message.payloadProtocolIdentifier;
+		transmission.payload			= message.payload;
+		transmission.offset			= message.offset;
+		transmission.length			= length;
+		transmission.sent			= now;
+		
+		//If it is the first fragment
+		if (!message.offset)
+		{
+			//Set flag
+			transmission.flag |= PayloadDataChunk::BeginingFragment;
+			//	The Stream Sequence Number in all the segments of a fragmented
+			//	message MUST be the same.
+			if (!message.unordered)
+				message.streamSequenceNumber = stream->nextStreamSequenceNumber++;
+		}
+		//If it is the last fragment
+		if (length==remaining)
+			transmission.flag |= PayloadDataChunk::EndingFragment;
+		//If it is unordered
+		if (message.unordered)
+			transmission.flag |= PayloadDataChunk::Unordered;
+		
+		//Set sequence number
+		transmission.streamSequenceNumber = message.streamSequenceNumber;
+		
+		//Serialize chunk
+		if (!WriteDataChunk(writter,transmission))
+			//Error
+			break;
+		
+		//Next tsn
+		nextTransmissionSequenceNumber++;
+		
+		//	B) At any given time, the sender MUST NOT transmit new data to a
+		//	given transport address if it has cwnd or more bytes of data
+		//	outstanding to that transport address.
+		bytesInFlight += length;
+		
+		//rfc4960#section-6.2.1
+		//	B) Any time a DATA chunk is transmitted (or retransmitted) to a peer,
+		//	the endpoint subtracts the data size of the chunk from the rwnd of
+		//	that peer.
+		remoteAdvertisedReceiverWindowCredit -= std::min<size_t>(remoteAdvertisedReceiverWindowCredit,length);
+		
+		//Store it until acknowledged
+		outstanding.push_back(std::move(transmission));
+		
+		//Move message offset
+		message.offset += length;
+		num++;
+		
+		//User data is in flight now
+		stream->queuedBytes -= length;
+		queuedBytes -= length;
+		
+		//If message has not been fully sent
+		if (message.offset<message.payload->GetSize())
+			//Continue with it on next packet
+			break;
+		
+		//Remove message
+		stream->outgoingMessages.pop_front();
+		
+		//Move stream to the back of the queue so other streams can be served
+		pendingStreams.pop_front();
+		
+		//If it has more messages
+		if (!stream->outgoingMessages.empty())
+			//Enqueue it again
+			pendingStreams.push_back(stream->GetId());
+		else
+			//Not queued anymore
+			stream->queued = false;
+	}
+	
+	//Done
+	return num;
+}
+
+void Association::Process(const SelectiveAcknowledgementChunk& sack)
+{
+	TRACE_EVENT(datachannels::trace::ChunkProcessed,localVerificationTag,Chunk::Type::SACK,state,sack.cumulativeTrasnmissionSequenceNumberAck,sack.gapAckBlocks.size());
+	
+	//Acknowledgements are only processed while we have data to send
+	if (!CanSendData())
+		//Drop it
+		return;
+	
+	//Get extended cumulative tsn ack
+	uint64_t cumulativeTransmissionSequenceNumberAck = ExtendLocalTransmissionSequenceNumber(sack.cumulativeTrasnmissionSequenceNumberAck);
+	
+	//rfc4960#section-6.2.1
+	//	D) Any time a SACK arrives, the endpoint performs the following:
+	//
+	//	i) If Cumulative TSN Ack is less than the Cumulative TSN Ack
+	//	   Point, then drop the SACK.  Since Cumulative TSN Ack is
+	//	   monotonically increasing, a SACK whose Cumulative TSN Ack is
+	//	   less than the Cumulative TSN Ack Point indicates an out-of-
+	//	   order SACK.
+	if (!outstanding.empty() && cumulativeTransmissionSequenceNumberAck+1<outstanding.front().transmissionSequenceNumber)
+		//Drop it
+		return;
+	
+	//Count gap blocks reported by the remote peer
+	stats.gapAckBlocksReceived += sack.gapAckBlocks.size();
+	
+	//Get now
+	auto now = timeService.GetNow();
+	
+	size_t acknowledgedBytes = 0;
+	std::chrono::milliseconds rtt = -1ms;
+	
+	//Remove all the chunks acknowledged by the cumulative tsn
+	while (!outstanding.empty() && outstanding.front().transmissionSequenceNumber<=cumulativeTransmissionSequenceNumberAck)
+	{
+		//Get first one
+		auto& transmission = outstanding.front();
+		//If it was not acked by a previous gap block
+		if (!transmission.acknowledged)
+		{
+			//It is newly acked
+			acknowledgedBytes += transmission.length;
+			//If it was in flight
+			if (!transmission.retransmit)
+				//Not anymore
+				bytesInFlight -= transmission.length;
+			else
+				//Not pending anymore
+				pendingRetransmissions--;
+			//rfc4960#section-6.3.1
+			//	C5)  Karn's algorithm: RTT measurements MUST NOT be made using
+			//	packets that were retransmitted (and thus for which it is
+			//	ambiguous whether the reply was for the first instance of the
+			//	chunk or for a later instance).
+			if (transmission.transmissions==1 && !transmission.retransmit)
+				rtt = now - transmission.sent;
+		}
+		//Remove it
+		outstanding.pop_front();
+	}
+	
+	//Highest tsn acked by gap blocks
+	uint64_t highestAcknowledged = cumulativeTransmissionSequenceNumberAck;
+	
+	//For each gap block
+	for (const auto& [start,end] : sack.gapAckBlocks)
+	{
+		//Nothing to ack
+		if (outstanding.empty())
+			break;
+		//Clamp the block to the outstanding tsns, so bogus blocks don't walk over tsns never sent
+		uint64_t first = std::max<uint64_t>(cumulativeTransmissionSequenceNumberAck+start,outstanding.front().transmissionSequenceNumber);
+		uint64_t last  = std::min<uint64_t>(cumulativeTransmissionSequenceNumberAck+end,outstanding.front().transmissionSequenceNumber+outstanding.size()-1);
+		//For each tsn in the block
+		for (uint64_t tsn = first; tsn<=last; ++tsn)
+		{
+			//Get transmission
+			auto& transmission = outstanding[tsn - outstanding.front().transmissionSequenceNumber];
+			//If it was already acked
+			if (transmission.acknowledged)
+				continue;
+			//It is acked now
+			transmission.acknowledged = true;
+			//If it was in flight
+			if (!transmission.retransmit)
+				//Not anymore
+				bytesInFlight -= transmission.length;
+			else
+				//No need to retransmit it
+				pendingRetransmissions--;
+			transmission.retransmit = false;
+			//Update highest
+			highestAcknowledged = std::max(highestAcknowledged,tsn);
+		}
+	}
+	
+	//rfc4960#section-7.2.4
+	//	Whenever an endpoint receives a SACK that indicates that some TSNs
+	//	are missing, it SHOULD wait for two further miss indications (via
+	//	subsequent SACKs for a total of three missing reports) on the same
+	//	TSNs before taking action with regard to Fast Retransmit.
+	bool fastRetransmit = false;
+	for (auto& transmission : outstanding)
+	{
+		//Only the ones before the highest acked are missing
+		if (transmission.transmissionSequenceNumber>=highestAcknowledged)
+			break;
+		//Skip acked and already marked ones
+		if (transmission.acknowledged || transmission.retransmit)
+			continue;
+		//If it has been reported missing three times
+		if (++transmission.missingReports==3)
+		{
+			//Mark it for retransmission
+			transmission.retransmit = true;
+			bytesInFlight -= transmission.length;
+			pendingRetransmissions++;
+			stats.fastRetransmits++;
+			fastRetransmit = true;
+		}
+	}
+	
+	//If we have exited fast recovery
+	if (fastRecovery && cumulativeTransmissionSequenceNumberAck>=fastRecoveryExitPoint)
+		fastRecovery = false;
+	
+	//If we have to do a fast retransmit and we are not already on fast recovery
+	if (fastRetransmit && !fastRecovery)
+	{
+		//	If not in Fast Recovery, adjust the ssthresh and cwnd of the
+		//	destination address(es) to which the missing DATA chunks were
+		//	last sent, according to the formula described in Section 7.2.3.
+		slowStartThreshold = std::max(congestionWindow/2, 4*MaxPacketSize);
+		congestionWindow = slowStartThreshold;
+		partialBytesAcked = 0;
+		//Enter fast recovery until all outstanding data is acked
+		fastRecovery = true;
+		fastRecoveryExitPoint = nextTransmissionSequenceNumber-1;
+	} else if (acknowledgedBytes && !fastRecovery) {
+		//rfc4960#section-7.2.1
+		//	When cwnd is less than or equal to ssthresh, an SCTP endpoint MUST
+		//	use the slow-start algorithm to increase cwnd only if the current
+		//	congestion window is being fully utilized, an incoming SACK
+		//	advances the Cumulative TSN Ack Point, and the data sender is not
+		//	in Fast Recovery.  Only when these three conditions are met can the
+		//	cwnd be increased; otherwise, the cwnd MUST not be increased.  If
+		//	these conditions are met, then cwnd MUST be increased by, at most,
+		//	the lesser of 1) the total size of the previously outstanding DATA
+		//	chunk(s) acknowledged, and 2) the destination's path MTU.
+		if (congestionWindow<=slowStartThreshold)
+		{
+			congestionWindow += std::min(acknowledgedBytes,MaxPacketSize);
+		} else {
+			//rfc4960#section-7.2.2
+			//	Whenever cwnd is greater than ssthresh, upon each SACK arrival
+			//	that advances the Cumulative TSN Ack Point, increase
+			//	partial_bytes_acked by the total number of bytes of all new chunks
+			//	acknowledged in that SACK including chunks acknowledged by the new
+			//	Cumulative TSN Ack and by Gap Ack Blocks.
+			partialBytesAcked += acknowledgedBytes;
+			//	When partial_bytes_acked is equal to or greater than cwnd and
+			//	before the arrival of the SACK the sender had cwnd or more bytes
+			//	of data outstanding (i.e., before arrival of the SACK, flightsize
+			//	was greater than or equal to cwnd), increase cwnd by MTU, and
+			//	reset partial_bytes_acked to (partial_bytes_acked - cwnd).
+			if (partialBytesAcked>=congestionWindow)
+			{
+				partialBytesAcked -= congestionWindow;
+				congestionWindow += MaxPacketSize;
+			}
+		}
+	}
+	
+	//rfc4960#section-6.2.1
+	//	ii) Set rwnd equal to the newly received a_rwnd minus the number
+	//	    of bytes still outstanding after processing the Cumulative
+	//	    TSN Ack and the Gap Ack Blocks.
+	remoteAdvertisedReceiverWindowCredit = sack.adveritsedReceiverWindowCredit>bytesInFlight ? sack.adveritsedReceiverWindowCredit - bytesInFlight : 0;
+	
+	//If we got a new rtt measurement
+	if (rtt>=0ms)
+		//Update rto
+		UpdateRetransmissionTimeout(rtt);
+	
+	//If new data has been acknowledged
+	if (acknowledgedBytes)
+		//Peer is reachable
+		OnPathAlive();
+	
+	//rfc4960#section-6.3.2
+	//	R2)  Whenever all outstanding data sent to an address have been
+	//	acknowledged, turn off the T3-rtx timer of that address.
+	if (outstanding.empty())
+	{
+		//Stop timer
+		StopTimer(T3);
+	}
+	//	R3)  Whenever a SACK is received that acknowledges the DATA chunk
+	//	with the earliest outstanding TSN for that address, restart the
+	//	T3-rtx timer for that address with its current RTO (if there is
+	//	still outstanding data on that address).
+	else if (acknowledgedBytes) {
+		//Stop it
+		StopTimer(T3);
+		//Start again
+		StartRetransmissionTimer();
+	}
+	
+	//We may have room for more data now
+	SignalPendingData();
+	
+	//If shutting down, all data may have been acknowledged now
+	ContinueShutdown();
+}
+
+void Association::StartRetransmissionTimer()
+{
+	//rfc4960#section-6.3.2
+	//	R1)  Every time a DATA chunk is sent to any address (including a
+	//	retransmission), if the T3-rtx timer of that address is not running,
+	//	start it running so that it will expire after the RTO of that
+	//	address.
+	if (IsTimerRunning(T3))
+		//Nothing
+		return;
+	//Schedule it
+	StartTimer(T3,retransmissionTimeout);
+}
+
+void Association::OnRetransmissionTimeout()
+{
+	//rfc4960#section-7.2.3
+	//	When the T3-rtx timer expires on an address, SCTP should perform slow
+	//	start by:
+	//	   ssthresh = max(cwnd/2, 4*MTU)
+	//	   cwnd = 1*MTU
+	slowStartThreshold = std::max(congestionWindow/2, 4*MaxPacketSize);
+	congestionWindow = MaxPacketSize;
+	partialBytesAcked = 0;
+	fastRecovery = false;
+	stats.retransmissionTimeouts++;
+	
+	//rfc4960#section-6.3.3
+	//	E2)  For the destination address for which the timer expires, set RTO
+	//	<- RTO * 2 ("back off the timer").  The maximum value discussed in
+	//	rule C7 above (RTO.max) may be used to provide an upper bound to this
+	//	doubling operation.
+	retransmissionTimeout = std::min(retransmissionTimeout*2, MaxRetransmissionTimeout);
+	
+	//rfc4960#section-8.2
+	//	Each time the T3-rtx timer expires on any address, or when a
+	//	HEARTBEAT sent to an idle address is not acknowledged within an RTO,
+	//	the error counter of that destination address will be incremented.
+	OnPathError();
+	
+	//	E3)  Determine how many of the earliest (i.e., lowest TSN) outstanding
+	//	DATA chunks for the address for which the T3-rtx has expired will fit
+	//	into a single packet, subject to the MTU constraint for the path
+	//	corresponding to the destination transport address to which the
+	//	retransmission is being sent (this may be different from the address
+	//	for which the timer expires; see Section 6.4).  Call this value K.
+	for (auto& transmission : outstanding)
+	{
+		//Skip acked and already marked ones
+		if (transmission.acknowledged || transmission.retransmit)
+			continue;
+		//Mark it for retransmission
+		transmission.retransmit = true;
+		bytesInFlight -= transmission.length;
+		pendingRetransmissions++;
+	}
+	
+	//Send them
+	SignalPendingData();
+}
+
+void Association::UpdateRetransmissionTimeout(std::chrono::milliseconds rtt)
+{
+	//rfc4960#section-6.3.1
+	if (smoothedRoundTripTime==0ms)
+	{
+		//	C2)  When the first RTT measurement R is made, set
+		//	SRTT <- R,
+		//	RTTVAR <- R/2, and
+		//	RTO <- SRTT + 4 * RTTVAR.
+		smoothedRoundTripTime  = std::max(rtt,1ms);
+		roundTripTimeVariation = rtt/2;
+	} else {
+		//	C3)  When a new RTT measurement R' is made, set
+		//	RTTVAR <- (1 - RTO.Beta) * RTTVAR + RTO.Beta * |SRTT - R'|
+		//	and
+		//	SRTT <- (1 - RTO.Alpha) * SRTT + RTO.Alpha * R'
+		auto diff = smoothedRoundTripTime>rtt ? smoothedRoundTripTime-rtt : rtt-smoothedRoundTripTime;
+		roundTripTimeVariation = (roundTripTimeVariation*3 + diff)/4;
+		smoothedRoundTripTime  = std::max((smoothedRoundTripTime*7 + rtt)/8,1ms);
+	}
+	//	C6)  Whenever RTO is computed, if it is less than RTO.Min seconds
+	//	then it is rounded up to RTO.Min seconds.
+	//	C7)  A maximum value may be placed on RTO provided it is at least
+	//	RTO.max seconds.
+	retransmissionTimeout = std::clamp(smoothedRoundTripTime + 4*roundTripTimeVariation, MinRetransmissionTimeout, MaxRetransmissionTimeout);
+}
+
+void Association::Process(const ShutdownAssociationChunk& shutdown)
+{
+	//If we have no data to acknowledge
+	if (!CanSendData())
+		//Nothing
+		return;
+	
+	//rfc4960#section-6.2
+	//	The SHUTDOWN chunk carries the cumulative TSN ack, so use it as a SACK
+	//	without gaps keeping the current window.
+	receivedAcknowledgement.cumulativeTrasnmissionSequenceNumberAck = shutdown.cumulativeTrasnmissionSequenceNumberAck;
+	receivedAcknowledgement.adveritsedReceiverWindowCredit = static_cast<uint32_t>(std::min<size_t>(remoteAdvertisedReceiverWindowCredit + bytesInFlight,std::numeric_limits<uint32_t>::max()));
+	receivedAcknowledgement.gapAckBlocks.clear();
+	receivedAcknowledgement.duplicateTuplicateTrasnmissionSequenceNumbers.clear();
+	
+	//Process it
+	Process(receivedAcknowledgement);
+}
+
+void Association::SendShutdown()
+{
+	auto shutdown = std::make_shared<ShutdownAssociationChunk>();
+	
+	//rfc4960#section-9.2
+	//	the endpoint MUST send a SHUTDOWN with its Cumulative TSN Ack field
+	//	set to the last sequential TSN it has received from the peer.
+	shutdown->cumulativeTrasnmissionSequenceNumberAck = receivedTransmissionSequenceNumberWrapper.UnWrap(lastReceivedTransmissionSequenceNumber);
+	
+	//Send it
+	Enqueue(std::static_pointer_cast<Chunk>(shutdown));
+	
+	//	It shall then start the T2-shutdown timer and enter the SHUTDOWN-SENT
+	//	state.  If the timer expires, the endpoint must resend the SHUTDOWN
+	//	with the updated last sequential TSN received from its peer.
+	//	The rules in Section 6.3 MUST be followed to determine the proper
+	//	timer value for T2-shutdown.
+	StartTimer(T2,retransmissionTimeout);
+}
+
+void Association::SendShutdownAcknowledgement()
+{
+	//Send it
+	Enqueue(std::make_shared<ShutdownAcknowledgementChunk>());
+	//Retransmitted on T2-shutdown expiration until the SHUTDOWN COMPLETE is received
+	StartTimer(T2,retransmissionTimeout);
+}
+
+void Association::ContinueShutdown()
+{
+	//Only while waiting for our data to be acknowledged
+	if (state!=State::ShutdownPending && state!=State::ShutDownReceived)
+		//Nothing
+		return;
+	
+	//rfc4960#section-9.2
+	//	The endpoint
+	//	accepts no new data from its upper layer, but retransmits data to the
+	//	far end if necessary to fill gaps.
+	//	Once all its outstanding data has been acknowledged, the endpoint
+	//	shall send a SHUTDOWN chunk to its peer
+	//Messages queued before the shutdown are also sent first
+	if (!outstanding.empty() || queuedBytes)
+		//Wait
+		return;
+	
+	//Reset counter
+	shutdownRetransmissions = 0;
+	
+	//If we started it
+	if (state==State::ShutdownPending)
+	{
+		//Send SHUTDOWN and wait for the ack
+		SendShutdown();
+		SetState(State::ShutDownSent);
+	} else {
+		//	If there are no more outstanding DATA chunks, the SHUTDOWN receiver
+		//	MUST send a SHUTDOWN ACK and start a T2-shutdown timer of its own,
+		//	entering the SHUTDOWN-ACK-SENT state.
+		SendShutdownAcknowledgement();
+		SetState(State::ShutDownAckSent);
+	}
+}
+
+void Association::CompleteShutdown()
+{
+	//Stop all timers, keeping the queued chunks so the last ones are still sent
+	deadlines.fill(Never);
+	t1Chunk = nullptr;
+	
+	//Closed now
+	SetState(State::Closed);
+	
+	//Notify
+	if (onClosed)
+		onClosed();
+}
+
+void Association::OnT2Timeout()
+{
+	//rfc4960#section-9.2
+	//	An endpoint should limit the number of retransmissions of the
+	//	SHUTDOWN chunk to the protocol parameter 'Association.Max.Retrans'.
+	//	If this threshold is exceeded, the endpoint should destroy the TCB and
+	//	MUST report the peer endpoint unreachable to the upper layer (and
+	//	thus the association enters the CLOSED state).
+	//The same applies to the SHUTDOWN ACK
+	if (shutdownRetransmissions++>=MaxAssociationRetransmissions)
+	{
+		//Give up
+		CompleteShutdown();
+		return;
+	}
+	
+	//rfc4960#section-6.3.3
+	//	E2)  For the destination address for which the timer expires, set RTO
+	//	<- RTO * 2 ("back off the timer").
+	retransmissionTimeout = std::min(retransmissionTimeout*2, MaxRetransmissionTimeout);
+	
+	//Send again
+	if (state==State::ShutDownSent)
+		SendShutdown();
+	else if (state==State::ShutDownAckSent)
+		SendShutdownAcknowledgement();
+}
+
+void Association::OnShutdownGuardTimeout()
+{
+	//If it has already finished
+	if (state==State::Closed)
+		//Nothing
+		return;
+	
+	//rfc4960#section-9.2
+	//	At the expiration of this timer, the sender SHOULD abort the
+	//	association by sending an ABORT chunk.
+	Enqueue(std::make_shared<AbortAssociationChunk>());
+	
+	//Closed
+	CompleteShutdown();
+}
+
+void Association::SetHeartbeatInterval(std::chrono::milliseconds interval)
+{
+	//Store it
+	heartbeatInterval = interval;
+	//If disabled
+	if (heartbeatInterval==0ms)
+		//Stop sending them
+		StopTimer(Heartbeat);
+	//Else if already up
+	else if (state==State::Established)
+		//Use new interval from now
+		StartHeartbeatTimer();
+}
+
+void Association::StartHeartbeatTimer()
+{
+	//If disabled
+	if (heartbeatInterval==0ms)
+		//Nothing
+		return;
+	
+	//rfc4960#section-8.3
+	//	On an idle destination address that is allowed to heartbeat, it is
+	//	recommended that a HEARTBEAT chunk is sent once per RTO of that
+	//	destination address plus the protocol parameter 'HB.interval', with
+	//	jittering of +/- 50% of the RTO value, and exponential backoff of the
+	//	RTO if the previous HEARTBEAT is unanswered.
+	//The jitter spreads the heartbeats of associations established at the same time
+	std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(-retransmissionTimeout.count()/2,retransmissionTimeout.count()/2);
+	
+	//Schedule it
+	StartTimer(Heartbeat,retransmissionTimeout + heartbeatInterval + std::chrono::milliseconds(jitter(gen)));
+}
+
+void Association::OnHeartbeatTimeout(std::chrono::milliseconds now)
+{
+	//Only idle established associations are monitored, shutdown has its own timers
+	if (state!=State::Established || heartbeatInterval==0ms)
+		//Don't restart it
+		return;
+	
+	//If the last one is still on the queue, the packet was not read yet
+	if (heartbeat && heartbeat.use_count()>1)
+	{
+		//Try again later
+		StartHeartbeatTimer();
+		return;
+	}
+	
+	//If the previous one has not been answered
+	if (heartbeatPending)
+	{
+		//Backoff as if it was a retransmission
+		retransmissionTimeout = std::min(retransmissionTimeout*2, MaxRetransmissionTimeout);
+		//Count it
+		OnPathError();
+	}
+	
+	//rfc4960#section-8.3
+	//	A destination transport address is considered "idle" if no new chunk
+	//	that can be used for updating path RTT (usually including first
+	//	transmission DATA, INIT, COOKIE ECHO, HEARTBEAT, etc.) and no
+	//	HEARTBEAT has been sent to it within the current heartbeat period of
+	//	that address.
+	//When there is data in flight T3-rtx already detects the failures
+	if (!heartbeatPending && (IsTimerRunning(T3) || now-lastDataSent<heartbeatInterval))
+	{
+		//Check again later
+		StartHeartbeatTimer();
+		return;
+	}
+	
+	//Create it only once
+	if (!heartbeat)
+		heartbeat = std::make_shared<HeartbeatRequestChunk>();
+	
+	//	The sender of the HEARTBEAT chunk should include in the Heartbeat
+	//	Information field of the chunk the current time when the packet is
+	//	sent out and the destination address to which the packet is sent.
+	//There is a single path, so only the time is needed
+	uint8_t info[8];
+	BufferWritter writter(info,sizeof(info));
+	writter.Set8(now.count());
+	heartbeat->senderSpecificHearbeatInfo.SetData(info,sizeof(info));
+	
+	//Waiting for the ack
+	heartbeatSent = now;
+	heartbeatPending = true;
+	
+	//Send it
+	Enqueue(std::static_pointer_cast<Chunk>(heartbeat));
+	
+	//Next one
+	StartHeartbeatTimer();
+}
+
+void Association::Process(HeartbeatRequestChunk& heartbeat)
+{
+	//rfc4960#section-8.3
+	//	The receiver of the HEARTBEAT should immediately respond with a
+	//	HEARTBEAT ACK that contains the Heartbeat Information TLV, together
+	//	with any other received TLVs, copied unchanged from the received
+	//	HEARTBEAT chunk.
+	auto ack = std::make_shared<HeartbeatAckChunk>();
+	
+	//The received chunk is discarded after this, so take its info
+	ack->senderSpecificHearbeatInfo = std::move(heartbeat.senderSpecificHearbeatInfo);
+	
+	//Send it
+	Enqueue(std::static_pointer_cast<Chunk>(ack));
+}
+
+void Association::Process(const HeartbeatAckChunk& ack)
+{
+	//Check it is one of ours
+	if (ack.senderSpecificHearbeatInfo.GetSize()!=8)
+		//Ignore
+		return;
+	
+	//Get the time it was sent
+	BufferReader reader(ack.senderSpecificHearbeatInfo);
+	std::chrono::milliseconds sent(reader.Get8());
+	
+	//Get now
+	auto now = timeService.GetNow();
+	
+	//Check it is not from the future
+	if (sent>now)
+		//Ignore
+		return;
+	
+	//rfc4960#section-8.3
+	//	Upon the receipt of the HEARTBEAT ACK, the sender of the HEARTBEAT
+	//	should clear the error counter of the destination transport address
+	//	to which the HEARTBEAT was sent, and mark the destination transport
+	//	address as active if it is not so marked.  The endpoint may
+	//	optionally report to the upper layer when an inactive destination
+	//	address is marked as active due to the reception of the latest
+	//	HEARTBEAT ACK.  The receiver of the HEARTBEAT ACK must also clear the
+	//	association overall error count as well (as defined in Section 8.1).
+	OnPathAlive();
+	
+	//	The receiver of the HEARTBEAT ACK should also perform an RTT
+	//	measurement for that destination transport address using the time
+	//	value carried in the HEARTBEAT ACK chunk.
+	//Only the latest one is measured, so late acks of unanswered ones are not used
+	if (heartbeatPending && sent==heartbeatSent)
+	{
+		//Answered
+		heartbeatPending = false;
+		//Update rto
+		UpdateRetransmissionTimeout(now-sent);
+	}
+}
+
+void Association::OnPathError()
+{
+	//rfc4960#section-8.2
+	//	When the value of this counter exceeds the limit indicated in the
+	//	protocol parameter 'Path.Max.Retrans' for that destination address,
+	//	the endpoint should mark the destination transport address as
+	//	inactive, and a notification SHOULD be sent to the upper layer.
+	if (++pathErrors>maxPathRetransmissions && pathActive)
+	{
+		//Inactive
+		pathActive = false;
+		//Report it only once
+		if (onPathFailure)
+			onPathFailure();
+	}
+}
+
+void Association::OnPathAlive()
+{
+	//Clear error counter
+	pathErrors = 0;
+	//Active again
+	pathActive = true;
+}
+
+uint64_t Association::ExtendLocalTransmissionSequenceNumber(uint32_t tsn) const
+{
+	//Get last sent one
+	uint64_t last = nextTransmissionSequenceNumber-1;
+	//Acks refer to tsns already sent, so go back from last one
+	return last - static_cast<uint32_t>(static_cast<uint32_t>(last) - tsn);
+}
+
+bool Association::IsDataBatch(const BufferReader& reader) const
+{
+	//Gaps, duplicates and data before we know the initial tsn take the generic path
+	if (state!=State::Established || !receivedOutOfOrder.empty() || lastReceivedTransmissionSequenceNumber==MaxTransmissionSequenceNumber)
+		//No
+		return false;
+	
+	size_t num = 0;
+	size_t sacks = 0;
+	uint16_t streamIdentifier = 0;
+	
+	//Check the chunks on the index without parsing them
+	for (const auto& entry : chunkIndex)
+	{
+		//A single SACK can be bundled
+		if (entry.type==Chunk::Type::SACK && !sacks++)
+			//Next
+			continue;
+		//Anything else is handled by the generic path
+		if (entry.type!=Chunk::Type::PDATA)
+			return false;
+		//All of them must be for the same stream
+		uint16_t id = reader.Get2(entry.offset+8);
+		if (num && id!=streamIdentifier)
+			return false;
+		streamIdentifier = id;
+		//And the next ones in sequence
+		uint32_t tsn = reader.Get4(entry.offset+4);
+		if (tsn!=static_cast<uint32_t>(lastReceivedTransmissionSequenceNumber+1+num))
+			return false;
+		num++;
+	}
+	
+	//Only if there is data
+	return num;
+}
+
+bool Association::ProcessDataBatch(const BufferReader& reader)
+{
+	uint16_t streamIdentifier = 0;
+	size_t fragmented = 0;
+	
+	//Get the stream and how much will be appended to its reassembly buffer
+	for (const auto& entry : chunkIndex)
+	{
+		//Skip the SACK
+		if (entry.type!=Chunk::Type::PDATA)
+			continue;
+		//All have the same stream
+		streamIdentifier = reader.Get2(entry.offset+8);
+		//Complete messages are delivered without copying
+		if ((entry.flag & PayloadDataChunk::BeginingFragment) && (entry.flag & PayloadDataChunk::EndingFragment))
+			continue;
+		fragmented += entry.length-PayloadDataChunk::HeaderSize;
+	}
+	
+	//Get stream
+	Stream& stream = GetIncomingStream(streamIdentifier);
+	
+	//Grow the reassembly buffer once for all the fragments
+	if (fragmented)
+		stream.Reserve(fragmented);
+	
+	//	After the reception of the first DATA chunk in an association the
+	//	endpoint MUST immediately respond with a SACK to acknowledge the DATA
+	//	chunk.
+	bool first = !dataReceived;
+	
+	//We have received data now
+	dataReceived = true;
+	
+	//For each chunk
+	for (const auto& entry : chunkIndex)
+	{
+		//The application may have aborted the association on a message
+		if (!CanReceiveData())
+			//Drop the rest as the generic path would do
+			break;
+		
+		//Count it
+		stats.chunksReceived[entry.type]++;
+		
+		//Parse it on its own reader
+		BufferReader chunk = reader.GetReader(entry.offset,SizePad(entry.length,4));
+		
+		//If it is the sack
+		if (entry.type==Chunk::Type::SACK)
+		{
+			//Parse it reusing last one
+			if (!SelectiveAcknowledgementChunk::Parse(chunk,receivedAcknowledgement))
+				//Malformed
+				return false;
+			//Process it
+			Process(receivedAcknowledgement);
+			//Next
+			continue;
+		}
+		
+		//Parse it pointing to the packet data
+		PayloadDataChunk::View pdata;
+		if (!PayloadDataChunk::Parse(chunk,pdata))
+			//Malformed
+			return false;
+		
+		TRACE_EVENT(datachannels::trace::ChunkProcessed,localVerificationTag,Chunk::Type::PDATA,state,pdata.transmissionSequenceNumber,pdata.userDataSize);
+		
+		//It was already checked to be the next one in sequence
+		lastReceivedTransmissionSequenceNumber = receivedTransmissionSequenceNumberWrapper.Wrap(pdata.transmissionSequenceNumber);
+		
+		//Deliver payload to the stream for reassembly
+		stream.Recv(pdata.payloadProtocolIdentifier,
+			pdata.userData,
+			pdata.userDataSize,
+			pdata.flag & PayloadDataChunk::BeginingFragment,
+			pdata.flag & PayloadDataChunk::EndingFragment);
+	}
+	
+	//Without gaps nor duplicates there is a single delayed sack decision for the whole packet
+	if (first || IsTimerRunning(DelayedAck))
+		//Acknoledge now
+		pendingAcknowledgeTimeout = 0ms;
+	//If it is the first chunk not acknowledged
+	else if (!pendingAcknowledge)
+		//Create timer
+		pendingAcknowledgeTimeout = SackTimeout;
+	
+	//We need to acknoledge
+	pendingAcknowledge = true;
+	
+	//Done
+	return true;
+}
+
+Stream& Association::GetIncomingStream(uint16_t id)
+{
+	//Get stream
+	auto stream = streams.Get(id);
+	
+	//If it is not opened yet
+	if (!stream)
+	{
+		//Create it, the remote peer is opening it
+		stream = &streams.Emplace(id,*this,id);
+		//Launch event
+		if (onIncomingStream)
+			onIncomingStream(*stream);
+	}
+	
+	return *stream;
+}
+
+void Association::Deliver(const PayloadDataChunk::View& pdata)
+{
+	//Get stream
+	auto stream = &GetIncomingStream(pdata.streamIdentifier);
+	
+	//Deliver payload to the stream for reassembly
+	stream->Recv(pdata.payloadProtocolIdentifier,
+		pdata.userData,
+		pdata.userDataSize,
+		pdata.flag & PayloadDataChunk::BeginingFragment,
+		pdata.flag & PayloadDataChunk::EndingFragment);
+}
+
 }; //namespace sctp
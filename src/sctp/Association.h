@@ -1,8 +1,11 @@
 #ifndef SCTP_ASSOCIATION_H_
 #define SCTP_ASSOCIATION_H_
+#include <array>
+#include <atomic>
 #include <list>
 #include <map>
-#include <set>
+#include <memory>
+#include <vector>
 
 #include "Datachannels.h"
 #include "sctp/SequenceNumberWrapper.h"
@@ -10,17 +13,40 @@
 #include "sctp/Stream.h"
 #include "BufferWritter.h"
 #include "BufferReader.h"
+#include "StreamTable.h"
+#include "CircularQueue.h"
+#include "MpscQueue.h"
+#include "Capture.h"
 
 using namespace std::chrono_literals;
 
 namespace sctp
 {
-	
+
 class Association : public datachannels::Transport, public TimeServiceWrapper<Association>
 {
 private:
 	using TransmissionSequenceNumberWrapper = SequenceNumberWrapper<uint32_t>;
 	static constexpr const uint64_t MaxTransmissionSequenceNumber = TransmissionSequenceNumberWrapper::MaxSequenceNumber;
+
+	// DATA chunk sent and not yet acknowledged by the cumulative TSN ack
+	struct Transmission
+	{
+		uint64_t transmissionSequenceNumber	= 0;
+		uint16_t streamIdentifier		= 0;
+		uint16_t streamSequenceNumber		= 0;
+		uint32_t payloadProtocolIdentifier	= 0;
+		uint8_t  flag				= 0;
+		//User data is a slice of the message payload
+		datachannels::Payload payload;
+		size_t offset				= 0;
+		size_t length				= 0;
+		std::chrono::milliseconds sent		= 0ms;
+		uint32_t transmissions			= 1;
+		uint32_t missingReports			= 0;
+		bool acknowledged			= false;
+		bool retransmit				= false;
+	};
 public:
 	enum State
 	{
@@ -34,6 +60,58 @@ public:
 		ShutDown,
 		ShutDownAckSent
 	};
+	
+	// Protocol timers, all of them share a single embedder timer armed for the earliest deadline
+	enum Timeout
+	{
+		T1,		// T1-init and T1-cookie
+		T2,		// T2-shutdown
+		T3,		// T3-rtx
+		T5,		// T5-shutdown-guard
+		DelayedAck,
+		Heartbeat,
+		NumTimeouts
+	};
+	
+	// Association statistics modelled after the SCTP MIB (rfc3873)
+	//	Counters are updated inline as packets are read and written and the
+	//	gauges are filled when the snapshot is taken, so it is a plain copy
+	//	that can be handed to another thread or diffed against a previous one.
+	struct Stats
+	{
+		//Packets and bytes on the wire, discarded ones are also counted as received
+		uint64_t packetsSent			= 0;
+		uint64_t packetsReceived		= 0;
+		uint64_t packetsDiscarded		= 0;
+		uint64_t bytesSent			= 0;
+		uint64_t bytesReceived			= 0;
+		//Chunks indexed by chunk type
+		std::array<uint64_t,256> chunksSent	= {};
+		std::array<uint64_t,256> chunksReceived	= {};
+		//DATA chunks sent again, either by T3-rtx expiration or fast retransmit
+		uint64_t retransmissions		= 0;
+		uint64_t fastRetransmits		= 0;
+		uint64_t retransmissionTimeouts		= 0;
+		//Received DATA chunks already acknowledged or buffered
+		uint64_t duplicateTransmissionSequenceNumbers = 0;
+		//Received DATA chunks out of order that didn't fit in the receiver window
+		uint64_t droppedTransmissionSequenceNumbers = 0;
+		//SACKs sent, the delayed ones were sent on the delayed ack timer
+		uint64_t acknowledgementsSent		= 0;
+		uint64_t delayedAcknowledgements	= 0;
+		uint64_t gapAckBlocksSent		= 0;
+		uint64_t gapAckBlocksReceived		= 0;
+		//Current values
+		size_t congestionWindow			= 0;
+		size_t slowStartThreshold		= 0;
+		size_t remoteReceiverWindow		= 0;
+		size_t localReceiverWindow		= 0;
+		size_t bytesInFlight			= 0;
+		size_t outstandingChunks		= 0;
+		size_t queuedBytes			= 0;
+		std::chrono::milliseconds retransmissionTimeout	= 0ms;
+		std::chrono::milliseconds smoothedRoundTripTime	= 0ms;
+	};
 private:
 	// Private constructor to prevent creating without TimeServiceWrapper::Create() factory
 	friend class TimeServiceWrapper<Association>;
@@ -41,8 +119,9 @@ private:
 
 public:
 	virtual ~Association();
-	
+
 	bool Associate();
+	// Stop accepting new messages and close gracefully once all queued data has been acknowledged
 	bool Shutdown();
 	bool Abort();
 
@@ -50,13 +129,31 @@ public:
 	void SetRemotePort(uint16_t port) 	{ remotePort = port;	}
 	uint16_t GetLocalPort() const 		{ return localPort;	}
 	uint16_t GetRemotePort() const		{ return remotePort;	}
+	uint32_t GetLocalVerificationTag() const{ return localVerificationTag;	}
 	State GetState() const			{ return state;		}
-	bool HasPendingData() const		{ return pendingData;	}
-	
-	  
+	bool HasPendingData() const		{ return pendingData || submitted.load(std::memory_order_acquire);	}
+	Stats GetStats() const;
+	// Interval added to the RTO between heartbeats on an idle path, zero disables them
+	void SetHeartbeatInterval(std::chrono::milliseconds interval);
+	void SetMaxPathRetransmissions(uint32_t max)	{ maxPathRetransmissions = max;	}
+	bool IsPathActive() const		{ return pathActive;	}
+	// Write all sent and received packets to a pcapng capture, null to stop
+	void SetCapture(const datachannels::Capture::shared& capture)	{ this->capture = capture;	}
+
+	Stream* GetStream(uint16_t id) const	{ return streams.Get(id);	}
+	Stream& OpenStream(uint16_t id);
+	// Queue a message from any thread, it is passed to the stream on the next ReadPacket
+	//	The submitted callback is called from the calling thread, so it must only wake up
+	//	the thread owning the association. Without it HasPendingData has to be polled.
+	void Submit(uint16_t id, uint32_t ppid, const datachannels::Payload& payload, bool unordered = false);
+
+	using datachannels::Transport::ReadPacket;
+	// Returns 0 when there is nothing to send or size is smaller than MinReadSize
 	virtual size_t ReadPacket(uint8_t *data, uint32_t size) override;
+	// User data of DATA chunks is not copied to data, the slices point to the message payloads
+	virtual size_t ReadPacket(uint8_t *data, uint32_t size, std::vector<datachannels::Slice>& slices) override;
 	virtual size_t WritePacket(uint8_t *data, uint32_t size) override;
-	
+
 	inline size_t ReadPacket(Buffer& buffer)
 	{
 		size_t len = ReadPacket(buffer.GetData(),buffer.GetCapacity());
@@ -67,48 +164,216 @@ public:
 	{
 		return WritePacket(buffer.GetData(),buffer.GetSize());
 	}
-	
+
 	virtual void OnPendingData(std::function<void(void)> callback) override
 	{
 		onPendingData = callback;
 	}
-	
+	void OnSubmitted(std::function<void(void)> callback)
+	{
+		//Called from the threads submitting messages, it can be changed while they are running
+		std::atomic_store(&onSubmitted,callback ? std::make_shared<const std::function<void(void)>>(std::move(callback)) : nullptr);
+	}
+
+	// Event handlers
+	void OnIncomingStream(std::function<void(Stream&)> callback)
+	{
+		//Called when the remote peer sends data on a stream not opened yet
+		onIncomingStream = callback;
+	}
+	void OnMessage(std::function<void(Stream&,uint32_t,const uint8_t*,uint64_t)> callback)
+	{
+		//Called for every message completed on any stream, after the stream own handler
+		onMessage = callback;
+	}
+	void OnClosed(std::function<void(void)> callback)
+	{
+		//Called when the shutdown sequence completes, or is given up because the peer doesn't answer
+		onClosed = callback;
+	}
+	void OnPathFailure(std::function<void(void)> callback)
+	{
+		//Called once when the peer stops answering, until a HEARTBEAT ACK or SACK is received again
+		onPathFailure = callback;
+	}
+
 	static constexpr const size_t MaxInitRetransmits = 10;
 	static constexpr const std::chrono::milliseconds InitRetransmitTimeout	= 100ms;
 	static constexpr const std::chrono::milliseconds SackTimeout		= 100ms;
+
+	//rfc4960#section-15 with lower values as ICE and DTLS already validated the path
+	static constexpr const std::chrono::milliseconds InitialRetransmissionTimeout	= 500ms;
+	static constexpr const std::chrono::milliseconds MinRetransmissionTimeout	= 200ms;
+	static constexpr const std::chrono::milliseconds MaxRetransmissionTimeout	= 60000ms;
+	static constexpr const std::chrono::milliseconds HeartbeatInterval		= 30000ms;
+	static constexpr const uint32_t MaxPathRetransmissions				= 5;
+	static constexpr const uint32_t MaxAssociationRetransmissions			= 10;
+	static constexpr const std::chrono::milliseconds ShutdownGuardTimeout		= 5*MaxRetransmissionTimeout;
+
+	// draft-ietf-rtcweb-data-channel-13
+	//	The initial Path MTU at the IP layer SHOULD NOT exceed 1200 bytes.
+	static constexpr const size_t MaxPacketSize		= 1200;
+	//Don't split a message in fragments smaller than this just to fill a packet
+	static constexpr const size_t MinFragmentSize		= 64;
+	//Control chunks are sized for the path MTU and never split, so smaller buffers could hold them back forever
+	static constexpr const size_t MinReadSize		= MaxPacketSize;
+	//Bytes of user data held until the gaps are filled, in order ones are delivered straight to the streams
+	static constexpr const uint32_t ReceiverWindow		= 1024*1024;
 private:
+	// Message sent from another thread
+	struct Submission
+	{
+		uint16_t id		= 0;
+		uint32_t ppid		= 0;
+		bool unordered		= false;
+		datachannels::Payload payload;
+	};
+private:
+	// Stream needs to signal that it has pending messages
+	friend class Stream;
+
 	void Process(const Chunk::shared& chunk);
+	void Process(const PayloadDataChunk::View& pdata);
+	void Process(const SelectiveAcknowledgementChunk& sack);
+	void Process(HeartbeatRequestChunk& heartbeat);
+	void Process(const HeartbeatAckChunk& ack);
+	void Process(const ShutdownAssociationChunk& shutdown);
+	void Deliver(const PayloadDataChunk::View& pdata);
+	bool IsDataBatch(const BufferReader& reader) const;
+	bool ProcessDataBatch(const BufferReader& reader);
+	Stream& GetIncomingStream(uint16_t id);
 	void SetState(State state);
+	bool Discard(uint32_t size);
 	void Enqueue(const Chunk::shared& chunk);
+	void Enqueue(Stream& stream);
 	void Acknowledge();
+	void DrainSubmissions();
 	void ResetTimers();
+	void SendShutdown();
+	void SendShutdownAcknowledgement();
+	void ContinueShutdown();
+	void CompleteShutdown();
+	void OnT2Timeout();
+	void OnShutdownGuardTimeout();
+	
+	// New messages are accepted from the user until shutdown is requested
+	bool IsAcceptingMessages() const	{ return state<State::ShutdownPending;	}
+	// Queued and outstanding DATA chunks are sent until the shutdown sequence has acknowledged all of them
+	bool CanSendData() const		{ return state==State::Established || state==State::ShutdownPending || state==State::ShutDownReceived;	}
+	// DATA chunks are received until the peer has started its own shutdown
+	bool CanReceiveData() const		{ return state==State::Established || state==State::ShutdownPending || state==State::ShutDownSent;	}
+
+	bool IsDataReady() const;
+	void SignalPendingData();
+	size_t BuildPacket(uint8_t *data, uint32_t size, std::vector<datachannels::Slice>* slices);
+	bool WriteDataChunk(BufferWritter& writter, const Transmission& transmission);
+	size_t WriteRetransmissions(BufferWritter& writter, std::chrono::milliseconds now);
+	size_t WriteData(BufferWritter& writter, std::chrono::milliseconds now);
+	void StartTimer(Timeout timeout, std::chrono::milliseconds ms);
+	void StopTimer(Timeout timeout)			{ deadlines[timeout] = Never;		}
+	bool IsTimerRunning(Timeout timeout) const	{ return deadlines[timeout]!=Never;	}
+	void OnTimer(std::chrono::milliseconds now);
+	void OnT1Timeout();
+	void StartRetransmissionTimer();
+	void OnRetransmissionTimeout();
+	void UpdateRetransmissionTimeout(std::chrono::milliseconds rtt);
+	void StartHeartbeatTimer();
+	void OnHeartbeatTimeout(std::chrono::milliseconds now);
+	void OnPathError();
+	void OnPathAlive();
+	uint64_t ExtendLocalTransmissionSequenceNumber(uint32_t tsn) const;
 private:
+	datachannels::TimeService& timeService;
 	State state = State::Closed;
 	std::list<Chunk::shared> queue;
-	
+
 	uint16_t localPort = 0;
 	uint16_t remotePort = 0;
-	uint32_t localAdvertisedReceiverWindowCredit = 0xFFFFFFFF;
+	uint32_t localAdvertisedReceiverWindowCredit = ReceiverWindow;
 	uint32_t remoteAdvertisedReceiverWindowCredit = 0;
 	uint32_t localVerificationTag = 0;
 	uint32_t remoteVerificationTag = 0;
 	uint32_t initRetransmissions = 0;
-	
+	uint32_t shutdownRetransmissions = 0;
+
 	bool pendingAcknowledge = false;
 	std::chrono::milliseconds pendingAcknowledgeTimeout = 0ms;
-	
-	datachannels::Timer::shared initTimer;
-	datachannels::Timer::shared cookieEchoTimer;
-	datachannels::Timer::shared sackTimer;
-	
+
+	// Deadline table, stopped timers are set to never
+	static constexpr const std::chrono::milliseconds Never = std::chrono::milliseconds::max();
+	std::array<std::chrono::milliseconds,NumTimeouts> deadlines;
+	// Single embedder timer and the deadline it is armed for, stopping a timer doesn't cancel it
+	datachannels::Timer::shared timer;
+	std::chrono::milliseconds timerDeadline = Never;
+	// INIT or COOKIE ECHO chunk retransmitted on T1 expiration
+	Chunk::shared t1Chunk;
+
+	// Receiving side
 	size_t numberOfPacketsWithoutAcknowledge = 0;
 	TransmissionSequenceNumberWrapper receivedTransmissionSequenceNumberWrapper;
 	uint64_t lastReceivedTransmissionSequenceNumber = MaxTransmissionSequenceNumber;
+	bool dataReceived = false;
+	std::map<uint64_t,std::shared_ptr<PayloadDataChunk>> receivedOutOfOrder;
+	size_t receivedOutOfOrderBytes = 0;
+	std::vector<uint32_t> duplicatedTransmissionSequenceNumbers;
+	// SACK chunks generated since last packet, they are reused so the established path doesn't allocate
+	std::vector<SelectiveAcknowledgementChunk> acknowledgements;
+	size_t pendingAcknowledgements = 0;
+	SelectiveAcknowledgementChunk receivedAcknowledgement;
+	// Chunks of the packet being written, reused between packets
+	std::vector<Chunk::IndexEntry> chunkIndex;
+
+	// Sending side, extended TSNs start at 2^32 so we can unwrap the acks of the initial TSN-1
+	uint64_t nextTransmissionSequenceNumber = 1ull<<32;
+	CircularQueue<Transmission> outstanding;
+	CircularQueue<uint16_t> pendingStreams;
+	size_t pendingRetransmissions = 0;
+	size_t bytesInFlight = 0;
+	// User data not yet sent in any DATA chunk, on all streams
+	size_t queuedBytes = 0;
+
+	// Congestion control rfc4960#section-7.2
+	size_t congestionWindow = 0;
+	size_t slowStartThreshold = 0;
+	size_t partialBytesAcked = 0;
+	uint64_t fastRecoveryExitPoint = 0;
+	bool fastRecovery = false;
+
+	// Retransmission timer rfc4960#section-6.3.1
+	std::chrono::milliseconds smoothedRoundTripTime = 0ms;
+	std::chrono::milliseconds roundTripTimeVariation = 0ms;
+	std::chrono::milliseconds retransmissionTimeout = InitialRetransmissionTimeout;
+
+	// Path liveness rfc4960#section-8.3, a single HEARTBEAT is outstanding at any time
+	std::chrono::milliseconds heartbeatInterval = HeartbeatInterval;
+	std::chrono::milliseconds lastDataSent = 0ms;
+	std::chrono::milliseconds heartbeatSent = 0ms;
+	bool heartbeatPending = false;
+	// Reused while not queued, so idle associations don't allocate
+	std::shared_ptr<HeartbeatRequestChunk> heartbeat;
+	uint32_t pathErrors = 0;
+	uint32_t maxPathRetransmissions = MaxPathRetransmissions;
+	bool pathActive = true;
+
+	// Counters, gauges are filled on GetStats
+	Stats stats;
+	datachannels::Capture::shared capture;
 	
+	// Slices of the packet being built by a scatter-gather read and start of the headers not added yet
+	std::vector<datachannels::Slice>* slices = nullptr;
+	size_t sliced = 0;
+
 	bool pendingData = false;
+	// Messages from other threads, submitted is set when there are new ones
+	MpscQueue<Submission> submissions;
+	std::atomic<bool> submitted{false};
 	std::function<void(void)> onPendingData;
-	std::multiset<uint64_t> receivedTransmissionSequenceNumbers;
-	std::map<uint16_t,Stream::shared> streams;
+	std::shared_ptr<const std::function<void(void)>> onSubmitted;
+	std::function<void(Stream&)> onIncomingStream;
+	std::function<void(Stream&,uint32_t,const uint8_t*,uint64_t)> onMessage;
+	std::function<void(void)> onPathFailure;
+	std::function<void(void)> onClosed;
+	StreamTable<Stream> streams;
 };
 
 }
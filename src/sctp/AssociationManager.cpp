@@ -0,0 +1,297 @@
+#include "sctp/AssociationManager.h"
+
+#include <iterator>
+
+namespace sctp
+{
+
+AssociationManager::AssociationManager(datachannels::TimeService& timeService) :
+	timeService(timeService)
+{
+}
+
+AssociationManager::~AssociationManager()
+{
+	//Stop listening
+	for (auto& [key,entry] : entries)
+	{
+		entry.association->OnPendingData(nullptr);
+		entry.association->OnSubmitted(nullptr);
+	}
+}
+
+Association* AssociationManager::Create(Key key)
+{
+	//Check it is not already in use before creating the association
+	if (entries.count(key))
+		//Error
+		return nullptr;
+	
+	//Create association and manage it
+	return Adopt(key,Association::Create(timeService));
+}
+
+Association* AssociationManager::Adopt(Key key, const std::shared_ptr<Association>& association)
+{
+	//Insert new entry
+	auto [it,inserted] = entries.try_emplace(key);
+	
+	//Check it was not already in use
+	if (!inserted)
+		//Error
+		return nullptr;
+	
+	//Get entry, its address is stable until it is erased
+	Entry& entry = it->second;
+	
+	//Set association
+	entry.key		= key;
+	entry.association	= association;
+	
+	//Add to the ready list when it has something to send, found by key as user callbacks may remove it
+	entry.association->OnPendingData([this,key](){
+		if (auto it = entries.find(key); it!=entries.end())
+			SetReady(it->second);
+	});
+	//Messages from other threads can't touch the ready list, so pass the key to our thread
+	entry.association->OnSubmitted([this,key](){
+		Key submission = key;
+		submitted.push(std::move(submission));
+		if (onSubmitted)
+			onSubmitted();
+	});
+	
+	//Index it if it was already associated
+	Index(entry);
+	
+	//It may have been moved with pending data
+	if (entry.association->HasPendingData())
+		SetReady(entry);
+	
+	//Done
+	return entry.association.get();
+}
+
+std::shared_ptr<Association> AssociationManager::Release(Key key)
+{
+	//Find entry
+	auto it = entries.find(key);
+	
+	//If not found
+	if (it==entries.end())
+		//Error
+		return nullptr;
+	
+	//Remove verification tag index
+	Unindex(it->second);
+	
+	//Stop listening, the association may outlive us if referenced somewhere else
+	auto association = std::move(it->second.association);
+	association->OnPendingData(nullptr);
+	association->OnSubmitted(nullptr);
+	
+	//Remove it, if it was in the ready list it will be skipped
+	entries.erase(it);
+	
+	//Done
+	return association;
+}
+
+bool AssociationManager::Remove(Key key)
+{
+	//Release it and drop our reference
+	return Release(key)!=nullptr;
+}
+
+std::optional<AssociationManager::Key> AssociationManager::GetReady() const
+{
+	//Find first one not removed
+	for (auto key : ready)
+		if (entries.count(key))
+			return key;
+	//None
+	return std::nullopt;
+}
+
+Association* AssociationManager::Get(Key key) const
+{
+	//Find entry
+	auto it = entries.find(key);
+	//Return association if found
+	return it!=entries.end() ? it->second.association.get() : nullptr;
+}
+
+bool AssociationManager::WritePacket(Key key, uint8_t *data, uint32_t size)
+{
+	//Find entry
+	auto it = entries.find(key);
+	
+	//If not found
+	if (it==entries.end())
+		//Error
+		return false;
+	
+	//Write it
+	return WritePacket(key,it->second.association,data,size);
+}
+
+bool AssociationManager::WritePacket(uint8_t *data, uint32_t size)
+{
+	//Check we have the common header
+	if (size<12)
+		//Error
+		return false;
+	
+	//Get verification tag from common header
+	uint32_t verificationTag = BufferReader(data,size).Get4(4);
+	
+	//rfc4960#section-8.5.1
+	//	An INIT chunk MUST be sent with the Verification Tag set to 0, so it
+	//	can't be routed by tag
+	if (!verificationTag)
+		//Error
+		return false;
+	
+	//Find associations using it
+	auto [first,last] = verificationTags.equal_range(verificationTag);
+	
+	//If not found
+	if (first==last)
+		//Error
+		return false;
+	
+	//If more than one association has picked the same tag
+	if (std::next(first)!=last)
+		//Can't know which one it is for
+		return false;
+	
+	//Write it
+	return WritePacket(first->second->key,first->second->association,data,size);
+}
+
+bool AssociationManager::WritePacket(Key key, std::shared_ptr<Association> association, uint8_t *data, uint32_t size)
+{
+	//Process packet, keeping our own reference as user callbacks may remove it
+	bool ok = association->WritePacket(data,size);
+	
+	//Find it again, the entry may be gone or hold a new association now
+	auto it = entries.find(key);
+	
+	//Local tag is set when receiving the INIT
+	if (it!=entries.end() && it->second.association==association)
+		Index(it->second);
+	
+	//Done
+	return ok;
+}
+
+size_t AssociationManager::ReadPackets(uint8_t *data, uint32_t size, const std::function<void(Key,const uint8_t*,size_t)>& send)
+{
+	size_t num = 0;
+	
+	//Add the ones with messages from other threads, removed ones are skipped
+	Key submission;
+	while (submitted.pop(submission))
+		if (auto it = entries.find(submission); it!=entries.end())
+			SetReady(it->second);
+	
+	//Swap ready list, associations signaling pending data while sending will be read on next call
+	flushing.swap(ready);
+	
+	//For each ready association
+	for (auto key : flushing)
+	{
+		//Find entry
+		auto it = entries.find(key);
+		
+		//Skip removed ones
+		if (it==entries.end())
+			continue;
+		
+		//Not in the ready list anymore
+		it->second.ready = false;
+		
+		//Local tag is set when sending the INIT
+		Index(it->second);
+		
+		//Keep our own reference, the send callback may remove it
+		auto association = it->second.association;
+		
+		//Read all packets
+		while (size_t len = association->ReadPacket(data,size))
+		{
+			//Send it
+			send(key,data,len);
+			//One more
+			num++;
+			//Stop if it has been removed or replaced
+			if (it = entries.find(key); it==entries.end() || it->second.association!=association)
+				break;
+		}
+	}
+	
+	//Clear it, keeping memory
+	flushing.clear();
+	
+	//Done
+	return num;
+}
+
+void AssociationManager::Index(Entry& entry)
+{
+	//Get current local tag
+	uint32_t verificationTag = entry.association->GetLocalVerificationTag();
+	
+	//If it has not changed
+	if (verificationTag==entry.verificationTag)
+		//Nothing to do
+		return;
+	
+	//Remove previous one
+	Unindex(entry);
+	
+	//Store new one
+	entry.verificationTag = verificationTag;
+	
+	//Index it, along any other association that has the same tag
+	if (verificationTag)
+		verificationTags.emplace(verificationTag,&entry);
+}
+
+void AssociationManager::Unindex(Entry& entry)
+{
+	//If not indexed
+	if (!entry.verificationTag)
+		//Nothing to do
+		return;
+	
+	//Find associations using its tag
+	auto [first,last] = verificationTags.equal_range(entry.verificationTag);
+	
+	//Remove only this one, others with the same tag keep their route
+	for (auto it=first; it!=last; ++it)
+	{
+		if (it->second==&entry)
+		{
+			verificationTags.erase(it);
+			break;
+		}
+	}
+	
+	//Not indexed anymore
+	entry.verificationTag = 0;
+}
+
+void AssociationManager::SetReady(Entry& entry)
+{
+	//If it is already in the list
+	if (entry.ready)
+		//Nothing to do
+		return;
+	
+	//Add it
+	entry.ready = true;
+	ready.push_back(entry.key);
+}
+
+}; // namespace sctp
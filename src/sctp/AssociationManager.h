@@ -0,0 +1,90 @@
+#ifndef SCTP_ASSOCIATIONMANAGER_H_
+#define SCTP_ASSOCIATIONMANAGER_H_
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "Datachannels.h"
+#include "MpscQueue.h"
+#include "sctp/Association.h"
+
+namespace sctp
+{
+
+// Owns many associations sharing the same thread and time service
+//	Inbound packets are routed by the embedder connection key or by the
+//	verification tag of the SCTP common header, and outbound packets are
+//	only read from the associations that signaled pending data, so the
+//	work done on each I/O loop iteration depends on the active peers only.
+class AssociationManager
+{
+public:
+	using Key = uint64_t;
+private:
+	struct Entry
+	{
+		Key key;
+		std::shared_ptr<Association> association;
+		//Local verification tag it is indexed by, 0 if not indexed yet
+		uint32_t verificationTag	= 0;
+		//Already in the ready list
+		bool ready			= false;
+	};
+public:
+	AssociationManager(datachannels::TimeService& timeService);
+	~AssociationManager();
+	
+	//Not copiable, associations keep a pointer to their entry
+	AssociationManager(const AssociationManager&) = delete;
+	AssociationManager& operator=(const AssociationManager&) = delete;
+	
+	// Create new association for the embedder connection key
+	Association* Create(Key key);
+	// Manage an association created elsewhere, so it can be moved between managers
+	Association* Adopt(Key key, const std::shared_ptr<Association>& association);
+	// Stop managing it and return it, null if not found
+	std::shared_ptr<Association> Release(Key key);
+	bool Remove(Key key);
+	Association* Get(Key key) const;
+	// Get one of the associations with pending data, if any
+	std::optional<Key> GetReady() const;
+	// Called from the threads submitting messages to the associations, so it must only wake up our thread
+	void OnSubmitted(std::function<void(void)> callback)	{ onSubmitted = callback;	}
+	
+	// Route packet by embedder key, required for INIT packets as they carry no verification tag
+	bool WritePacket(Key key, uint8_t *data, uint32_t size);
+	// Route packet by the verification tag of the common header
+	//	Fails if the tag is not known or is used by more than one association, the embedder key must be used then
+	bool WritePacket(uint8_t *data, uint32_t size);
+	
+	// Read all pending packets from the associations in the ready list
+	//	The send callback may remove associations, no more packets are read from them then
+	size_t ReadPackets(uint8_t *data, uint32_t size, const std::function<void(Key,const uint8_t*,size_t)>& send);
+	
+	size_t GetCount() const		{ return entries.size();	}
+	bool HasPendingData() const	{ return !ready.empty() || !submitted.empty();	}
+	// Number of associations in the ready list, may include removed ones
+	size_t GetReadyCount() const	{ return ready.size();		}
+private:
+	bool WritePacket(Key key, std::shared_ptr<Association> association, uint8_t *data, uint32_t size);
+	void Index(Entry& entry);
+	void Unindex(Entry& entry);
+	void SetReady(Entry& entry);
+private:
+	datachannels::TimeService& timeService;
+	std::unordered_map<Key,Entry> entries;
+	//Tags are random, so different associations may pick the same one
+	std::unordered_multimap<uint32_t,Entry*> verificationTags;
+	//Keys of the associations with pending data, removed ones are skipped
+	std::vector<Key> ready;
+	std::vector<Key> flushing;
+	//Keys of the associations with messages submitted from other threads
+	MpscQueue<Key> submitted;
+	std::function<void(void)> onSubmitted;
+};
+
+}; // namespace sctp
+#endif
@@ -52,4 +52,49 @@ Chunk::shared Chunk::Parse(BufferReader& reader)
 	return UnknownChunk::Parse(reader);
 }
 
+bool Chunk::Index(const BufferReader& reader, std::vector<IndexEntry>& index)
+{
+	//Clear previous ones but keep capacity
+	index.clear();
+	
+	//Start on current position
+	size_t offset = reader.Mark();
+	size_t size = reader.GetSize();
+	
+	//Chunks are aligned to 4 bytes, less than a header left is ignored as padding
+	while (offset+4<=size)
+	{
+		IndexEntry entry;
+		entry.type	= reader.Get1(offset);
+		entry.flag	= reader.Get1(offset+1);
+		entry.length	= reader.Get2(offset+2);
+		entry.offset	= offset;
+		
+		//rfc4960#section-3.2
+		//	The Chunk Length value does not include terminating padding of the chunk.
+		//	The total length of a chunk (including Type, Length, and Value fields)
+		//	MUST be a multiple of 4 bytes.
+		size_t padded = SizePad(entry.length,4);
+		
+		//Check the header fits and the chunk with its padding is in the packet
+		if (entry.length<4 || offset+padded>size)
+			//Malformed
+			return false;
+		
+		//Fixed size part of the chunks parsed in place
+		if ((entry.type==Type::PDATA && entry.length<PayloadDataChunk::HeaderSize) || (entry.type==Type::SACK && entry.length<16))
+			//Malformed
+			return false;
+		
+		//Add it
+		index.push_back(entry);
+		
+		//Next one
+		offset += padded;
+	}
+	
+	//Done
+	return true;
+}
+
 };
@@ -2,10 +2,12 @@
 #define SCTP_CHUNK_H_
 #include <stdint.h>
 #include <memory>
+#include <vector>
 
 #include "Buffer.h"
 #include "BufferReader.h"
 #include "BufferWritter.h"
+#include "FixedLayout.h"
 
 namespace sctp
 {
@@ -73,6 +75,19 @@ public:
 		Padding					= 0x8005, //rfc480
 	};
 	
+	// Position of a chunk on a packet, as found by Index
+	struct IndexEntry
+	{
+		uint8_t  type	= 0;
+		uint8_t  flag	= 0;
+		//Without padding
+		uint16_t length	= 0;
+		uint32_t offset	= 0;
+	};
+	
+	// Type, flags and length common to all chunks
+	using HeaderLayout = FixedLayout<uint8_t,uint8_t,uint16_t>;
+	
 	Chunk(uint8_t type)
 	{
 		this->type = type;
@@ -80,6 +95,9 @@ public:
 	virtual ~Chunk() = default;
 	
 	static Chunk::shared Parse(BufferReader& buffer);
+	//Walk the headers of all the chunks left on the reader, checking their length and padding
+	//	Fails without touching the reader if any of them is malformed, index is reused.
+	static bool Index(const BufferReader& reader, std::vector<IndexEntry>& index);
 	virtual size_t GetSize() const = 0;
 	virtual size_t Serialize(BufferWritter& buffer) const = 0;
 	
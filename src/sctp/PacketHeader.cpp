@@ -11,19 +11,31 @@ PacketHeader::PacketHeader(uint16_t sourcePortNumber,uint16_t destinationPortNum
 	this->checksum = checksum;
 }
 
-PacketHeader::shared PacketHeader::Parse(BufferReader& reader)
+bool PacketHeader::Parse(BufferReader& reader, PacketHeader& header)
 {
-	//Check size
-	if (!reader.Assert(8)) return nullptr;
+	//Check size once
+	BufferReader::Window window;
+	if (!reader.GetWindow(12,window)) return false;
 	
 	//Get header
-	uint16_t sourcePortNumber	= reader.Get2();
-	uint16_t destinationPortNumber	= reader.Get2();
-	uint32_t verificationTag	= reader.Get4();
-	uint32_t checksum		= reader.Get4Reversed();
+	header.sourcePortNumber		= window.Get2();
+	header.destinationPortNumber	= window.Get2();
+	header.verificationTag		= window.Get4();
+	header.checksum			= window.Get4Reversed();
 	
+	//Done
+	return true;
+}
+
+PacketHeader::shared PacketHeader::Parse(BufferReader& reader)
+{
 	//Create PacketHeader
-	auto header = std::make_shared<PacketHeader>(sourcePortNumber,destinationPortNumber,verificationTag,checksum);
+	auto header = std::make_shared<PacketHeader>();
+	
+	//Parse it
+	if (!Parse(reader,*header))
+		//Error
+		return nullptr;
 	
 	//Done
 	return header;
@@ -37,14 +49,15 @@ size_t PacketHeader::GetSize() const
 
 size_t PacketHeader::Serialize(BufferWritter& writter) const
 {
-	//Check size
-	if (!writter.Assert(12)) return 0;
+	//Check size once
+	BufferWritter::Window window;
+	if (!writter.GetWindow(12,window)) return 0;
 	
 	//Set header
-	writter.Set2(sourcePortNumber);
-	writter.Set2(destinationPortNumber);
-	writter.Set4(verificationTag);
-	writter.Set4Reversed(checksum);
+	window.Set2(sourcePortNumber);
+	window.Set2(destinationPortNumber);
+	window.Set4(verificationTag);
+	window.Set4Reversed(checksum);
 	
 	//Done
 	return writter.GetLength();
@@ -15,10 +15,12 @@ class PacketHeader
 public:
 	using shared = std::shared_ptr<PacketHeader>;
 public:	
+	PacketHeader() = default;
 	PacketHeader(uint16_t sourcePortNumber,uint16_t destinationPortNumber,uint32_t verificationTag, uint32_t checksum = 0);
 	~PacketHeader() = default;
 	
 	static PacketHeader::shared Parse(BufferReader& buffer) ;
+	static bool Parse(BufferReader& buffer, PacketHeader& header);
 	size_t Serialize(BufferWritter& buffer) const;
 	size_t GetSize() const;
 public:
@@ -0,0 +1,574 @@
+#include "sctp/Runtime.h"
+
+#include <algorithm>
+
+namespace sctp
+{
+
+Runtime::Clock::Timer::Timer(Clock& clock, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> callback) :
+	clock(clock),
+	repeat(repeat),
+	callback(std::move(callback))
+{
+}
+
+void Runtime::Clock::Timer::Cancel()
+{
+	//Not armed anymore
+	deadline.reset();
+	//Remove from wheel
+	if (timer)
+		timer->Cancel();
+}
+
+void Runtime::Clock::Timer::Again(const std::chrono::milliseconds& ms)
+{
+	//Keep deadline in case it is moved to another wheel
+	deadline = clock.GetNow() + ms;
+	//Schedule on wheel
+	if (timer)
+		timer->Again(ms);
+}
+
+void Runtime::Clock::Timer::Attach(datachannels::TimerWheel& wheel)
+{
+	std::weak_ptr<Timer> weak = weak_from_this();
+
+	//Create timer on the wheel without scheduling it, repetitions are handled by us
+	timer = wheel.CreateTimer([weak](std::chrono::milliseconds now){
+		//Check we are still alive
+		if (auto self = weak.lock())
+			self->Fire(now);
+	});
+
+	//If it was armed
+	if (deadline)
+		//Schedule for the remaining time
+		timer->Again(std::max(*deadline - wheel.GetNow(),std::chrono::milliseconds(0)));
+}
+
+void Runtime::Clock::Timer::Detach()
+{
+	//Remove from the wheel, deadline is kept
+	timer.reset();
+}
+
+void Runtime::Clock::Timer::Fire(std::chrono::milliseconds now)
+{
+	//Not armed anymore
+	deadline.reset();
+	//Schedule again if repeating, before the callback so it can cancel it
+	if (repeat.count())
+		Again(repeat);
+	//Fire
+	callback(now);
+}
+
+void Runtime::Clock::Detach()
+{
+	//Keep time for timers armed while moving
+	detached = wheel->GetNow();
+	wheel = nullptr;
+
+	//Remove timers from the wheel
+	for (auto& weak : timers)
+		if (auto timer = weak.lock())
+			timer->Detach();
+}
+
+void Runtime::Clock::Attach(datachannels::TimerWheel& wheel)
+{
+	this->wheel = &wheel;
+
+	//Arm timers on the new wheel
+	for (auto& weak : timers)
+		if (auto timer = weak.lock())
+			timer->Attach(wheel);
+}
+
+const std::chrono::milliseconds Runtime::Clock::GetNow() const
+{
+	return wheel ? wheel->GetNow() : detached;
+}
+
+datachannels::Timer::shared Runtime::Clock::CreateTimer(std::function<void(std::chrono::milliseconds)> callback)
+{
+	//Create timer without repetitions
+	auto timer = std::make_shared<Timer>(*this,std::chrono::milliseconds(0),std::move(callback));
+
+	//Add to wheel
+	if (wheel)
+		timer->Attach(*wheel);
+
+	//Drop the ones already released
+	timers.erase(std::remove_if(timers.begin(),timers.end(),[](const auto& weak){ return weak.expired(); }),timers.end());
+	//Keep it so it can be moved
+	timers.push_back(timer);
+
+	//Done
+	return timer;
+}
+
+datachannels::Timer::shared Runtime::Clock::CreateTimer(const std::chrono::milliseconds& ms, std::function<void(std::chrono::milliseconds)> timeout)
+{
+	//Timer without repeat
+	return CreateTimer(ms,std::chrono::milliseconds(0),std::move(timeout));
+}
+
+datachannels::Timer::shared Runtime::Clock::CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> timeout)
+{
+	//Create timer
+	auto timer = std::static_pointer_cast<Timer>(CreateTimer(std::move(timeout)));
+	timer->repeat = repeat;
+
+	//Schedule it
+	timer->Again(ms);
+
+	//Done
+	return timer;
+}
+
+Runtime::Shard::Shard(size_t index, std::chrono::milliseconds now) :
+	index(index),
+	wheel(now),
+	manager(wheel)
+{
+}
+
+Runtime::Runtime(const Send& send, size_t workers) :
+	send(send),
+	start(std::chrono::steady_clock::now())
+{
+	//One per core by default
+	if (!workers)
+		workers = std::max(1u,std::thread::hardware_concurrency());
+
+	//Create all shards before starting any worker, as they steal from each other
+	for (size_t i=0; i<workers; ++i)
+		shards.push_back(std::make_unique<Shard>(i,GetNow()));
+	
+	//Messages submitted from other threads wake up the worker owning the association
+	for (auto& shard : shards)
+		shard->manager.OnSubmitted([this,shard=shard.get()](){ Wake(*shard); });
+
+	//Start workers
+	for (auto& shard : shards)
+		shard->thread = std::thread([this,shard=shard.get()](){ Run(*shard); });
+}
+
+Runtime::~Runtime()
+{
+	//Stop all workers
+	stopping = true;
+	for (auto& shard : shards)
+		Wake(*shard);
+
+	//Wait for them, associations are released with the shards
+	for (auto& shard : shards)
+		shard->thread.join();
+}
+
+void Runtime::Create(Key key, const Task& setup)
+{
+	Message message;
+	message.type	= Message::Create;
+	message.key	= key;
+	message.task	= setup;
+	Push(*shards[GetHome(key)],std::move(message));
+}
+
+void Runtime::Remove(Key key)
+{
+	Message message;
+	message.type	= Message::Remove;
+	message.key	= key;
+	Push(*shards[GetHome(key)],std::move(message));
+}
+
+void Runtime::WritePacket(Key key, const uint8_t *data, uint32_t size)
+{
+	Message message;
+	message.type	= Message::Packet;
+	message.key	= key;
+	message.packet.SetData(data,size);
+	Push(*shards[GetHome(key)],std::move(message));
+}
+
+void Runtime::Post(Key key, const Task& task)
+{
+	Message message;
+	message.type	= Message::Run;
+	message.key	= key;
+	message.task	= task;
+	Push(*shards[GetHome(key)],std::move(message));
+}
+
+std::vector<Runtime::Stats> Runtime::GetStats() const
+{
+	std::vector<Stats> stats(shards.size());
+
+	//Snapshot of each worker
+	for (size_t i=0; i<shards.size(); ++i)
+	{
+		stats[i].associations	= shards[i]->associations;
+		stats[i].packetsRead	= shards[i]->packetsRead;
+		stats[i].packetsWritten	= shards[i]->packetsWritten;
+		stats[i].given		= shards[i]->given;
+		stats[i].stolen		= shards[i]->stolen;
+		stats[i].dropped	= shards[i]->dropped;
+	}
+
+	return stats;
+}
+
+size_t Runtime::GetHome(Key key) const
+{
+	//Mix bits so sequential keys are spread evenly
+	return ((key * 0x9E3779B97F4A7C15ull) >> 32) % shards.size();
+}
+
+std::chrono::milliseconds Runtime::GetNow() const
+{
+	//Same origin for all wheels, so timers keep their deadline when moved
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+}
+
+void Runtime::Push(Shard& shard, Message&& message)
+{
+	//Queue it without locking
+	shard.inbox.push(std::move(message));
+	//Only lock if it is waiting
+	Wake(shard);
+}
+
+void Runtime::Wake(Shard& shard)
+{
+	//If it is sleeping and nobody else has woken it up
+	if (shard.sleeping.load() && shard.sleeping.exchange(false))
+	{
+		//Lock so the signal is not lost if it has not started waiting yet
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.wakeup.notify_one();
+	}
+}
+
+void Runtime::Run(Shard& shard)
+{
+	uint8_t data[Association::MaxPacketSize];
+
+	//Until stopped
+	while (!stopping)
+	{
+		size_t handled = 0;
+
+		//Fire expired timers
+		shard.wheel.SetNow(GetNow());
+
+		//Process all messages received
+		Message message;
+		while (shard.inbox.pop(message))
+			handled += Process(shard,message);
+
+		//Send all pending packets
+		size_t sent = shard.manager.ReadPackets(data,sizeof(data),send);
+		shard.packetsRead += sent;
+		handled += sent;
+
+		//Publish load for idle workers
+		shard.load.store(handled,std::memory_order_relaxed);
+
+		//If we are busy
+		if (handled)
+			//Keep going
+			continue;
+
+		//Try to get work from others
+		Steal(shard);
+
+		//Wait until next timer, but check for work to steal from time to time
+		auto timeout = StealInterval;
+		if (auto next = shard.wheel.GetNextTimeout())
+			timeout = std::min(timeout,*next);
+
+		//Tell producers we are going to sleep, and check nothing was pushed before
+		shard.sleeping = true;
+		if (!shard.inbox.empty() || shard.manager.HasPendingData() || stopping)
+		{
+			shard.sleeping = false;
+			continue;
+		}
+
+		//Wait until woken up or timeout
+		std::unique_lock<std::mutex> lock(shard.mutex);
+		shard.wakeup.wait_for(lock,timeout,[&](){ return !shard.sleeping.load(); });
+		shard.sleeping = false;
+	}
+}
+
+size_t Runtime::Process(Shard& shard, Message& message)
+{
+	//Depending on the type
+	switch (message.type)
+	{
+		case Message::Steal:
+			//Give one of ours
+			Give(shard,message.shard);
+			return 0;
+		case Message::Adopt:
+			//Take the given one, if any
+			Adopt(shard,message);
+			return 0;
+		case Message::Route:
+			//Update location
+			Route(shard,message);
+			return 0;
+		default:
+			//Message for an association
+			return Dispatch(shard,message);
+	}
+}
+
+size_t Runtime::Dispatch(Shard& shard, Message& message)
+{
+	size_t home = GetHome(message.key);
+
+	//Create them on its home shard only
+	if (message.type==Message::Create)
+	{
+		//Check it does not exist yet
+		if (shard.locations.count(message.key))
+			//Ignore
+			return 0;
+
+		//Create clock and association with it
+		Hosted hosted;
+		hosted.clock		= std::make_unique<Clock>(shard.wheel);
+		hosted.association	= Association::Create(*hosted.clock);
+
+		//Manage it
+		Association* association = shard.manager.Adopt(message.key,hosted.association);
+		shard.hosted.emplace(message.key,std::move(hosted));
+		shard.locations[message.key] = Location{shard.index,0};
+		shard.associations++;
+
+		//Set it up
+		if (message.task)
+			message.task(*association);
+		return 1;
+	}
+
+	//If we own it
+	if (Association* association = shard.manager.Get(message.key))
+	{
+		//Depending on the type
+		switch (message.type)
+		{
+			case Message::Packet:
+				//Process it
+				shard.manager.WritePacket(message.key,message.packet.GetData(),message.packet.GetSize());
+				shard.packetsWritten++;
+				break;
+			case Message::Run:
+				//Run it
+				message.task(*association);
+				break;
+			case Message::Remove:
+				//Drop it, association before its clock
+				shard.manager.Remove(message.key);
+				shard.hosted.erase(message.key);
+				shard.locations.erase(message.key);
+				shard.associations--;
+				break;
+			default:
+				break;
+		}
+		return 1;
+	}
+
+	//If we are its home shard
+	if (home==shard.index)
+	{
+		//Find where it is
+		auto it = shard.locations.find(message.key);
+
+		//If it does not exist
+		if (it==shard.locations.end())
+		{
+			//Drop it
+			shard.dropped++;
+			return 0;
+		}
+
+		//If we think it is ours but it is still moving back to us
+		if (it->second.shard==shard.index)
+		{
+			//Requeue it, so it is run after the association is adopted
+			Retry(shard,home,message);
+			return 0;
+		}
+
+		//Get owner
+		size_t owner = it->second.shard;
+
+		//Forget it once removed
+		if (message.type==Message::Remove)
+			shard.locations.erase(it);
+
+		//Forward it
+		Push(*shards[owner],std::move(message));
+		return 0;
+	}
+
+	//It has been moved since the home shard forwarded it, so send it back
+	Retry(shard,home,message);
+
+	//Done
+	return 0;
+}
+
+void Runtime::Retry(Shard& shard, size_t home, Message& message)
+{
+	//If it has not bounced too many times
+	if (++message.hops<=MaxHops)
+		//Send it to the home shard again
+		Push(*shards[home],std::move(message));
+	else
+		//Drop it
+		shard.dropped++;
+}
+
+void Runtime::Steal(Shard& shard)
+{
+	//If we are already waiting for one or there is nobody to steal from
+	if (shard.stealing || shards.size()<2)
+		//Nothing to do
+		return;
+
+	//Find the busiest worker with more than one association
+	Shard* victim = nullptr;
+	size_t max = StealThreshold - 1;
+	for (auto& other : shards)
+	{
+		size_t load = other->load.load(std::memory_order_relaxed);
+		if (other.get()!=&shard && load>max && other->associations>1)
+		{
+			victim = other.get();
+			max = load;
+		}
+	}
+
+	//If all are idle
+	if (!victim)
+		//Nothing to do
+		return;
+
+	//Ask for one
+	Message message;
+	message.type	= Message::Steal;
+	message.shard	= shard.index;
+	Push(*victim,std::move(message));
+
+	//Don't ask again until answered
+	shard.stealing = true;
+}
+
+void Runtime::Give(Shard& shard, size_t thief)
+{
+	Message message;
+	message.type = Message::Adopt;
+
+	//Get one with pending data, but keep at least one for us
+	auto key = shard.manager.GetCount()>1 ? shard.manager.GetReady() : std::nullopt;
+
+	//If we have one to give
+	if (key)
+	{
+		//Stop managing it
+		auto it = shard.hosted.find(*key);
+		message.key	= *key;
+		message.hosted	= std::move(it->second);
+		shard.hosted.erase(it);
+		shard.manager.Release(*key);
+		shard.associations--;
+		shard.given++;
+
+		//Remove its timers from our wheel
+		message.hosted.clock->Detach();
+		message.hosted.moves++;
+
+		//Update its location
+		size_t home = GetHome(*key);
+		if (home==shard.index)
+		{
+			//We are its home
+			shard.locations[*key] = Location{thief,message.hosted.moves};
+		} else if (home!=thief) {
+			//Tell its home
+			Message route;
+			route.type	= Message::Route;
+			route.key	= *key;
+			route.shard	= thief;
+			route.moves	= message.hosted.moves;
+			Push(*shards[home],std::move(route));
+		}
+	}
+
+	//Send it, or nothing so it can ask again
+	Push(*shards[thief],std::move(message));
+}
+
+void Runtime::Adopt(Shard& shard, Message& message)
+{
+	//Answered
+	shard.stealing = false;
+
+	//If steal was refused
+	if (!message.hosted.association)
+		//Nothing to do
+		return;
+
+	//If we are its home
+	if (GetHome(message.key)==shard.index)
+	{
+		//Find it
+		auto it = shard.locations.find(message.key);
+		//If it was removed while moving
+		if (it==shard.locations.end())
+			//Drop it
+			return;
+		//It is ours again
+		it->second = Location{shard.index,message.hosted.moves};
+	}
+
+	//Arm its timers on our wheel
+	message.hosted.clock->Attach(shard.wheel);
+
+	//Manage it
+	shard.manager.Adopt(message.key,message.hosted.association);
+	shard.hosted.emplace(message.key,std::move(message.hosted));
+	shard.associations++;
+	shard.stolen++;
+}
+
+void Runtime::Route(Shard& shard, Message& message)
+{
+	//Find it
+	auto it = shard.locations.find(message.key);
+
+	//If it was removed while moving
+	if (it==shard.locations.end())
+	{
+		//Remove it from its new owner
+		Message remove;
+		remove.type	= Message::Remove;
+		remove.key	= message.key;
+		Push(*shards[message.shard],std::move(remove));
+		return;
+	}
+
+	//Update it unless it has been moved again and we already know it
+	if (message.moves>it->second.moves)
+		it->second = Location{message.shard,message.moves};
+}
+
+}; // namespace sctp
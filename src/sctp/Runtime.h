@@ -0,0 +1,221 @@
+#ifndef SCTP_RUNTIME_H_
+#define SCTP_RUNTIME_H_
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Datachannels.h"
+#include "Buffer.h"
+#include "MpscQueue.h"
+#include "TimerWheel.h"
+#include "sctp/Association.h"
+#include "sctp/AssociationManager.h"
+
+namespace sctp
+{
+
+// Spreads associations across worker threads
+//	Each worker owns a shard with its own timer wheel, association manager
+//	and lock free inbox, so associations are only touched by the thread of
+//	their shard and the packet path takes no locks. Packets, tasks and
+//	control messages for a key are pushed to the inbox of its home shard,
+//	chosen by hashing the key, which runs them or forwards them to the
+//	shard the association has been moved to.
+//	Idle workers ask the busiest shard for one of its associations with
+//	pending data. The owner hands it over from its own thread, detaching its
+//	timers from its wheel so the thief can arm them again on its own one.
+//	Packets are copied to the inbox and may be reordered while an
+//	association is being moved, which SCTP already tolerates.
+class Runtime
+{
+public:
+	using Key = AssociationManager::Key;
+	using Task = std::function<void(Association&)>;
+	//Called on the worker thread owning the association
+	using Send = std::function<void(Key,const uint8_t*,size_t)>;
+
+	// Idle workers look for associations to steal at least this often
+	static constexpr const std::chrono::milliseconds StealInterval	= std::chrono::milliseconds(5);
+	// Minimum packets handled by a worker on its last run to steal from it
+	static constexpr const size_t StealThreshold			= 2;
+	// Messages for a moved association are sent back to its home shard at most this times
+	static constexpr const uint8_t MaxHops				= 4;
+
+	struct Stats
+	{
+		size_t associations	= 0;
+		uint64_t packetsRead	= 0;
+		uint64_t packetsWritten	= 0;
+		// Associations handed to and taken from other workers
+		uint64_t given		= 0;
+		uint64_t stolen		= 0;
+		// Messages for associations that don't exist or couldn't be reached after MaxHops
+		uint64_t dropped	= 0;
+	};
+private:
+	// Time service of an association, forwarding to the wheel of the shard owning it
+	//	Timers keep their deadline so they can be armed again on another wheel.
+	class Clock : public datachannels::TimeService
+	{
+	public:
+		class Timer : public datachannels::Timer, public std::enable_shared_from_this<Timer>
+		{
+		public:
+			Timer(Clock& clock, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> callback);
+
+			virtual void Cancel() override;
+			virtual void Again(const std::chrono::milliseconds& ms) override;
+			virtual std::chrono::milliseconds GetRepeat() const override { return repeat; }
+		private:
+			friend class Clock;
+			void Attach(datachannels::TimerWheel& wheel);
+			void Detach();
+			void Fire(std::chrono::milliseconds now);
+		private:
+			Clock& clock;
+			std::chrono::milliseconds repeat;
+			std::function<void(std::chrono::milliseconds)> callback;
+			//Timer on the current wheel, null while moving
+			datachannels::Timer::shared timer;
+			std::optional<std::chrono::milliseconds> deadline;
+		};
+	public:
+		Clock(datachannels::TimerWheel& wheel) : wheel(&wheel) {}
+
+		// Remove timers from the current wheel, must be called from its thread
+		void Detach();
+		// Arm timers on the new wheel, must be called from its thread
+		void Attach(datachannels::TimerWheel& wheel);
+
+		virtual const std::chrono::milliseconds GetNow() const override;
+		virtual datachannels::Timer::shared CreateTimer(std::function<void(std::chrono::milliseconds)> callback) override;
+		virtual datachannels::Timer::shared CreateTimer(const std::chrono::milliseconds& ms, std::function<void(std::chrono::milliseconds)> timeout) override;
+		virtual datachannels::Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, std::function<void(std::chrono::milliseconds)> timeout) override;
+	private:
+		//Null while moving
+		datachannels::TimerWheel* wheel;
+		std::chrono::milliseconds detached;
+		std::vector<std::weak_ptr<Timer>> timers;
+	};
+
+	// Association with the clock it was created with, moved together between shards
+	struct Hosted
+	{
+		//Declared first so it outlives the association timers
+		std::unique_ptr<Clock> clock;
+		std::shared_ptr<Association> association;
+		//Times it has been moved, so routes are only updated with newer locations
+		uint64_t moves = 0;
+	};
+
+	// Shard owning an association, kept by its home shard
+	struct Location
+	{
+		size_t shard	= 0;
+		uint64_t moves	= 0;
+	};
+
+	struct Message
+	{
+		enum Type
+		{
+			None,
+			Packet,		// Inbound packet for key
+			Create,		// Create association for key and run task on it
+			Remove,		// Remove association for key
+			Run,		// Run task on the association for key
+			Steal,		// Shard asks for an association
+			Adopt,		// Association given to this shard, empty if the steal was refused
+			Route		// Association for key is now owned by shard
+		};
+		Type type	= None;
+		Key key		= 0;
+		size_t shard	= 0;
+		uint64_t moves	= 0;
+		//Times it has been sent back to the home shard or requeued on it, dropped after MaxHops
+		uint8_t hops	= 0;
+		Buffer packet;
+		Task task;
+		Hosted hosted;
+	};
+
+	struct Shard
+	{
+		Shard(size_t index, std::chrono::milliseconds now);
+
+		size_t index;
+		//Declared before the associations so it outlives their timers
+		datachannels::TimerWheel wheel;
+		//Owned associations, the manager holds another reference
+		std::unordered_map<Key,Hosted> hosted;
+		AssociationManager manager;
+		MpscQueue<Message> inbox;
+		//Location of the associations with this home shard
+		std::unordered_map<Key,Location> locations;
+		//Steal request sent and not answered yet
+		bool stealing = false;
+		//Packets handled on last run, read by idle workers to choose whom to steal from
+		std::atomic<size_t> load{0};
+		//Waiting for messages or timers, producers only lock to wake it up
+		std::atomic<bool> sleeping{false};
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::atomic<size_t> associations{0};
+		std::atomic<uint64_t> packetsRead{0};
+		std::atomic<uint64_t> packetsWritten{0};
+		std::atomic<uint64_t> given{0};
+		std::atomic<uint64_t> stolen{0};
+		std::atomic<uint64_t> dropped{0};
+		std::thread thread;
+	};
+public:
+	// Start workers, the hardware concurrency if none, send is called from them
+	Runtime(const Send& send, size_t workers = 0);
+	~Runtime();
+
+	//Not copiable, workers point to us
+	Runtime(const Runtime&) = delete;
+	Runtime& operator=(const Runtime&) = delete;
+
+	// All can be called from any thread
+
+	// Create association for the embedder connection key, setup is run on its worker
+	void Create(Key key, const Task& setup);
+	void Remove(Key key);
+	// Copy packet and pass it to the association on its worker
+	void WritePacket(Key key, const uint8_t *data, uint32_t size);
+	// Run task on the association worker, dropped if it does not exist
+	void Post(Key key, const Task& task);
+
+	size_t GetWorkers() const	{ return shards.size();	}
+	std::vector<Stats> GetStats() const;
+private:
+	size_t GetHome(Key key) const;
+	void Push(Shard& shard, Message&& message);
+	void Run(Shard& shard);
+	void Wake(Shard& shard);
+	size_t Process(Shard& shard, Message& message);
+	size_t Dispatch(Shard& shard, Message& message);
+	void Steal(Shard& shard);
+	void Give(Shard& shard, size_t thief);
+	void Adopt(Shard& shard, Message& message);
+	void Route(Shard& shard, Message& message);
+	void Retry(Shard& shard, size_t home, Message& message);
+	std::chrono::milliseconds GetNow() const;
+private:
+	Send send;
+	std::chrono::steady_clock::time_point start;
+	std::atomic<bool> stopping{false};
+	std::vector<std::unique_ptr<Shard>> shards;
+};
+
+}; // namespace sctp
+#endif
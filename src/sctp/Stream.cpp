@@ -1,4 +1,5 @@
 #include "sctp/Stream.h"
+#include "sctp/Association.h"
 
 namespace sctp
 {
@@ -13,20 +14,125 @@ Stream::~Stream()
 {
 }
 
-bool Stream::Recv(const uint8_t ppid, const uint8_t* buffer, const size_t size) //first,last?
+bool Stream::Recv(const uint32_t ppid, const uint8_t* buffer, const size_t size, bool first, bool last)
 {
-	//onMessage(ppid,buff)
+	//If it is a complete message and we are not reassembling another one
+	if (first && last && !reassembling)
+	{
+		//Deliver directly without copying
+		Deliver(ppid,buffer,size);
+		//Done
+		return true;
+	}
+	
+	//If it is the begining of a new message
+	if (first)
+	{
+		//Drop any incomplete one
+		incomingMessage.Reset();
+		//We are reassembling now
+		reassembling = true;
+	}
+	//If we have not received the first fragment
+	else if (!reassembling)
+		//Error
+		return false;
+	
+	//Append fragment
+	incomingMessage.AppendData(buffer,size);
+	
+	//If it is not the last one
+	if (!last)
+		//Wait for more
+		return true;
+	
+	//Message completed
+	reassembling = false;
+	
+	//Deliver it
+	Deliver(ppid,incomingMessage.GetData(),incomingMessage.GetSize());
+	
+	//Reuse buffer for next message, unless it was taken
+	incomingMessage.Reset();
+	
+	//Done
 	return true;
 }
 
-bool Stream::Send(const uint8_t ppid, const uint8_t* buffer, const size_t size)
+void Stream::Deliver(const uint32_t ppid, const uint8_t* buffer, const size_t size)
+{
+	//Launch stream event
+	if (onMessage)
+		onMessage(ppid,buffer,size);
+	//And the association wide one
+	if (association.onMessage)
+		association.onMessage(*this,ppid,buffer,size);
+}
+
+void Stream::Reserve(size_t size)
+{
+	//A new message starts from the begining of the buffer
+	size_t needed = (reassembling ? incomingMessage.GetSize() : 0) + size;
+	//If it doesn't fit
+	if (needed>incomingMessage.GetCapacity())
+		//Grow it keeping the fragments already received
+		incomingMessage.Alloc(needed);
+}
+
+Buffer Stream::TakeMessage(const uint8_t* buffer, const size_t size)
+{
+	//If it is the reassembled one
+	if (buffer==incomingMessage.GetData() && size==incomingMessage.GetSize())
+		//Move it, next one will allocate a new one
+		return std::move(incomingMessage);
+	//It points to the received packet, copy it
+	return Buffer(buffer,size);
+}
+
+bool Stream::Send(const uint32_t ppid, const uint8_t* buffer, const size_t size, bool unordered)
+{
+	//SCTP does not support the sending of empty user messages
+	if (!buffer || !size)
+		//Error
+		return false;
+	
+	//Copy it
+	return Send(ppid,std::make_shared<Buffer>(buffer,size),unordered);
+}
+
+bool Stream::Send(const uint32_t ppid, const datachannels::Payload& payload, bool unordered)
 {
+	//SCTP does not support the sending of empty user messages
+	if (!payload || payload->IsEmpty())
+		//Error
+		return false;
+	
+	//rfc4960#section-9.2
+	//	Upon receipt of the SHUTDOWN primitive from its upper layer, the
+	//	endpoint enters the SHUTDOWN-PENDING state and remains there until
+	//	all outstanding data has been acknowledged by its peer.  The endpoint
+	//	accepts no new data from its upper layer, but retransmits data to the
+	//	far end if necessary to fill gaps.
+	if (!association.IsAcceptingMessages())
+		//Error
+		return false;
+	
 	//TODO: check max queue size?
 	
 	//Add new message to ougogin queue
-	outgoingMessages.push_back(std::make_pair<>(ppid,Buffer(buffer,size)));
+	auto& message = outgoingMessages.emplace_back();
+	
+	//Set message data
+	message.payloadProtocolIdentifier	= ppid;
+	message.unordered			= unordered;
+	message.payload				= payload;
+	
+	//Pending to be sent
+	queuedBytes += payload->GetSize();
+	association.queuedBytes += payload->GetSize();
 	
-	//TODO: signal pending data
+	//Signal pending data
+	association.Enqueue(*this);
 	
 	//done
 	return true;
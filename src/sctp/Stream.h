@@ -3,10 +3,10 @@
 
 #include "Datachannels.h"
 
-#include <list>
 #include <memory>
 
 #include "Buffer.h"
+#include "CircularQueue.h"
 
 
 namespace sctp
@@ -16,30 +16,60 @@ class Association;
 	
 class Stream
 {
-public:
-	using shared = std::shared_ptr<Stream>;
+private:
+	struct Message
+	{
+		uint32_t payloadProtocolIdentifier	= 0;
+		bool unordered				= false;
+		uint16_t streamSequenceNumber		= 0;
+		//Bytes of the payload already sent in DATA chunks
+		size_t offset				= 0;
+		datachannels::Payload payload;
+	};
 public:
 	Stream(Association &association, uint16_t id);
 	virtual ~Stream();
 	
-	bool Recv(const uint8_t ppid, const uint8_t* buffer, const size_t size);
-	bool Send(const uint8_t ppid, const uint8_t* buffer, const size_t size);
+	//Not copiable, streams live in the association stream table
+	Stream(const Stream&) = delete;
+	Stream& operator=(const Stream&) = delete;
+	
+	bool Recv(const uint32_t ppid, const uint8_t* buffer, const size_t size, bool first = true, bool last = true);
+	bool Send(const uint32_t ppid, const uint8_t* buffer, const size_t size, bool unordered = false);
+	bool Send(const uint32_t ppid, const datachannels::Payload& payload, bool unordered = false);
 	
-	uint16_t GetId() const { return id; }
+	// Ensure the message being reassembled can grow this much without reallocating
+	void Reserve(size_t size);
+	// Get ownership of the message being delivered, without copying it if it was reassembled
+	Buffer TakeMessage(const uint8_t* buffer, const size_t size);
+	
+	uint16_t GetId() const			{ return id;				}
+	bool HasPendingMessages() const		{ return !outgoingMessages.empty();	}
+	// User data not yet sent in any DATA chunk
+	size_t GetQueuedBytes() const		{ return queuedBytes;			}
 	
 	// Event handlers
-	void OnMessage(std::function<void(uint8_t, const uint8_t*,uint64_t)> callback)
+	void OnMessage(std::function<void(uint32_t, const uint8_t*,uint64_t)> callback)
 	{
 		//Store callback
 		onMessage = callback;
 	}
 private:
+	void Deliver(const uint32_t ppid, const uint8_t* buffer, const size_t size);
+private:
+	// Association fragments the outgoing messages into DATA chunks
+	friend class Association;
+	
 	uint16_t id;
 	Association &association;
-	std::list<std::pair<uint8_t,Buffer>> outgoingMessages;
+	CircularQueue<Message> outgoingMessages;
+	uint16_t nextStreamSequenceNumber = 0;
+	size_t queuedBytes = 0;
+	bool queued = false;
 	Buffer incomingMessage;
+	bool reassembling = false;
 	
-	std::function<void(uint8_t, const uint8_t*,uint64_t)> onMessage;
+	std::function<void(uint32_t, const uint8_t*,uint64_t)> onMessage;
 };
 
 }; // namespace
@@ -74,9 +74,11 @@ Chunk::shared HeartbeatAckChunk::Parse(BufferReader& reader)
 	//Read parameters
 	while (reader.GetLeft()>=4)
 	{
-		//Get parameter type
-		uint16_t paramType = reader.Get2();
-		uint16_t paramLength = reader.Get2();
+		//Get parameter type and length, the loop condition already checked they are there
+		BufferReader::Window param;
+		reader.GetWindow(4,param);
+		uint16_t paramType = param.Get2();
+		uint16_t paramLength = param.Get2();
 		//Ensure lenghth is correct as it has to contain the type and length itself
 		if (paramLength<4)
 			return nullptr;
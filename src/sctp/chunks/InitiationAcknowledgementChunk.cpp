@@ -14,25 +14,27 @@ size_t InitiationAcknowledgementChunk::GetSize() const
 
 size_t InitiationAcknowledgementChunk::Serialize(BufferWritter& writter) const
 {
-	//Check header length
-	if (!writter.Assert(20))
-		return 0;
-	
 	//Get init pos
 	size_t ini = writter.Mark();
 	
+	//Check header length once
+	BufferWritter::Window window;
+	if (!writter.GetWindow(20,window))
+		return 0;
+	
 	//Write header
-	writter.Set1(type);
-	writter.Set1(flag);
+	window.Set1(type);
+	window.Set1(flag);
 	//Skip length position
-	size_t mark = writter.Skip(2);
+	size_t mark = ini+2;
+	window.Consume(2);
 	
 	//Set attributes
-	writter.Set4(initiateTag);
-	writter.Set4(advertisedReceiverWindowCredit);
-	writter.Set2(numberOfOutboundStreams);
-	writter.Set2(numberOfInboundStreams);
-	writter.Set4(initialTransmissionSequenceNumber);
+	window.Set4(initiateTag);
+	window.Set4(advertisedReceiverWindowCredit);
+	window.Set2(numberOfOutboundStreams);
+	window.Set2(numberOfInboundStreams);
+	window.Set4(initialTransmissionSequenceNumber);
 	
 	//Cookie param
 	{
@@ -172,16 +174,18 @@ size_t InitiationAcknowledgementChunk::Serialize(BufferWritter& writter) const
 	
 Chunk::shared InitiationAcknowledgementChunk::Parse(BufferReader& reader)
 {
-	//Check size
-	if (!reader.Assert(20)) 
+	//Get header
+	size_t mark	= reader.Mark();
+	
+	//Check size once
+	BufferReader::Window window;
+	if (!reader.GetWindow(20,window)) 
 		//Error
 		return nullptr;
 	
-	//Get header
-	size_t mark	= reader.Mark();
-	uint8_t type	= reader.Get1();
-	uint8_t flag	= reader.Get1(); //Ignored, should be 0
-	uint16_t length	= reader.Get2();
+	uint8_t type	= window.Get1();
+	uint8_t flag	= window.Get1(); //Ignored, should be 0
+	uint16_t length	= window.Get2();
 	
 	//Check type
 	if (type!=Type::INIT_ACK)
@@ -192,19 +196,21 @@ Chunk::shared InitiationAcknowledgementChunk::Parse(BufferReader& reader)
 	auto ack = std::make_shared<InitiationAcknowledgementChunk>();
 	
 	//Set attributes
-	ack->initiateTag			= reader.Get4();
-	ack->advertisedReceiverWindowCredit	= reader.Get4();
-	ack->numberOfOutboundStreams		= reader.Get2();
-	ack->numberOfInboundStreams		= reader.Get2();
-	ack->initialTransmissionSequenceNumber	= reader.Get4();
+	ack->initiateTag			= window.Get4();
+	ack->advertisedReceiverWindowCredit	= window.Get4();
+	ack->numberOfOutboundStreams		= window.Get2();
+	ack->numberOfInboundStreams		= window.Get2();
+	ack->initialTransmissionSequenceNumber	= window.Get4();
 	ack->forwardTSNSupported		= false;
 	
 	//Read parameters
 	while (reader.GetLeft()>=4)
 	{
-		//Get parameter type
-		uint16_t paramType = reader.Get2();
-		uint16_t paramLength = reader.Get2();
+		//Get parameter type and length, the loop condition already checked they are there
+		BufferReader::Window param;
+		reader.GetWindow(4,param);
+		uint16_t paramType = param.Get2();
+		uint16_t paramLength = param.Get2();
 		//Ensure lenghth is correct as it has to contain the type and length itself
 		if (paramLength<4)
 			return nullptr;
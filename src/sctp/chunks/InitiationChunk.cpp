@@ -26,25 +26,27 @@ size_t InitiationChunk::GetSize() const
 
 size_t InitiationChunk::Serialize(BufferWritter& writter) const
 {
-	//Check header length
-	if (!writter.Assert(20))
-		return 0;
-	
 	//Get init pos
 	size_t ini = writter.Mark();
 	
+	//Check header length once
+	BufferWritter::Window window;
+	if (!writter.GetWindow(20,window))
+		return 0;
+	
 	//Write header
-	writter.Set1(type);
-	writter.Set1(flag);
+	window.Set1(type);
+	window.Set1(flag);
 	//Skip length position
-	size_t mark = writter.Skip(2);
+	size_t mark = ini+2;
+	window.Consume(2);
 	
 	//Set attributes
-	writter.Set4(initiateTag);
-	writter.Set4(advertisedReceiverWindowCredit);
-	writter.Set2(numberOfOutboundStreams);
-	writter.Set2(numberOfInboundStreams);
-	writter.Set4(initialTransmissionSequenceNumber);
+	window.Set4(initiateTag);
+	window.Set4(advertisedReceiverWindowCredit);
+	window.Set2(numberOfOutboundStreams);
+	window.Set2(numberOfInboundStreams);
+	window.Set4(initialTransmissionSequenceNumber);
 	
 	//IPV4 addresses
 	for (const auto& ipV4Address : ipV4Addresses)
@@ -186,16 +188,18 @@ size_t InitiationChunk::Serialize(BufferWritter& writter) const
 	
 Chunk::shared InitiationChunk::Parse(BufferReader& reader)
 {
-	//Check size
-	if (!reader.Assert(20)) 
+	//Get header
+	size_t mark	= reader.Mark();
+	
+	//Check size once
+	BufferReader::Window window;
+	if (!reader.GetWindow(20,window)) 
 		//Error
 		return nullptr;
 	
-	//Get header
-	size_t mark	= reader.Mark();
-	uint8_t type	= reader.Get1();
-	uint8_t flag	= reader.Get1(); //Ignored, should be 0
-	uint16_t length	= reader.Get2();
+	uint8_t type	= window.Get1();
+	uint8_t flag	= window.Get1(); //Ignored, should be 0
+	uint16_t length	= window.Get2();
 	
 	//Check type
 	if (type!=Type::INIT)
@@ -206,19 +210,21 @@ Chunk::shared InitiationChunk::Parse(BufferReader& reader)
 	auto init = std::make_shared<InitiationChunk>();
 		
 	//Set attributes
-	init->initiateTag			= reader.Get4();
-	init->advertisedReceiverWindowCredit	= reader.Get4();
-	init->numberOfOutboundStreams		= reader.Get2();
-	init->numberOfInboundStreams		= reader.Get2();
-	init->initialTransmissionSequenceNumber = reader.Get4();
+	init->initiateTag			= window.Get4();
+	init->advertisedReceiverWindowCredit	= window.Get4();
+	init->numberOfOutboundStreams		= window.Get2();
+	init->numberOfInboundStreams		= window.Get2();
+	init->initialTransmissionSequenceNumber = window.Get4();
 	init->forwardTSNSupported		= false;
 	
 	//Read parameters
 	while (reader.GetLeft()>=4)
 	{
-		//Get parameter type
-		uint16_t paramType = reader.Get2();
-		uint16_t paramLength = reader.Get2();
+		//Get parameter type and length, the loop condition already checked they are there
+		BufferReader::Window param;
+		reader.GetWindow(4,param);
+		uint16_t paramType = param.Get2();
+		uint16_t paramLength = param.Get2();
 		//Ensure lenghth is correct as it has to contain the type and length itself
 		if (paramLength<4)
 			return nullptr;
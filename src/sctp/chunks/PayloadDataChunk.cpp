@@ -6,95 +6,126 @@ namespace sctp
 size_t PayloadDataChunk::GetSize() const
 {
 	//Header + attributes + user data
-	return SizePad(4,16+userData.GetSize());
+	return SizePad(16+userData.GetSize(),4);
 }
 
 size_t PayloadDataChunk::Serialize(BufferWritter& writter) const
 {
-	//Check header length
-	if (!writter.Assert(16))
-		return 0;
-	
-	//Get init pos
-	size_t ini = writter.Mark();
-	
 	//Creage flag
-	uint8_t flag = (unordered & 0x04) | (beginingFragment & 0x02) | (endingFragment & 0x01);
+	uint8_t flag = (unordered ? Flag::Unordered : 0) | (beginingFragment ? Flag::BeginingFragment : 0) | (endingFragment ? Flag::EndingFragment : 0);
 	
+	//Serialize with our own user data
+	return Serialize(writter,flag,transmissionSequenceNumber,streamIdentifier,streamSequenceNumber,payloadProtocolIdentifier,userData.GetData(),userData.GetSize());
+}
+
+size_t PayloadDataChunk::Serialize(BufferWritter& writter, uint8_t flag, uint32_t transmissionSequenceNumber, uint16_t streamIdentifier, uint16_t streamSequenceNumber, uint32_t payloadProtocolIdentifier, const uint8_t* userData, size_t userDataSize)
+{
 	//Write header
-	writter.Set1(type);
-	writter.Set1(flag);
-	//Skip length position
-	size_t mark = writter.Skip(2);
-	
-	//Set attributes
-	writter.Set4(transmissionSequenceNumber);
-	writter.Set2(streamIdentifier);
-	writter.Set2(streamSequenceNumber);
-	writter.Set4(payloadProtocolIdentifier);
+	if (!SerializeHeader(writter,flag,transmissionSequenceNumber,streamIdentifier,streamSequenceNumber,payloadProtocolIdentifier,userDataSize))
+		return 0;
 
 	//Check user data size
-	if (!writter.Assert(userData.GetSize()))
+	if (!writter.Assert(userDataSize))
 		return 0;
 	
-	//Write cooke
-	writter.Set(userData);
-	
-	///Get length
-	size_t length = writter.GetOffset(ini);
-	//Set it
-	writter.Set2(mark,length);
+	//Write user data
+	memcpy(writter.Consume(userDataSize),userData,userDataSize);
 	
 	//Pad
 	return writter.PadTo(4);
 }
+
+size_t PayloadDataChunk::SerializeHeader(BufferWritter& writter, uint8_t flag, uint32_t transmissionSequenceNumber, uint16_t streamIdentifier, uint16_t streamSequenceNumber, uint32_t payloadProtocolIdentifier, size_t userDataSize)
+{
+	//Length includes the user data but not the padding
+	return HeaderLayout::Serialize(writter,
+		Type::PDATA,
+		flag,
+		HeaderSize+userDataSize,
+		transmissionSequenceNumber,
+		streamIdentifier,
+		streamSequenceNumber,
+		payloadProtocolIdentifier);
+}
 	
-Chunk::shared PayloadDataChunk::Parse(BufferReader& reader)
+bool PayloadDataChunk::Parse(BufferReader& reader, View& view)
 {
-	//Check size
-	if (!reader.Assert(16)) 
+	uint8_t type	= 0;
+	uint16_t length	= 0;
+	
+	//Get header and params
+	if (!HeaderLayout::Parse(reader,
+		type,
+		view.flag,
+		length,
+		view.transmissionSequenceNumber,
+		view.streamIdentifier,
+		view.streamSequenceNumber,
+		view.payloadProtocolIdentifier))
 		//Error
-		return nullptr;
+		return false;
 	
-	//Get header
-	size_t mark	= reader.Mark();
-	uint8_t type	= reader.Get1();
-	uint8_t flag	= reader.Get1(); 
-	uint16_t length	= reader.Get2();
-	
-	//Check type
-	if (type!=Type::PDATA)
+	//Check type and length
+	if (type!=Type::PDATA || length<HeaderSize)
 		//Error
-		return nullptr;
-		
-	//Create chunk
-	auto data = std::make_shared<PayloadDataChunk>();
-	
-	//Set flag bits
-	data->unordered		= flag & 0x04;
-	data->beginingFragment	= flag & 0x02;
-	data->beginingFragment	= flag & 0x01;
-	
-	//Read params
-	data->transmissionSequenceNumber = reader.Get4();
-	data->streamIdentifier		 = reader.Get2();
-	data->streamSequenceNumber	 = reader.Get2();
-	data->payloadProtocolIdentifier	 = reader.Get4();
+		return false;
 	
 	//Check size
-	if (!reader.Assert(length-16)) 
+	if (!reader.Assert(length-HeaderSize)) 
 		//Error
-		return nullptr;
+		return false;
 	
-	//Get user data
-	data->userData = reader.GetBuffer(length-16);
+	//Point to user data
+	view.userDataSize	= length-HeaderSize;
+	view.userData		= reader.GetData(view.userDataSize);
 	
 	//Pad input
 	if (!reader.PadTo(4))
-		return nullptr;
+		return false;
 	
 	//Done
-	return std::static_pointer_cast<Chunk>(data);
+	return true;
+}
+
+Chunk::shared PayloadDataChunk::Parse(BufferReader& reader)
+{
+	View view;
+	
+	//Parse in place
+	if (!Parse(reader,view))
+		//Error
+		return nullptr;
+	
+	//Create chunk copying the user data
+	return std::make_shared<PayloadDataChunk>(view);
+}
+
+PayloadDataChunk::PayloadDataChunk(const View& view) : 
+	Chunk(Chunk::PDATA),
+	userData(view.userData,view.userDataSize)
+{
+	//Set flag bits
+	unordered			= view.flag & Flag::Unordered;
+	beginingFragment		= view.flag & Flag::BeginingFragment;
+	endingFragment			= view.flag & Flag::EndingFragment;
+	//Set params
+	transmissionSequenceNumber	= view.transmissionSequenceNumber;
+	streamIdentifier		= view.streamIdentifier;
+	streamSequenceNumber		= view.streamSequenceNumber;
+	payloadProtocolIdentifier	= view.payloadProtocolIdentifier;
+}
+
+PayloadDataChunk::View PayloadDataChunk::GetView() const
+{
+	View view;
+	view.flag			= (unordered ? Flag::Unordered : 0) | (beginingFragment ? Flag::BeginingFragment : 0) | (endingFragment ? Flag::EndingFragment : 0);
+	view.transmissionSequenceNumber	= transmissionSequenceNumber;
+	view.streamIdentifier		= streamIdentifier;
+	view.streamSequenceNumber	= streamSequenceNumber;
+	view.payloadProtocolIdentifier	= payloadProtocolIdentifier;
+	view.userData			= userData.GetData();
+	view.userDataSize		= userData.GetSize();
+	return view;
 }
 	
 };
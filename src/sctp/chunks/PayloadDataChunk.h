@@ -11,14 +11,47 @@ namespace sctp
 	
 class PayloadDataChunk :  public Chunk
 {
+public:
+	//DATA chunk parsed in place, user data points into the received packet
+	struct View
+	{
+		uint8_t  flag				= 0;
+		uint32_t transmissionSequenceNumber	= 0;
+		uint16_t streamIdentifier		= 0;
+		uint16_t streamSequenceNumber		= 0;
+		uint32_t payloadProtocolIdentifier	= 0;
+		const uint8_t* userData			= nullptr;
+		size_t userDataSize			= 0;
+	};
 public:
 	PayloadDataChunk () : Chunk(Chunk::PDATA) {}
+	//Copy user data from a chunk parsed in place
+	PayloadDataChunk (const View& view);
 	virtual ~PayloadDataChunk() = default;
 	
 	virtual size_t Serialize(BufferWritter& buffer) const override;
 	virtual size_t GetSize() const override;
 
 	static Chunk::shared Parse(BufferReader& reader);
+	//Parse without allocating, view is only valid while the reader data is
+	static bool Parse(BufferReader& reader, View& view);
+	View GetView() const;
+	
+	//Serialize a DATA chunk whose user data is not owned by a chunk object
+	static size_t Serialize(BufferWritter& writter, uint8_t flag, uint32_t transmissionSequenceNumber, uint16_t streamIdentifier, uint16_t streamSequenceNumber, uint32_t payloadProtocolIdentifier, const uint8_t* userData, size_t userDataSize);
+	//Serialize only the header of a DATA chunk, user data and padding have to be written after it
+	static size_t SerializeHeader(BufferWritter& writter, uint8_t flag, uint32_t transmissionSequenceNumber, uint16_t streamIdentifier, uint16_t streamSequenceNumber, uint32_t payloadProtocolIdentifier, size_t userDataSize);
+	
+	// Type, flags, length, tsn, stream identifier, stream sequence number and payload protocol identifier
+	using HeaderLayout = FixedLayout<uint8_t,uint8_t,uint16_t,uint32_t,uint16_t,uint16_t,uint32_t>;
+	static constexpr const size_t HeaderSize = HeaderLayout::Size;
+	
+	enum Flag
+	{
+		Unordered		= 0x04,
+		BeginingFragment	= 0x02,
+		EndingFragment		= 0x01,
+	};
 public:
 	//        0                   1                   2                   3
 	//        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -6,7 +6,7 @@ namespace sctp
 size_t SelectiveAcknowledgementChunk::GetSize() const
 {
 	//Header + attributes
-	size_t size = 16 + gapAckBlocks.size()*4 + duplicateTuplicateTrasnmissionSequenceNumbers.size()*4;
+	size_t size = Layout::Size + gapAckBlocks.size()*4 + duplicateTuplicateTrasnmissionSequenceNumbers.size()*4;
 	
 	//Done
 	return size;
@@ -14,109 +14,111 @@ size_t SelectiveAcknowledgementChunk::GetSize() const
 
 size_t SelectiveAcknowledgementChunk::Serialize(BufferWritter& writter) const
 {
-	//Check header length
-	if (!writter.Assert(16))
-		return 0;
+	//Get length
+	size_t length = GetSize();
 	
-	//Get init pos
-	size_t ini = writter.Mark();
+	//Check it all fits
+	if (!writter.Assert(length))
+		return 0;
 	
-	//Write header
-	writter.Set1(type);
-	writter.Set1(0);
-	//Skip length position
-	size_t mark = writter.Skip(2);
+	//Write header and fixed attributes
+	Layout::Serialize(writter,
+		type,
+		0,
+		length,
+		cumulativeTrasnmissionSequenceNumberAck,
+		adveritsedReceiverWindowCredit,
+		gapAckBlocks.size(),
+		duplicateTuplicateTrasnmissionSequenceNumbers.size());
 	
-	//Set attributes
-	writter.Set4(cumulativeTrasnmissionSequenceNumberAck);
-	writter.Set4(adveritsedReceiverWindowCredit);
-	writter.Set2(gapAckBlocks.size());
-	writter.Set2(duplicateTuplicateTrasnmissionSequenceNumbers.size());
+	//Gaps and duplicates were already checked to fit
+	BufferWritter::Window window;
+	writter.GetWindow(length-Layout::Size,window);
 	
 	//For each gap
 	for (const auto& gap : gapAckBlocks)
 	{
-		//Check header length
-		if (!writter.Assert(4))
-			return 0;
 		///Write gap
-		writter.Set2(gap.first);
-		writter.Set2(gap.second);
+		window.Set2(gap.first);
+		window.Set2(gap.second);
 	}
 	
 	//For each duplicated tsn
 	for (const auto& duplicated : duplicateTuplicateTrasnmissionSequenceNumbers)
-	{
-		//Check header length
-		if (!writter.Assert(4))
-			return 0;
-		///Write gap
-		writter.Set4(duplicated);
-	}
-	
-	//Get length
-	size_t length = writter.GetOffset(ini);
-	//Set it
-	writter.Set2(mark,length);
+		///Write it
+		window.Set4(duplicated);
 	
 	//Done
 	return length;
 }
 	
-Chunk::shared SelectiveAcknowledgementChunk::Parse(BufferReader& reader)
+bool SelectiveAcknowledgementChunk::Parse(BufferReader& reader, SelectiveAcknowledgementChunk& sack)
 {
-	//Check size
-	if (!reader.Assert(16)) 
-		//Error
-		return nullptr;
-	
 	//Get header
-	size_t mark	= reader.Mark();
-	uint8_t type	= reader.Get1();
-	uint8_t flag	= reader.Get1(); //Ignored, should be 0
-	uint16_t length	= reader.Get2();
+	size_t mark			= reader.Mark();
+	uint8_t type			= 0;
+	uint8_t flag			= 0; //Ignored, should be 0
+	uint16_t length			= 0;
+	uint16_t numGapAckBlocks	= 0;
+	uint16_t numDuplicatedTSNs	= 0;
+	
+	//Read header and fixed attributes
+	if (!Layout::Parse(reader,
+		type,
+		flag,
+		length,
+		sack.cumulativeTrasnmissionSequenceNumberAck,
+		sack.adveritsedReceiverWindowCredit,
+		numGapAckBlocks,
+		numDuplicatedTSNs))
+		//Error
+		return false;
 	
 	//Check type
 	if (type!=Type::SACK)
 		//Error
-		return nullptr;
-		
-	//Create chunk
-	auto ack = std::make_shared<SelectiveAcknowledgementChunk>();
+		return false;
+	
+	//Check size of gaps and duplicates once
+	BufferReader::Window window;
+	if (!reader.GetWindow((numGapAckBlocks+numDuplicatedTSNs)*4,window)) 
+		//Error
+		return false;
 	
-	//Read params
-	ack->cumulativeTrasnmissionSequenceNumberAck	= reader.Get4();
-	ack->adveritsedReceiverWindowCredit		= reader.Get4();
-	const auto numGapAckBlocks			= reader.Get2();
-	const auto numDuplicatedTSNs			= reader.Get2();
+	//Clear previous ones but keep capacity
+	sack.gapAckBlocks.clear();
+	sack.duplicateTuplicateTrasnmissionSequenceNumbers.clear();
 	
 	//For each gap
 	for (size_t i=0;i<numGapAckBlocks;++i)
 	{
-		//Check size
-		if (!reader.Assert(4)) 
-			//Error
-			return nullptr;
 		//Read gap
-		ack->gapAckBlocks.push_back({
-			reader.Get2(),
-			reader.Get2()
-		});
+		uint16_t start = window.Get2();
+		uint16_t end = window.Get2();
+		sack.gapAckBlocks.emplace_back(start,end);
 	}
 	
 	//For each duplicated tsn
 	for (size_t i=0;i<numDuplicatedTSNs;++i)
-	{
-		//Check size
-		if (!reader.Assert(4)) 
-			//Error
-			return nullptr;
-		//Read gap
-		ack->duplicateTuplicateTrasnmissionSequenceNumbers.push_back(reader.Get4());
-	}
+		//Read it
+		sack.duplicateTuplicateTrasnmissionSequenceNumbers.push_back(window.Get4());
+	
+	//Check all the chunk length has been read
+	if (reader.GetOffset(mark)!=length) 
+		//Error
+		return false;
+	
+	//Done
+	return true;
+}
+
+Chunk::shared SelectiveAcknowledgementChunk::Parse(BufferReader& reader)
+{
+	//Create chunk
+	auto ack = std::make_shared<SelectiveAcknowledgementChunk>();
 	
-	//Check size
-	if (!reader.Assert(length-16)) 
+	//Parse into it
+	if (!Parse(reader,*ack))
 		//Error
 		return nullptr;
 		
@@ -20,6 +20,11 @@ public:
 	virtual size_t GetSize() const override;
 
 	static Chunk::shared Parse(BufferReader& reader);
+	//Parse reusing the gap and duplicate vectors of an existing chunk
+	static bool Parse(BufferReader& reader, SelectiveAcknowledgementChunk& sack);
+	
+	// Type, flags, length, cumulative tsn ack, a_rwnd, number of gap ack blocks and of duplicate tsns
+	using Layout = FixedLayout<uint8_t,uint8_t,uint16_t,uint32_t,uint32_t,uint16_t,uint16_t>;
 public:
 	//        0                   1                   2                   3
 	//        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
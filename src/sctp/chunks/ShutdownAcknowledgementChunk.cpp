@@ -5,50 +5,34 @@ namespace sctp
 	
 size_t ShutdownAcknowledgementChunk::GetSize() const
 {
-	//Header + attributes
-	size_t size = 20;
-	
-	//Done
-	return size;
+	//Header only
+	return HeaderLayout::Size;
 }
 
 size_t ShutdownAcknowledgementChunk::Serialize(BufferWritter& writter) const
 {
-	//Get init pos
-	size_t ini = writter.Mark();
-	
 	//Write header
-	writter.Set1(type);
-	writter.Set1(0);
-	//Skip length position
-	size_t mark = writter.Skip(2);
-	
-	
-	
-	//Get length
-	size_t length = writter.GetOffset(ini);
-	//Set it
-	writter.Set2(mark,length);
+	if (!HeaderLayout::Serialize(writter,type,0,HeaderLayout::Size))
+		//Error
+		return 0;
 	
 	//Done
-	return length;
+	return HeaderLayout::Size;
 }
 	
 Chunk::shared ShutdownAcknowledgementChunk::Parse(BufferReader& reader)
 {
-	//Check size
-	if (!reader.Assert(20)) 
-		//Error
-		return nullptr;
+	uint8_t type	= 0;
+	uint8_t flag	= 0;
+	uint16_t length	= 0;
 	
 	//Get header
-	size_t mark	= reader.Mark();
-	uint8_t type	= reader.Get1();
-	uint8_t flag	= reader.Get1(); //Ignored, should be 0
-	uint16_t length	= reader.Get2();
+	if (!HeaderLayout::Parse(reader,type,flag,length))
+		//Error
+		return nullptr;
 	
 	//Check type
-	if (type!=SHUTDOWN_ACK)
+	if (type!=Type::SHUTDOWN_ACK)
 		//Error
 		return nullptr;
 		
@@ -5,48 +5,33 @@ namespace sctp
 	
 size_t ShutdownAssociationChunk::GetSize() const
 {
-	//Header + attributes
-	size_t size = 20;
-	
-	//Done
-	return size;
+	//Fixed size
+	return Layout::Size;
 }
 
 size_t ShutdownAssociationChunk::Serialize(BufferWritter& writter) const
 {
-	//Get init pos
-	size_t ini = writter.Mark();
-	
-	//Write header
-	writter.Set1(type);
-	writter.Set1(0);
-	//Skip length position
-	size_t mark = writter.Skip(2);
-	
-	
-	
-	//Get length
-	size_t length = writter.GetOffset(ini);
-	//Set it
-	writter.Set2(mark,length);
+	//Write header and cumulative tsn ack at once
+	if (!Layout::Serialize(writter,type,0,Layout::Size,cumulativeTrasnmissionSequenceNumberAck))
+		//Error
+		return 0;
 	
 	//Done
-	return length;
+	return Layout::Size;
 }
 	
 Chunk::shared ShutdownAssociationChunk::Parse(BufferReader& reader)
 {
-	//Check size
-	if (!reader.Assert(20)) 
+	uint8_t type	= 0;
+	uint8_t flag	= 0; //Ignored, should be 0
+	uint16_t length	= 0;
+	uint32_t cumulativeTrasnmissionSequenceNumberAck = 0;
+	
+	//Get header and attributes
+	if (!Layout::Parse(reader,type,flag,length,cumulativeTrasnmissionSequenceNumberAck))
 		//Error
 		return nullptr;
 	
-	//Get header
-	size_t mark	= reader.Mark();
-	uint8_t type	= reader.Get1();
-	uint8_t flag	= reader.Get1(); //Ignored, should be 0
-	uint16_t length	= reader.Get2();
-	
 	//Check type
 	if (type!=Type::SHUTDOWN)
 		//Error
@@ -54,6 +39,7 @@ Chunk::shared ShutdownAssociationChunk::Parse(BufferReader& reader)
 		
 	//Create chunk
 	auto shutdown = std::make_shared<ShutdownAssociationChunk>();
+	shutdown->cumulativeTrasnmissionSequenceNumberAck = cumulativeTrasnmissionSequenceNumberAck;
 		
 	//Done
 	return std::static_pointer_cast<Chunk>(shutdown);
@@ -18,6 +18,9 @@ public:
 	virtual size_t GetSize() const override;
 
 	static Chunk::shared Parse(BufferReader& reader);
+	
+	// Type, flags, length and cumulative tsn ack
+	using Layout = FixedLayout<uint8_t,uint8_t,uint16_t,uint32_t>;
 public:
 	//        0                   1                   2                   3
 	//        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -26,7 +29,7 @@ public:
 	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 	//       |                      Cumulative TSN Ack                       |
 	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-	uint32_t cumulativeTrasnmissionSequenceNumberAck;
+	uint32_t cumulativeTrasnmissionSequenceNumberAck = 0;
 };
 	
 }; // namespace sctp
@@ -18,13 +18,18 @@ public:
 	virtual size_t GetSize() const override;
 
 	static Chunk::shared Parse(BufferReader& reader);
+	
+	enum Flag
+	{
+		ReflectedVerificationTag = 0x01,
+	};
 public:
 	//        0                   1                   2                   3
 	//        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
 	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 	//       |   Type = 14   |Reserved     |T|      Length = 4               |
 	//       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-	bool verificationTag;
+	bool verificationTag = false;
 };
 
 }; // namespace sctp
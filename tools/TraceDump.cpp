@@ -0,0 +1,95 @@
+// Converts a binary trace saved with datachannels::trace::Save to JSON
+//	Usage: tracedump [--chrome] trace.bin
+//	By default it prints an array with one object per record. With --chrome
+//	it prints a Chrome trace event file, one process per association and
+//	one thread per emitting thread, loadable in chrome://tracing or Perfetto.
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "Trace.h"
+
+using namespace datachannels;
+
+static bool Load(const char* filename, std::vector<trace::Thread>& threads)
+{
+	FILE* file = fopen(filename,"rb");
+	if (!file)
+		return false;
+	
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	bool ok = fread(&magic,sizeof(magic),1,file)==1 && fread(&version,sizeof(version),1,file)==1
+		&& magic==trace::Magic && version==trace::Version;
+	
+	//Read threads until end of file
+	uint32_t id;
+	while (ok && fread(&id,sizeof(id),1,file)==1)
+	{
+		uint32_t count = 0;
+		auto& thread = threads.emplace_back();
+		thread.id = id;
+		ok = fread(&count,sizeof(count),1,file)==1;
+		thread.records.resize(ok ? count : 0);
+		ok = ok && fread(thread.records.data(),sizeof(trace::Record),count,file)==count;
+	}
+	
+	fclose(file);
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	bool chrome = argc==3 && !strcmp(argv[1],"--chrome");
+	
+	if (argc!=2 && !chrome)
+	{
+		fprintf(stderr,"usage: %s [--chrome] trace.bin\n",argv[0]);
+		return 1;
+	}
+	
+	std::vector<trace::Thread> threads;
+	if (!Load(argv[argc-1],threads))
+	{
+		fprintf(stderr,"could not read trace %s\n",argv[argc-1]);
+		return 1;
+	}
+	
+	//Make timestamps relative to the first record
+	uint64_t start = UINT64_MAX;
+	for (const auto& thread : threads)
+		if (!thread.records.empty())
+			start = std::min(start,thread.records.front().timestamp);
+	
+	printf(chrome ? "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" : "[\n");
+	
+	bool first = true;
+	for (const auto& thread : threads)
+	{
+		for (const auto& record : thread.records)
+		{
+			const char* name = trace::GetName(static_cast<trace::Event>(record.event));
+			uint64_t timestamp = record.timestamp - start;
+			
+			if (!first)
+				printf(",\n");
+			first = false;
+			
+			if (chrome)
+				//Instant event in microseconds
+				printf("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu.%03llu,\"pid\":%u,\"tid\":%u,\"args\":{\"type\":%u,\"state\":%u,\"tsn\":%u,\"size\":%u}}",
+					name, (unsigned long long)timestamp/1000, (unsigned long long)timestamp%1000,
+					record.association, thread.id,
+					record.type, record.state, record.tsn, record.size);
+			else
+				printf("{\"thread\":%u,\"timestamp\":%llu,\"association\":%u,\"event\":\"%s\",\"type\":%u,\"state\":%u,\"tsn\":%u,\"size\":%u}",
+					thread.id, (unsigned long long)timestamp, record.association, name,
+					record.type, record.state, record.tsn, record.size);
+		}
+	}
+	
+	printf(chrome ? "\n]}\n" : "\n]\n");
+	return 0;
+}